@@ -123,6 +123,11 @@ solution "blowmorph"
 	  windows_binary("third-party/jsoncpp/bin", "jsoncpp.dll", "jsoncpp.dll")
 	  links { "jsoncpp" }
 
+    -- The worker pool.
+    configuration "linux"
+      buildoptions { "-pthread" }
+      links { "pthread" }
+
   project "net"
     kind "SharedLib"
     language "C++"
@@ -152,7 +157,7 @@ solution "blowmorph"
     files { "src/engine/**.cpp",
             "src/engine/**.h" }
 
-    links { "base" }
+    links { "base", "net" }
 
     -- JsonCpp
     configuration "linux"
@@ -193,6 +198,11 @@ solution "blowmorph"
       windows_libdir("third-party/box2d/bin")
 	  links { "Box2D" }
 
+    -- The network thread.
+    configuration "linux"
+      buildoptions { "-pthread" }
+      links { "pthread" }
+
   project "client"
     kind "ConsoleApp"
     language "C++"
@@ -234,6 +244,90 @@ solution "blowmorph"
       windows_libdir("third-party/box2d/bin")
 	  links { "Box2D" }
 
+  project "bot"
+    kind "ConsoleApp"
+    language "C++"
+    targetname "bot"
+
+    includedirs { "src" }
+    files { "src/bot/**.cpp",
+            "src/bot/**.h" }
+
+    links { "base", "engine", "net" }
+
+    configuration "windows"
+      resource("data", "data")
+
+    -- Box2D
+    configuration "linux"
+      links { "Box2D" }
+    configuration "windows"
+      includedirs { "third-party/box2d/include" }      
+      windows_libdir("third-party/box2d/bin")
+	  links { "Box2D" }
+
+  project "benchmark"
+    kind "ConsoleApp"
+    language "C++"
+    targetname "benchmark"
+
+    -- The controller is benchmarked without the server's 'main()'.
+    includedirs { "src" }
+    files { "src/benchmark/**.cpp",
+            "src/benchmark/**.h",
+            "src/server/**.cpp",
+            "src/server/**.h" }
+    excludes { "src/server/main.cpp" }
+
+    links { "base", "engine", "net" }
+
+    configuration "windows"
+      resource("data", "data")
+
+    -- JsonCpp
+    configuration "linux"
+      links { "jsoncpp" }
+    configuration "windows"
+      includedirs { "third-party/jsoncpp/include" }      
+      windows_libdir("third-party/jsoncpp/bin")
+	  links { "jsoncpp" }
+
+    -- Box2D
+    configuration "linux"
+      links { "Box2D" }
+    configuration "windows"
+      includedirs { "third-party/box2d/include" }      
+      windows_libdir("third-party/box2d/bin")
+	  links { "Box2D" }
+
+    configuration "linux"
+      buildoptions { "-pthread" }
+      links { "pthread" }
+
+  project "config-compiler"
+    kind "ConsoleApp"
+    language "C++"
+    targetname "config-compiler"
+
+    includedirs { "src" }
+    files { "src/config-compiler/**.cpp",
+            "src/config-compiler/**.h" }
+
+    links { "base", "engine", "net" }
+
+    -- Box2D
+    configuration "linux"
+      links { "Box2D" }
+    configuration "windows"
+      includedirs { "third-party/box2d/include" }      
+      windows_libdir("third-party/box2d/bin")
+	  links { "Box2D" }
+
+    -- The bundle is compiled right after the build. Without it the configs
+    -- are parsed from the JSON files.
+    configuration "linux"
+      postbuildcommands { "cd .. && LD_LIBRARY_PATH=bin bin/config-compiler data/config.bundle" }
+
   project "interpolator"
     kind "StaticLib"
     language "C++"
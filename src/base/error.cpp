@@ -2,7 +2,9 @@
 
 #include "base/error.h"
 
+#include <mutex>
 #include <string>
 #include <vector>
 
 std::vector<std::string> bm::Error::messages = std::vector<std::string>();
+std::mutex bm::Error::mutex;
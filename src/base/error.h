@@ -3,12 +3,10 @@
 #ifndef BASE_ERROR_H_
 #define BASE_ERROR_H_
 
-// WARNING: 'Error' class in NOT thread safe.
-// TODO(xairy): make it thread safe.
-
 #include <cstdarg>
 #include <cstdio>
 
+#include <mutex>
 #include <vector>
 #include <sstream>
 #include <string>
@@ -21,6 +19,7 @@ namespace bm {
 class Error {
  public:
   static void Print() {
+    std::lock_guard<std::mutex> lock(mutex);
     if (messages.empty()) {
       fprintf(stderr, "No errors have been reported.\n");
       return;
@@ -31,9 +30,16 @@ class Error {
     }
   }
 
+  // Drops the reported errors, e.g. after printing the ones that aren't
+  // fatal.
+  static void Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    messages.clear();
+  }
+
   static void Report(const char* file, unsigned int line,
                      const char* fmt, ...) {
-    static char buf[1024];
+    char buf[1024];
 
     va_list args;
     va_start(args, fmt);
@@ -43,11 +49,13 @@ class Error {
     std::stringstream ss;
     ss << "Error: " << buf << " (" << file << ":" << line << ")";
 
+    std::lock_guard<std::mutex> lock(mutex);
     Error::messages.push_back(ss.str());
   }
 
  private:
   BM_BASE_DECL static std::vector<std::string> messages;
+  BM_BASE_DECL static std::mutex mutex;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(Error);
 };
@@ -4,18 +4,48 @@
 
 #include <climits>
 
+#include <vector>
+
 #include "base/macros.h"
 #include "base/pstdint.h"
 
 namespace bm {
 
-IdManager::IdManager() : max_id_(0) { }
+IdManager::IdManager() {
+  // Index 0 is never handed out, so that valid ids are never 0.
+  generations_.push_back(0);
+}
+
 IdManager::~IdManager() { }
 
 uint32_t IdManager::NewId() {
-  max_id_ += 1;
-  CHECK(max_id_ < UINT_MAX);
-  return max_id_;
+  uint32_t index;
+  if (!free_indices_.empty()) {
+    index = free_indices_.back();
+    free_indices_.pop_back();
+  } else {
+    index = static_cast<uint32_t>(generations_.size());
+    // The last index is reserved, so that no id is equal to 'BAD_ID'.
+    CHECK(index < INDEX_MASK);
+    generations_.push_back(0);
+  }
+  return (generations_[index] << INDEX_BITS) | index;
+}
+
+void IdManager::FreeId(uint32_t id) {
+  uint32_t index = GetIndex(id);
+  CHECK(index != 0 && index < generations_.size());
+  CHECK(generations_[index] == GetGeneration(id));
+  generations_[index] = (generations_[index] + 1) & MAX_GENERATION;
+  free_indices_.push_back(index);
+}
+
+uint32_t IdManager::GetIndex(uint32_t id) {
+  return id & INDEX_MASK;
+}
+
+uint32_t IdManager::GetGeneration(uint32_t id) {
+  return id >> INDEX_BITS;
 }
 
 }  // namespace bm
@@ -5,24 +5,42 @@
 
 #include <climits>
 
+#include <vector>
+
 #include <base/pstdint.h>
 
 #include "base/dll.h"
 
 namespace bm {
 
+// Hands out generational ids. The lower 'INDEX_BITS' bits of an id are the
+// index of a slot, which is reused after the id is freed, and the upper
+// bits are the generation of the slot, which is incremented on each reuse.
+// So a freed id doesn't alias the ids handed out for the same slot later.
 class IdManager {
  public:
   static const uint32_t BAD_ID = UINT_MAX;
 
+  static const uint32_t INDEX_BITS = 20;
+  static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+  static const uint32_t MAX_GENERATION = (1u << (32 - INDEX_BITS)) - 1;
+
  public:
   BM_BASE_DECL IdManager();
   BM_BASE_DECL ~IdManager();
 
   BM_BASE_DECL uint32_t NewId();
 
+  // The slot of 'id' may be reused by the next 'NewId()' calls.
+  BM_BASE_DECL void FreeId(uint32_t id);
+
+  BM_BASE_DECL static uint32_t GetIndex(uint32_t id);
+  BM_BASE_DECL static uint32_t GetGeneration(uint32_t id);
+
  private:
-  uint32_t max_id_;
+  // Generations of the slots, indexed by slot.
+  std::vector<uint32_t> generations_;
+  std::vector<uint32_t> free_indices_;
 };
 
 }  // namespace bm
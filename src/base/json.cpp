@@ -14,7 +14,7 @@ namespace bm {
 
 bool ParseFile(const std::string& file,
       Json::Reader* reader, Json::Value* root) {
-  std::fstream stream(file);
+  std::ifstream stream(file);
   if (!stream.is_open()) {
     REPORT_ERROR("Can't open file '%s'.", file.c_str());
     return false;
@@ -0,0 +1,158 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "base/mapped_file.h"
+
+#ifdef _WIN32
+  #include <Windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include <string>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+MappedFile::MappedFile()
+  : data_(NULL), size_(0),
+#ifdef _WIN32
+    file_(NULL), mapping_(NULL),
+#endif
+    state_(STATE_FINALIZED) { }
+
+MappedFile::~MappedFile() {
+  if (state_ == STATE_INITIALIZED) {
+    Close();
+  }
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+  CHECK(state_ == STATE_FINALIZED);
+
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+      NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    REPORT_ERROR("Unable to open '%s'.", path.c_str());
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    REPORT_ERROR("Unable to get the size of '%s'.", path.c_str());
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = NULL;
+  const char* data = NULL;
+  if (size.QuadPart != 0) {
+    mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+      REPORT_ERROR("Unable to map '%s'.", path.c_str());
+      CloseHandle(file);
+      return false;
+    }
+    data = static_cast<const char*>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data == NULL) {
+      REPORT_ERROR("Unable to map '%s'.", path.c_str());
+      CloseHandle(mapping);
+      CloseHandle(file);
+      return false;
+    }
+  }
+
+  file_ = file;
+  mapping_ = mapping;
+  data_ = data;
+  size_ = static_cast<size_t>(size.QuadPart);
+  state_ = STATE_INITIALIZED;
+  return true;
+}
+
+void MappedFile::Close() {
+  CHECK(state_ == STATE_INITIALIZED);
+  if (data_ != NULL) UnmapViewOfFile(data_);
+  if (mapping_ != NULL) CloseHandle(mapping_);
+  CloseHandle(file_);
+  data_ = NULL;
+  size_ = 0;
+  file_ = NULL;
+  mapping_ = NULL;
+  state_ = STATE_FINALIZED;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+  CHECK(state_ == STATE_FINALIZED);
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    REPORT_ERROR("Unable to open '%s': %s.", path.c_str(), strerror(errno));
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) == -1) {
+    REPORT_ERROR("Unable to stat '%s': %s.", path.c_str(), strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  const char* data = NULL;
+  size_t size = static_cast<size_t>(info.st_size);
+  if (size != 0) {
+    void* address = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      REPORT_ERROR("Unable to map '%s': %s.", path.c_str(), strerror(errno));
+      close(fd);
+      return false;
+    }
+    data = static_cast<const char*>(address);
+  }
+
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+
+  data_ = data;
+  size_ = size;
+  state_ = STATE_INITIALIZED;
+  return true;
+}
+
+void MappedFile::Close() {
+  CHECK(state_ == STATE_INITIALIZED);
+  if (data_ != NULL) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  data_ = NULL;
+  size_ = 0;
+  state_ = STATE_FINALIZED;
+}
+
+#endif
+
+const char* MappedFile::GetData() const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return data_;
+}
+
+size_t MappedFile::GetSize() const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return size_;
+}
+
+}  // namespace bm
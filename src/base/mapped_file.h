@@ -0,0 +1,51 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef BASE_MAPPED_FILE_H_
+#define BASE_MAPPED_FILE_H_
+
+#include <cstddef>
+
+#include <string>
+
+#include "base/dll.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+// A file mapped into memory for reading.
+class MappedFile {
+ public:
+  BM_BASE_DECL MappedFile();
+  BM_BASE_DECL ~MappedFile();
+
+  // Returns 'false' on error.
+  BM_BASE_DECL bool Open(const std::string& path);
+
+  // Unmaps the file. Automatically called in the destructor.
+  BM_BASE_DECL void Close();
+
+  // The data is valid until 'Close()'. Empty files have NULL data.
+  BM_BASE_DECL const char* GetData() const;
+  BM_BASE_DECL size_t GetSize() const;
+
+ private:
+  const char* data_;
+  size_t size_;
+
+#ifdef _WIN32
+  void* file_;
+  void* mapping_;
+#endif
+
+  enum {
+    STATE_FINALIZED,
+    STATE_INITIALIZED
+  } state_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace bm
+
+#endif  // BASE_MAPPED_FILE_H_
@@ -0,0 +1,75 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "base/object_pool.h"
+
+#include <cstddef>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+namespace {
+
+// Blocks are aligned as the memory returned by 'new char[]'.
+const size_t BLOCK_ALIGNMENT = 16;
+
+}  // anonymous namespace
+
+ObjectPool::ObjectPool(size_t object_size, size_t chunk_size)
+    : object_size_(object_size),
+      chunk_size_(chunk_size),
+      free_list_(NULL) {
+  CHECK(object_size > 0);
+  CHECK(chunk_size > 0);
+  block_size_ = std::max(object_size, sizeof(FreeBlock));
+  block_size_ = (block_size_ + BLOCK_ALIGNMENT - 1) /
+      BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+}
+
+ObjectPool::~ObjectPool() {
+  for (auto chunk : chunks_) {
+    delete[] chunk;
+  }
+}
+
+size_t ObjectPool::GetObjectSize() const {
+  return object_size_;
+}
+
+void* ObjectPool::Allocate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (free_list_ == NULL) {
+    AllocateChunk();
+  }
+  FreeBlock* block = free_list_;
+  free_list_ = block->next;
+  return block;
+}
+
+void ObjectPool::Free(void* object) {
+  CHECK(object != NULL);
+  std::lock_guard<std::mutex> lock(mutex_);
+  FreeBlock* block = static_cast<FreeBlock*>(object);
+  block->next = free_list_;
+  free_list_ = block;
+}
+
+void ObjectPool::AllocateChunk() {
+  char* chunk = new char[block_size_ * chunk_size_];
+  CHECK(chunk != NULL);
+  chunks_.push_back(chunk);
+  // Link the blocks so that they are handed out in the address order.
+  for (size_t i = chunk_size_; i > 0; i--) {
+    FreeBlock* block = reinterpret_cast<FreeBlock*>(
+        chunk + (i - 1) * block_size_);
+    block->next = free_list_;
+    free_list_ = block;
+  }
+}
+
+}  // namespace bm
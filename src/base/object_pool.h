@@ -0,0 +1,85 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef BASE_OBJECT_POOL_H_
+#define BASE_OBJECT_POOL_H_
+
+#include <cstddef>
+
+#include <mutex>
+#include <vector>
+
+#include "base/dll.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+// Allocates memory blocks of a fixed size from chunks of 'chunk_size'
+// blocks. Freed blocks are reused by the next allocations and the chunks
+// are only released when the pool is destroyed. The pool is thread safe,
+// as the objects of a type may be created by several rooms at once.
+class ObjectPool {
+ public:
+  BM_BASE_DECL ObjectPool(size_t object_size, size_t chunk_size);
+  BM_BASE_DECL ~ObjectPool();
+
+  BM_BASE_DECL size_t GetObjectSize() const;
+
+  BM_BASE_DECL void* Allocate();
+  BM_BASE_DECL void Free(void* object);
+
+ private:
+  void AllocateChunk();
+
+  size_t block_size_;
+  size_t object_size_;
+  size_t chunk_size_;
+
+  std::vector<char*> chunks_;
+
+  // Freed blocks are linked through their first bytes.
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+  FreeBlock* free_list_;
+
+  std::mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(ObjectPool);
+};
+
+}  // namespace bm
+
+// Makes 'new' and 'delete' of the class use a pool of its own. Objects of
+// derived classes of a different size use the global allocator.
+// 'DECLARE_POOLED_ALLOCATION()' should be used in the public: declarations
+// of the class and 'DEFINE_POOLED_ALLOCATION()' in its source file.
+#define DECLARE_POOLED_ALLOCATION()               \
+  static void* operator new(size_t size);         \
+  static void operator delete(void* object, size_t size)
+
+#define DEFINE_POOLED_ALLOCATION(TypeName, ChunkSize)                   \
+  namespace {                                                           \
+  bm::ObjectPool* Get##TypeName##Pool() {                               \
+    static bm::ObjectPool pool(sizeof(TypeName), (ChunkSize));          \
+    return &pool;                                                       \
+  }                                                                     \
+  }                                                                     \
+  void* TypeName::operator new(size_t size) {                           \
+    if (size != sizeof(TypeName)) {                                     \
+      return ::operator new(size);                                      \
+    }                                                                   \
+    return Get##TypeName##Pool()->Allocate();                           \
+  }                                                                     \
+  void TypeName::operator delete(void* object, size_t size) {           \
+    if (object == NULL) {                                               \
+      return;                                                           \
+    }                                                                   \
+    if (size != sizeof(TypeName)) {                                     \
+      ::operator delete(object);                                        \
+      return;                                                           \
+    }                                                                   \
+    Get##TypeName##Pool()->Free(object);                                \
+  }
+
+#endif  // BASE_OBJECT_POOL_H_
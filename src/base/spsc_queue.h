@@ -0,0 +1,62 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef BASE_SPSC_QUEUE_H_
+#define BASE_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+// Bounded lock-free queue for exactly one producer thread and exactly one
+// consumer thread. 'capacity' should be a power of two.
+template<class T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacity)
+      : items_(capacity), mask_(capacity - 1), head_(0), tail_(0) {
+    CHECK(capacity != 0 && (capacity & (capacity - 1)) == 0);
+  }
+
+  // Called by the producer. Moves from 'item' and returns 'true' unless
+  // the queue is full.
+  bool Push(T* item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == items_.size()) {
+      return false;
+    }
+    items_[tail & mask_] = std::move(*item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called by the consumer. Returns 'false' if the queue is empty.
+  bool Pop(T* item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *item = std::move(items_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::vector<T> items_;
+  size_t mask_;
+
+  // Written only by the consumer and by the producer respectively.
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpscQueue);
+};
+
+}  // namespace bm
+
+#endif  // BASE_SPSC_QUEUE_H_
@@ -2,6 +2,8 @@
 
 #include "base/time.h"
 
+#include <chrono>
+
 #include "base/pstdint.h"
 #include "base/timer.h"
 
@@ -12,4 +14,9 @@ int64_t Timestamp() {
   return timer.GetTime();
 }
 
+int64_t TimestampNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 }  // namespace bm
@@ -11,6 +11,9 @@ namespace bm {
 // Returns time since some moment in ms.
 BM_BASE_DECL int64_t Timestamp();
 
+// Returns time since some moment in ns, from a monotonic clock.
+BM_BASE_DECL int64_t TimestampNs();
+
 }  // namespace bm
 
 #endif  // BASE_TIME_H_
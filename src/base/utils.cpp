@@ -2,12 +2,16 @@
 
 #include "base/utils.h"
 
+#include <sys/stat.h>
+#include <sys/types.h>
+
 #include <cstdio>
 
 #include <sstream>
 #include <string>
 
 #include "base/macros.h"
+#include "base/pstdint.h"
 
 namespace bm {
 
@@ -25,4 +29,14 @@ std::string IntToStr(int value) {
   return ss.str();
 }
 
+bool GetModificationTime(const std::string& file, int64_t* time) {
+  CHECK(time != NULL);
+  struct stat info;
+  if (stat(file.c_str(), &info) != 0) {
+    return false;
+  }
+  *time = static_cast<int64_t>(info.st_mtime);
+  return true;
+}
+
 }  // namespace bm
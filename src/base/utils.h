@@ -6,6 +6,7 @@
 #include <string>
 
 #include "base/dll.h"
+#include "base/pstdint.h"
 
 namespace bm {
 
@@ -14,6 +15,11 @@ BM_BASE_DECL size_t Random(size_t max);
 
 BM_BASE_DECL std::string IntToStr(int value);
 
+// Returns 'false' if the file doesn't exist.
+// The time is in seconds since the epoch.
+BM_BASE_DECL bool GetModificationTime(const std::string& file,
+    int64_t* time);
+
 }  // namespace bm
 
 #endif  // BASE_UTILS_H_
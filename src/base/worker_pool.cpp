@@ -0,0 +1,124 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "base/worker_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+WorkerPool::WorkerPool()
+    : batch_(0), busy_threads_(0), stop_(false), task_(NULL),
+      task_count_(0), next_task_(0), state_(STATE_FINALIZED) { }
+
+WorkerPool::~WorkerPool() {
+  if (state_ == STATE_INITIALIZED) {
+    Finalize();
+  }
+}
+
+void WorkerPool::Initialize(size_t thread_count) {
+  CHECK(state_ == STATE_FINALIZED);
+  stop_ = false;
+  // The calling thread is the worker 0.
+  for (size_t i = 0; i < thread_count; i++) {
+    threads_.push_back(std::thread(&WorkerPool::ThreadMain, this, i + 1,
+        batch_));
+  }
+  state_ = STATE_INITIALIZED;
+}
+
+void WorkerPool::Finalize() {
+  CHECK(state_ == STATE_INITIALIZED);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_condition_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  state_ = STATE_FINALIZED;
+}
+
+size_t WorkerPool::GetWorkerCount() const {
+  return threads_.size() + 1;
+}
+
+void WorkerPool::Run(size_t task_count, const Task& task) {
+  CHECK(state_ == STATE_INITIALIZED);
+  if (task_count == 0) {
+    return;
+  }
+
+  // Not worth waking the threads up.
+  if (task_count == 1 || threads_.empty()) {
+    for (size_t i = 0; i < task_count; i++) {
+      task(0, i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    task_count_ = task_count;
+    next_task_ = 0;
+    busy_threads_ = threads_.size();
+    batch_++;
+  }
+  start_condition_.notify_all();
+
+  RunTasks(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_condition_.wait(lock, [this] { return busy_threads_ == 0; });
+  task_ = NULL;
+}
+
+void WorkerPool::ThreadMain(size_t worker, uint32_t batch) {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_condition_.wait(lock,
+          [this, batch] { return stop_ || batch_ != batch; });
+      if (stop_) {
+        return;
+      }
+      batch = batch_;
+    }
+
+    RunTasks(worker);
+
+    bool done;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy_threads_--;
+      done = (busy_threads_ == 0);
+    }
+    if (done) {
+      done_condition_.notify_one();
+    }
+  }
+}
+
+void WorkerPool::RunTasks(size_t worker) {
+  while (true) {
+    size_t index = next_task_.fetch_add(1);
+    if (index >= task_count_) {
+      return;
+    }
+    (*task_)(worker, index);
+  }
+}
+
+}  // namespace bm
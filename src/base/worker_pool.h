@@ -0,0 +1,73 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef BASE_WORKER_POOL_H_
+#define BASE_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/dll.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+// Fixed set of threads that run batches of independent tasks.
+// The thread calling 'Run()' takes part in the batch as well.
+class WorkerPool {
+ public:
+  // Called with the index of the worker running the task, which is less
+  // than 'GetWorkerCount()', and the index of the task.
+  typedef std::function<void(size_t worker, size_t task)> Task;
+
+  BM_BASE_DECL WorkerPool();
+  BM_BASE_DECL ~WorkerPool();
+
+  // Starts 'thread_count' threads. With no threads all the tasks are run
+  // by the calling thread.
+  BM_BASE_DECL void Initialize(size_t thread_count);
+
+  // Stops the threads. Automatically called in the destructor.
+  BM_BASE_DECL void Finalize();
+
+  BM_BASE_DECL size_t GetWorkerCount() const;
+
+  // Runs 'task' for the tasks from 0 to 'task_count' - 1 and returns
+  // when all of them are done.
+  BM_BASE_DECL void Run(size_t task_count, const Task& task);
+
+ private:
+  // 'batch' is the last batch run before the thread has started.
+  void ThreadMain(size_t worker, uint32_t batch);
+  void RunTasks(size_t worker);
+
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable start_condition_;
+  std::condition_variable done_condition_;
+
+  // Guarded by 'mutex_'.
+  uint32_t batch_;
+  size_t busy_threads_;
+  bool stop_;
+
+  const Task* task_;
+  size_t task_count_;
+  std::atomic<size_t> next_task_;
+
+  enum {
+    STATE_FINALIZED,
+    STATE_INITIALIZED
+  } state_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+}  // namespace bm
+
+#endif  // BASE_WORKER_POOL_H_
@@ -0,0 +1,182 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "benchmark/benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+#include "base/utils.h"
+
+#include "engine/config.h"
+#include "engine/protocol.h"
+
+#include "server/controller.h"
+#include "server/critter.h"
+#include "server/player.h"
+#include "server/tick_profiler.h"
+#include "server/world.h"
+
+namespace bm {
+
+namespace {
+
+// Players aim within that distance along each axis.
+const size_t AIM_RANGE = 400;
+
+// Players change their direction once in that many ticks on average.
+const int32_t TURN_PERIOD = 50;
+
+}  // anonymous namespace
+
+ControllerBenchmark::ControllerBenchmark() : time_(0) { }
+
+ControllerBenchmark::~ControllerBenchmark() { }
+
+std::string ControllerBenchmark::GetScenarioName(const Options& options) {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "p%d_c%d_f%d_dt%d_s%u_t%d_w%d",
+      options.player_count, options.critter_count, options.fire_period,
+      options.tick_time, options.seed, options.ticks, options.warmup_ticks);
+  return std::string(buffer);
+}
+
+bool ControllerBenchmark::Initialize(const Options& options) {
+  CHECK(options.ticks > 0);
+  CHECK(options.warmup_ticks >= 0);
+  CHECK(options.tick_time > 0);
+  CHECK(options.player_count >= 0);
+  CHECK(options.critter_count >= 0);
+  CHECK(options.fire_period > 0);
+  options_ = options;
+
+  // 'Random()' is used by the controller as well.
+  srand(options_.seed);
+
+  if (!controller_.GetWorld()->LoadMap(options_.map)) {
+    return false;
+  }
+
+  // Only the phase totals are kept, so the profiler doesn't allocate
+  // during the measured ticks.
+  profiler_.Initialize(0, "");
+
+  for (int32_t i = 0; i < options_.player_count; i++) {
+    players_.push_back(controller_.OnPlayerConnected());
+  }
+  SpawnCritters();
+
+  controller_.GetGameEvents()->clear();
+  return true;
+}
+
+void ControllerBenchmark::Run(const uint64_t* allocation_counter,
+    Results* results) {
+  CHECK(allocation_counter != NULL);
+  CHECK(results != NULL);
+
+  for (int32_t i = 0; i < options_.warmup_ticks; i++) {
+    Tick();
+  }
+
+  controller_.SetProfiler(&profiler_);
+
+  uint64_t allocations = *allocation_counter;
+  auto start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i < options_.ticks; i++) {
+    Tick();
+  }
+  auto finish = std::chrono::steady_clock::now();
+  allocations = *allocation_counter - allocations;
+
+  controller_.SetProfiler(NULL);
+
+  int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      finish - start).count();
+  results->ticks = options_.ticks;
+  results->ns_per_tick = static_cast<float64_t>(ns) / options_.ticks;
+  results->allocations_per_tick =
+      static_cast<float64_t>(allocations) / options_.ticks;
+  for (size_t i = 0; i < TickProfiler::PHASE_COUNT; i++) {
+    TickProfiler::Phase phase = static_cast<TickProfiler::Phase>(i);
+    results->phase_ns_per_tick[i] =
+        static_cast<float64_t>(profiler_.GetPhaseTotal(phase)) /
+        options_.ticks;
+  }
+}
+
+void ControllerBenchmark::SpawnCritters() {
+  ServerWorld* world = controller_.GetWorld();
+  std::vector<b2Vec2>* spawns = world->GetZombieSpawnPositions();
+  if (spawns->empty()) {
+    spawns = world->GetSpawnPositions();
+  }
+  if (spawns->empty()) {
+    REPORT_WARNING("No spawn positions for critters on the map.");
+    return;
+  }
+  uint32_t config_id;
+  if (!Config::FindId(Config::GetInstance()->GetCrittersConfig(), "zombie",
+          &config_id)) {
+    REPORT_WARNING("No critter config named 'zombie'.");
+    return;
+  }
+  for (int32_t i = 0; i < options_.critter_count; i++) {
+    b2Vec2 position = (*spawns)[Random(spawns->size())];
+    Critter* critter = world->CreateCritter(position, config_id);
+    controller_.OnEntityAppearance(critter);
+  }
+}
+
+void ControllerBenchmark::Tick() {
+  for (auto player : players_) {
+    SimulateInput(player);
+  }
+  time_ += options_.tick_time;
+  controller_.Update(time_, options_.tick_time);
+  // Normally done by the broadcast.
+  controller_.GetGameEvents()->clear();
+  controller_.GetWorld()->FreeRemovedIds();
+}
+
+void ControllerBenchmark::SimulateInput(Player* player) {
+  if (Random(TURN_PERIOD) == 0) {
+    const KeyboardEvent::KeyType keys[] = {
+      KeyboardEvent::KEY_UP,
+      KeyboardEvent::KEY_DOWN,
+      KeyboardEvent::KEY_RIGHT,
+      KeyboardEvent::KEY_LEFT
+    };
+    KeyboardEvent event;
+    event.time = time_;
+    event.key_type = keys[Random(4)];
+    event.event_type = (Random(2) == 0) ?
+        KeyboardEvent::EVENT_KEYDOWN : KeyboardEvent::EVENT_KEYUP;
+    controller_.OnKeyboardEvent(player, event);
+  }
+
+  if (Random(options_.fire_period) == 0) {
+    // Rockets and slime in equal parts.
+    MouseEvent event;
+    event.time = time_;
+    event.event_type = MouseEvent::EVENT_KEYDOWN;
+    event.button_type = (Random(2) == 0) ?
+        MouseEvent::BUTTON_LEFT : MouseEvent::BUTTON_RIGHT;
+    b2Vec2 offset(static_cast<float>(Random(2 * AIM_RANGE)),
+        static_cast<float>(Random(2 * AIM_RANGE)));
+    offset -= b2Vec2(AIM_RANGE, AIM_RANGE);
+    event.x = player->GetPosition().x + offset.x;
+    event.y = player->GetPosition().y + offset.y;
+    controller_.OnMouseEvent(player, event);
+  }
+}
+
+}  // namespace bm
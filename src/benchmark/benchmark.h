@@ -0,0 +1,73 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef BENCHMARK_BENCHMARK_H_
+#define BENCHMARK_BENCHMARK_H_
+
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "server/controller.h"
+#include "server/tick_profiler.h"
+
+namespace bm {
+
+class Player;
+
+// Runs 'Controller::Update()' for a fixed number of ticks on a loaded map
+// with synthetic players and critters and no networking. The players walk
+// and shoot at random, but the same options give the same simulation.
+class ControllerBenchmark {
+ public:
+  struct Options {
+    std::string map;
+    uint32_t seed;
+    int32_t warmup_ticks;
+    int32_t ticks;
+    int32_t tick_time;
+    int32_t player_count;
+    int32_t critter_count;
+    // Each player fires once in 'fire_period' ticks on average.
+    int32_t fire_period;
+  };
+
+  struct Results {
+    int32_t ticks;
+    float64_t ns_per_tick;
+    float64_t allocations_per_tick;
+    // Indexed by 'TickProfiler::Phase', only the update phases are set.
+    float64_t phase_ns_per_tick[TickProfiler::PHASE_COUNT];
+  };
+
+  ControllerBenchmark();
+  ~ControllerBenchmark();
+
+  // Returns a name that differs for the options that change the workload
+  // or the measured interval.
+  static std::string GetScenarioName(const Options& options);
+
+  bool Initialize(const Options& options);
+
+  // 'allocation_counter' is incremented by the global 'operator new'.
+  void Run(const uint64_t* allocation_counter, Results* results);
+
+ private:
+  void SpawnCritters();
+  void Tick();
+  void SimulateInput(Player* player);
+
+  Options options_;
+  Controller controller_;
+  TickProfiler profiler_;
+
+  std::vector<Player*> players_;
+  int64_t time_;
+
+  DISALLOW_COPY_AND_ASSIGN(ControllerBenchmark);
+};
+
+}  // namespace bm
+
+#endif  // BENCHMARK_BENCHMARK_H_
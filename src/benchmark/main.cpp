@@ -0,0 +1,236 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fstream>
+#include <new>
+#include <string>
+
+#include <jsoncpp/json/json.h>
+
+#include "base/error.h"
+#include "base/json.h"
+#include "base/pstdint.h"
+
+#include "engine/config.h"
+
+#include "server/tick_profiler.h"
+
+#include "benchmark/benchmark.h"
+
+// Usage: benchmark [--name=value...]. See 'PrintUsage()'.
+// Exits with a failure if the results of the scenario are worse than its
+// baseline by more than the tolerance.
+
+namespace {
+
+// Counts all the allocations in the process, including the libraries.
+uint64_t allocation_count = 0;
+
+// Phases faster than that are too noisy to be compared.
+const double MIN_COMPARED_NS = 1000.0;
+
+void PrintUsage(const char* program) {
+  fprintf(stderr,
+      "Usage: %s [options]\n"
+      "  --map=FILE            map to load (data/maps/map.bmap)\n"
+      "  --ticks=N             measured ticks (1000)\n"
+      "  --warmup=N            ticks before measuring (100)\n"
+      "  --tick-time=MS        simulation step (10)\n"
+      "  --players=N           synthetic players (16)\n"
+      "  --critters=N          critters spawned at start (64)\n"
+      "  --fire-period=N       ticks between shots per player (20)\n"
+      "  --seed=N              random seed (1)\n"
+      "  --baseline=FILE       baselines file (data/benchmark_baseline.json)\n"
+      "  --tolerance=X         allowed slowdown, 0.25 is 25%% (0.25)\n"
+      "  --update-baseline     store the results as the baseline\n",
+      program);
+}
+
+bool ParseFlag(const char* arg, const char* name, std::string* value) {
+  size_t length = strlen(name);
+  if (strncmp(arg, name, length) != 0 || arg[length] != '=') {
+    return false;
+  }
+  *value = arg + length + 1;
+  return true;
+}
+
+// Returns 'false' if 'current' is worse than 'baseline' beyond 'tolerance'.
+bool Compare(const char* name, double current, double baseline,
+    double tolerance, double min_value) {
+  double limit = baseline * (1.0 + tolerance);
+  bool failed = current > limit && current >= min_value;
+  printf("%-28s %14.1f %14.1f %8.1f%%%s\n", name, current, baseline,
+      baseline != 0.0 ? (current / baseline - 1.0) * 100.0 : 0.0,
+      failed ? "  REGRESSION" : "");
+  return !failed;
+}
+
+}  // anonymous namespace
+
+void* operator new(size_t size) {
+  allocation_count++;
+  void* memory = malloc(size != 0 ? size : 1);
+  if (memory == NULL) {
+    abort();
+  }
+  return memory;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+  free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+  free(memory);
+}
+
+int main(int argc, char** argv) {
+  bm::ControllerBenchmark::Options options;
+  options.map = "data/maps/map.bmap";
+  options.seed = 1;
+  options.warmup_ticks = 100;
+  options.ticks = 1000;
+  options.tick_time = 10;
+  options.player_count = 16;
+  options.critter_count = 64;
+  options.fire_period = 20;
+
+  std::string baseline_file = "data/benchmark_baseline.json";
+  double tolerance = 0.25;
+  bool update_baseline = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (ParseFlag(argv[i], "--map", &value)) {
+      options.map = value;
+    } else if (ParseFlag(argv[i], "--ticks", &value)) {
+      options.ticks = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "--warmup", &value)) {
+      options.warmup_ticks = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "--tick-time", &value)) {
+      options.tick_time = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "--players", &value)) {
+      options.player_count = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "--critters", &value)) {
+      options.critter_count = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "--fire-period", &value)) {
+      options.fire_period = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "--seed", &value)) {
+      options.seed = static_cast<uint32_t>(atoi(value.c_str()));
+    } else if (ParseFlag(argv[i], "--baseline", &value)) {
+      baseline_file = value;
+    } else if (ParseFlag(argv[i], "--tolerance", &value)) {
+      tolerance = atof(value.c_str());
+    } else if (strcmp(argv[i], "--update-baseline") == 0) {
+      update_baseline = true;
+    } else {
+      PrintUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (options.ticks <= 0 || options.warmup_ticks < 0 ||
+      options.tick_time <= 0 || options.player_count < 0 ||
+      options.critter_count < 0 || options.fire_period <= 0 ||
+      tolerance < 0.0) {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (!bm::Config::GetInstance()->Initialize()) {
+    bm::Error::Print();
+    return EXIT_FAILURE;
+  }
+
+  std::string scenario = bm::ControllerBenchmark::GetScenarioName(options);
+
+  bm::ControllerBenchmark::Results results;
+  {
+    bm::ControllerBenchmark benchmark;
+    if (!benchmark.Initialize(options)) {
+      bm::Error::Print();
+      return EXIT_FAILURE;
+    }
+    benchmark.Run(&allocation_count, &results);
+  }
+
+  printf("Scenario %s, %d ticks.\n", scenario.c_str(), results.ticks);
+
+  // Only the phases of 'Controller::Update()' are timed.
+  const bm::TickProfiler::Phase last_phase =
+      bm::TickProfiler::PHASE_RECORD_POSITIONS;
+
+  Json::Value current(Json::objectValue);
+  current["ns_per_tick"] = results.ns_per_tick;
+  current["allocations_per_tick"] = results.allocations_per_tick;
+  for (size_t i = 0; i <= last_phase; i++) {
+    bm::TickProfiler::Phase phase = static_cast<bm::TickProfiler::Phase>(i);
+    current["phases"][bm::TickProfiler::GetPhaseName(phase)] =
+        results.phase_ns_per_tick[i];
+  }
+
+  Json::Value baselines(Json::objectValue);
+  {
+    std::ifstream stream(baseline_file.c_str());
+    if (stream.good()) {
+      Json::Reader reader;
+      if (!bm::ParseFile(baseline_file, &reader, &baselines)) {
+        bm::Error::Print();
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  if (update_baseline) {
+    baselines[scenario] = current;
+    std::ofstream stream(baseline_file.c_str());
+    if (!stream.good()) {
+      fprintf(stderr, "Can't write '%s'.\n", baseline_file.c_str());
+      return EXIT_FAILURE;
+    }
+    Json::StyledStreamWriter writer;
+    writer.write(stream, baselines);
+  }
+
+  const Json::Value& baseline = baselines[scenario];
+  if (baseline.isNull() || !baseline.isObject()) {
+    printf("%-28s %14s\n", "metric", "current");
+    printf("%-28s %14.1f\n", "ns_per_tick", results.ns_per_tick);
+    printf("%-28s %14.1f\n", "allocations_per_tick",
+        results.allocations_per_tick);
+    for (size_t i = 0; i <= last_phase; i++) {
+      bm::TickProfiler::Phase phase = static_cast<bm::TickProfiler::Phase>(i);
+      printf("%-28s %14.1f\n", bm::TickProfiler::GetPhaseName(phase),
+          results.phase_ns_per_tick[i]);
+    }
+    printf("No baseline for the scenario in '%s'.\n", baseline_file.c_str());
+    return EXIT_SUCCESS;
+  }
+
+  bool passed = true;
+  printf("%-28s %14s %14s %9s\n", "metric", "current", "baseline", "change");
+  passed &= Compare("ns_per_tick", results.ns_per_tick,
+      baseline["ns_per_tick"].asDouble(), tolerance, MIN_COMPARED_NS);
+  // Allocations are deterministic, so any growth is a regression.
+  passed &= Compare("allocations_per_tick", results.allocations_per_tick,
+      baseline["allocations_per_tick"].asDouble(), 0.0, 0.0);
+  for (size_t i = 0; i <= last_phase; i++) {
+    bm::TickProfiler::Phase phase = static_cast<bm::TickProfiler::Phase>(i);
+    const char* name = bm::TickProfiler::GetPhaseName(phase);
+    passed &= Compare(name, results.phase_ns_per_tick[i],
+        baseline["phases"][name].asDouble(), tolerance, MIN_COMPARED_NS);
+  }
+
+  if (!passed) {
+    printf("Regression against the baseline of %s.\n", scenario.c_str());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
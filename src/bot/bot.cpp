@@ -0,0 +1,565 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "bot/bot.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+#include "base/time.h"
+#include "base/utils.h"
+
+#include "net/enet.h"
+#include "net/utils.h"
+
+#include "engine/config.h"
+#include "engine/delta.h"
+#include "engine/protocol.h"
+#include "engine/snapshot_codec.h"
+#include "engine/world_state.h"
+
+namespace bm {
+
+namespace {
+
+// The periods of the scripted actions, in ms. Turns, shots and door
+// activations happen at random within [period, 2 * period).
+const int64_t INPUT_PERIOD = 33;
+const int64_t TURN_PERIOD = 500;
+const int64_t SHOT_PERIOD = 1000;
+const int64_t ACTIVATION_PERIOD = 2000;
+const int64_t TIME_SYNC_PERIOD = 1000;
+
+// Targets farther than that are ignored.
+const float32_t MAX_TARGET_DISTANCE = 400.0f;
+const float32_t MAX_DOOR_DISTANCE = 100.0f;
+
+int64_t RandomDelay(int64_t period) {
+  return period + static_cast<int64_t>(Random(static_cast<size_t>(period)));
+}
+
+}  // anonymous namespace
+
+Bot::Bot()
+    : host_(NULL), event_(NULL), peer_(NULL), time_correction_(0),
+      last_tick_(0), start_time_(0), next_input_(0), next_turn_(0),
+      next_shot_(0), next_activation_(0), next_time_sync_(0),
+      key_pressed_(false), key_(KeyboardEvent::KEY_UP), input_sequence_(0),
+      aim_x_(0.0f), aim_y_(0.0f), state_(STATE_FINALIZED) {
+  ResetStats();
+}
+
+Bot::~Bot() {
+  if (state_ != STATE_FINALIZED) {
+    Finalize();
+  }
+}
+
+bool Bot::Initialize(Enet* enet, const std::string& login) {
+  CHECK(state_ == STATE_FINALIZED);
+  CHECK(enet != NULL);
+  CHECK(login.size() <= LoginData::MAX_LOGIN_LENGTH);
+
+  const Config::ClientConfig& config =
+    Config::GetInstance()->GetClientConfig();
+
+  login_ = login;
+
+  std::auto_ptr<ClientHost> host(enet->CreateClientHost(CHANNEL_COUNT));
+  if (host.get() == NULL) {
+    return false;
+  }
+
+  std::auto_ptr<Event> event(enet->CreateEvent());
+  if (event.get() == NULL) {
+    return false;
+  }
+
+  peer_ = host->Connect(config.server_host, config.server_port,
+      CHANNEL_COUNT);
+  if (peer_ == NULL) {
+    return false;
+  }
+
+  host_ = host.release();
+  event_ = event.release();
+
+  start_time_ = Timestamp();
+  state_ = STATE_CONNECTING;
+  return true;
+}
+
+void Bot::Finalize() {
+  CHECK(state_ != STATE_FINALIZED);
+  if (peer_ != NULL) {
+    peer_->DisconnectNow();
+    peer_ = NULL;
+  }
+  delete event_;
+  event_ = NULL;
+  delete host_;
+  host_ = NULL;
+  state_ = STATE_FINALIZED;
+}
+
+bool Bot::Tick() {
+  CHECK(state_ != STATE_FINALIZED);
+
+  const Config::ClientConfig& config =
+    Config::GetInstance()->GetClientConfig();
+
+  int64_t time = Timestamp();
+  if (state_ == STATE_CONNECTING &&
+      time - start_time_ > config.connect_timeout) {
+    REPORT_ERROR("%s: Could not connect to server %s:%d.", login_.c_str(),
+        config.server_host.c_str(), static_cast<int>(config.server_port));
+    return false;
+  }
+  if ((state_ == STATE_LOGGING_IN || state_ == STATE_SYNCHRONIZING) &&
+      time - start_time_ > config.sync_timeout) {
+    REPORT_ERROR("%s: Synchronization failed: time's out.", login_.c_str());
+    return false;
+  }
+
+  std::vector<char> buffer;
+  do {
+    if (host_->Service(event_, 0) == false) {
+      return false;
+    }
+
+    switch (event_->GetType()) {
+      case Event::TYPE_CONNECT: {
+        if (!OnConnect()) {
+          return false;
+        }
+      } break;
+
+      case Event::TYPE_RECEIVE: {
+        event_->GetData(&buffer);
+        stats_.received_bytes += buffer.size();
+        if (!OnPacket(buffer)) {
+          return false;
+        }
+      } break;
+
+      case Event::TYPE_DISCONNECT: {
+        peer_ = NULL;
+        REPORT_ERROR("%s: Connection lost.", login_.c_str());
+        return false;
+      } break;
+
+      case Event::TYPE_NONE:
+        break;
+    }
+  } while (event_->GetType() != Event::TYPE_NONE);
+
+  if (state_ == STATE_PLAYING) {
+    if (!Play(Timestamp())) {
+      return false;
+    }
+  }
+
+  host_->Flush();
+  return true;
+}
+
+const std::string& Bot::GetLogin() const {
+  return login_;
+}
+
+bool Bot::IsPlaying() const {
+  return state_ == STATE_PLAYING;
+}
+
+const Bot::Stats& Bot::GetStats() const {
+  return stats_;
+}
+
+void Bot::ResetStats() {
+  stats_.rtt = -1;
+  stats_.snapshot_count = 0;
+  stats_.received_bytes = 0;
+  stats_.sent_bytes = 0;
+}
+
+bool Bot::OnConnect() {
+  CHECK(state_ == STATE_CONNECTING);
+
+  const Config::ClientConfig& config =
+    Config::GetInstance()->GetClientConfig();
+
+  LoginData login_data;
+  login_data.protocol_version = config.protocol_version;
+  std::copy(login_.begin(), login_.end(), &login_data.login[0]);
+  login_data.login[login_.size()] = '\0';
+  login_data.room = config.server_room;
+  login_data.interpolation_offset = config.interpolation_offset;
+  if (!Send(Packet::TYPE_LOGIN, login_data, true)) {
+    return false;
+  }
+
+  start_time_ = Timestamp();
+  state_ = STATE_LOGGING_IN;
+  return true;
+}
+
+bool Bot::OnPacket(const std::vector<char>& buffer) {
+  Packet::Type type;
+  if (!ExtractPacketType(buffer, &type)) {
+    REPORT_ERROR("%s: Incorrect packet format!", login_.c_str());
+    return false;
+  }
+
+  // Like the client, ignore everything until synchronized.
+  if (state_ == STATE_LOGGING_IN) {
+    if (type == Packet::TYPE_CLIENT_OPTIONS) {
+      return OnClientOptions(buffer);
+    }
+    return true;
+  }
+  if (state_ == STATE_SYNCHRONIZING) {
+    if (type == Packet::TYPE_SYNC_TIME_RESPONSE) {
+      return OnTimeSyncResponse(buffer);
+    }
+    return true;
+  }
+  if (state_ != STATE_PLAYING) {
+    return true;
+  }
+
+  switch (type) {
+    case Packet::TYPE_SYNC_TIME_RESPONSE: {
+      if (!OnTimeSyncResponse(buffer)) {
+        return false;
+      }
+    } break;
+
+    case Packet::TYPE_WORLD_STATE: {
+      if (!OnWorldState(buffer)) {
+        return false;
+      }
+    } break;
+
+    case Packet::TYPE_ENTITY_DISAPPEARED: {
+      EntityDisappearance disappearance;
+      bool rv = ExtractPacketData<Packet::Type, EntityDisappearance>(
+          buffer, &disappearance);
+      if (rv == false) {
+        REPORT_ERROR("%s: Incorrect entity packet format!", login_.c_str());
+        return false;
+      }
+      entities_.erase(disappearance.id);
+      baselines_.erase(disappearance.id);
+    } break;
+
+    case Packet::TYPE_GAME_EVENT: {
+      GameEvent event;
+      if (!ExtractPacketData<Packet::Type, GameEvent>(buffer, &event)) {
+        REPORT_ERROR("%s: Incorrect game event packet format!",
+            login_.c_str());
+        return false;
+      }
+      if (event.type == GameEvent::TYPE_ENTITY_DISAPPEARED) {
+        entities_.erase(event.entity.id);
+        baselines_.erase(event.entity.id);
+      }
+    } break;
+
+    default:
+      break;
+  }
+
+  return true;
+}
+
+bool Bot::OnClientOptions(const std::vector<char>& buffer) {
+  bool rv = ExtractPacketData<Packet::Type, ClientOptions>(
+      buffer, &client_options_);
+  if (rv == false) {
+    REPORT_ERROR("%s: Incorrect client options packet format.",
+        login_.c_str());
+    return false;
+  }
+
+  if (client_options_.protocol_version == PROTOCOL_VERSION_COMPACT) {
+    rv = snapshot_codec_.Initialize(client_options_.position_step,
+        client_options_.position_bits);
+    if (rv == false) {
+      return false;
+    }
+  } else if (client_options_.protocol_version != PROTOCOL_VERSION_RAW) {
+    REPORT_ERROR("%s: Unsupported protocol version %u.", login_.c_str(),
+        client_options_.protocol_version);
+    return false;
+  }
+
+  aim_x_ = client_options_.x;
+  aim_y_ = client_options_.y;
+
+  if (!SendTimeSyncRequest()) {
+    return false;
+  }
+
+  state_ = STATE_SYNCHRONIZING;
+  return true;
+}
+
+bool Bot::OnTimeSyncResponse(const std::vector<char>& buffer) {
+  TimeSyncData response;
+  if (!ExtractPacketData<Packet::Type, TimeSyncData>(buffer, &response)) {
+    REPORT_ERROR("%s: Incorrect time sync packet format.", login_.c_str());
+    return false;
+  }
+
+  int64_t client_time = Timestamp();
+  int64_t latency = (client_time - response.client_time) / 2;
+  stats_.rtt = client_time - response.client_time;
+
+  if (state_ != STATE_SYNCHRONIZING) {
+    return true;
+  }
+
+  time_correction_ = response.server_time + latency - client_time;
+
+  ClientStatus client_status;
+  client_status.status = ClientStatus::STATUS_SYNCHRONIZED;
+  if (!Send(Packet::TYPE_CLIENT_STATUS, client_status, true)) {
+    return false;
+  }
+
+  next_input_ = client_time;
+  next_turn_ = client_time;
+  next_shot_ = client_time + RandomDelay(SHOT_PERIOD);
+  next_activation_ = client_time + RandomDelay(ACTIVATION_PERIOD);
+  next_time_sync_ = client_time + TIME_SYNC_PERIOD;
+
+  state_ = STATE_PLAYING;
+  return true;
+}
+
+bool Bot::OnWorldState(const std::vector<char>& buffer) {
+  WorldState state;
+  size_t skipped_count;
+  bool rv = ExtractWorldState(buffer, GetSnapshotCodec(), &baselines_,
+      &state, &world_state_snapshots_, &skipped_count);
+  if (rv == false) {
+    REPORT_ERROR("%s: Incorrect world state packet format!", login_.c_str());
+    return false;
+  }
+
+  for (auto& snapshot : world_state_snapshots_) {
+    entities_[snapshot.id] = snapshot;
+  }
+
+  if (state.tick != last_tick_) {
+    stats_.snapshot_count++;
+    last_tick_ = state.tick;
+  }
+  // A part with skipped records isn't acknowledged, otherwise the server
+  // would keep sending deltas against the snapshots that are missing.
+  if (state.part < SnapshotAcks::MAX_PARTS && skipped_count == 0) {
+    received_parts_[state.tick] |= 1u << state.part;
+  }
+  return true;
+}
+
+const SnapshotCodec* Bot::GetSnapshotCodec() const {
+  if (client_options_.protocol_version == PROTOCOL_VERSION_COMPACT) {
+    return &snapshot_codec_;
+  }
+  return NULL;
+}
+
+bool Bot::Play(int64_t time) {
+  if (time >= next_turn_) {
+    if (!ChangeDirection()) {
+      return false;
+    }
+    next_turn_ = time + RandomDelay(TURN_PERIOD);
+  }
+  if (time >= next_shot_) {
+    if (!Shoot()) {
+      return false;
+    }
+    next_shot_ = time + RandomDelay(SHOT_PERIOD);
+  }
+  if (time >= next_activation_) {
+    if (!ActivateDoor()) {
+      return false;
+    }
+    next_activation_ = time + RandomDelay(ACTIVATION_PERIOD);
+  }
+  if (time >= next_time_sync_) {
+    if (!SendTimeSyncRequest()) {
+      return false;
+    }
+    next_time_sync_ = time + TIME_SYNC_PERIOD;
+  }
+  // Like the client, send the cursor and the acks at a fixed rate.
+  if (time >= next_input_) {
+    if (!SendMousePosition() || !SendSnapshotAcks()) {
+      return false;
+    }
+    next_input_ = time + INPUT_PERIOD;
+  }
+  return true;
+}
+
+bool Bot::ChangeDirection() {
+  KeyboardEvent event;
+  event.time = GetServerTime();
+  if (key_pressed_) {
+    event.sequence = ++input_sequence_;
+    event.key_type = key_;
+    event.event_type = KeyboardEvent::EVENT_KEYUP;
+    if (!Send(Packet::TYPE_KEYBOARD_EVENT, event, false)) {
+      return false;
+    }
+  }
+
+  // Stand still now and then.
+  size_t choice = Random(5);
+  key_pressed_ = (choice < 4);
+  if (!key_pressed_) {
+    return true;
+  }
+
+  const KeyboardEvent::KeyType keys[] = {
+    KeyboardEvent::KEY_UP,
+    KeyboardEvent::KEY_DOWN,
+    KeyboardEvent::KEY_RIGHT,
+    KeyboardEvent::KEY_LEFT
+  };
+  key_ = keys[choice];
+  event.sequence = ++input_sequence_;
+  event.key_type = key_;
+  event.event_type = KeyboardEvent::EVENT_KEYDOWN;
+  return Send(Packet::TYPE_KEYBOARD_EVENT, event, false);
+}
+
+bool Bot::Shoot() {
+  const EntitySnapshot* target =
+      FindNearest(EntitySnapshot::ENTITY_TYPE_PLAYER);
+  if (target == NULL) {
+    target = FindNearest(EntitySnapshot::ENTITY_TYPE_CRITTER);
+  }
+
+  auto self = entities_.find(client_options_.id);
+  if (target != NULL) {
+    aim_x_ = target->x;
+    aim_y_ = target->y;
+  } else if (self != entities_.end()) {
+    // Shoot at random.
+    aim_x_ = self->second.x + static_cast<float32_t>(Random(400)) - 200.0f;
+    aim_y_ = self->second.y + static_cast<float32_t>(Random(400)) - 200.0f;
+  }
+
+  // Rockets from the bazooka and slime from the morpher.
+  MouseEvent event;
+  event.time = GetServerTime();
+  event.button_type = (Random(2) == 0) ?
+      MouseEvent::BUTTON_LEFT : MouseEvent::BUTTON_RIGHT;
+  event.event_type = MouseEvent::EVENT_KEYDOWN;
+  event.x = aim_x_;
+  event.y = aim_y_;
+  if (!Send(Packet::TYPE_MOUSE_EVENT, event, false)) {
+    return false;
+  }
+  event.event_type = MouseEvent::EVENT_KEYUP;
+  return Send(Packet::TYPE_MOUSE_EVENT, event, false);
+}
+
+bool Bot::ActivateDoor() {
+  const EntitySnapshot* door = FindNearest(EntitySnapshot::ENTITY_TYPE_DOOR);
+  auto self = entities_.find(client_options_.id);
+  if (door == NULL || self == entities_.end()) {
+    return true;
+  }
+  float32_t dx = door->x - self->second.x;
+  float32_t dy = door->y - self->second.y;
+  if (dx * dx + dy * dy > MAX_DOOR_DISTANCE * MAX_DOOR_DISTANCE) {
+    return true;
+  }
+
+  // The server checks the visibility and the distance itself.
+  PlayerAction action;
+  action.type = PlayerAction::TYPE_ACTIVATE;
+  action.target_id = door->id;
+  return Send(Packet::TYPE_PLAYER_ACTION, action, false);
+}
+
+bool Bot::SendTimeSyncRequest() {
+  TimeSyncData request;
+  request.client_time = Timestamp();
+  request.server_time = 0;
+  return Send(Packet::TYPE_SYNC_TIME_REQUEST, request, true);
+}
+
+bool Bot::SendMousePosition() {
+  MouseEvent event;
+  event.time = GetServerTime();
+  event.button_type = MouseEvent::BUTTON_NONE;
+  event.event_type = MouseEvent::EVENT_MOVE;
+  event.x = aim_x_;
+  event.y = aim_y_;
+  return Send(Packet::TYPE_MOUSE_EVENT, event, false);
+}
+
+bool Bot::SendSnapshotAcks() {
+  for (auto itr : received_parts_) {
+    SnapshotAck ack;
+    ack.tick = itr.first;
+    ack.parts = itr.second;
+    if (!Send(Packet::TYPE_SNAPSHOT_ACK, ack, false)) {
+      return false;
+    }
+  }
+  received_parts_.clear();
+  return true;
+}
+
+const EntitySnapshot* Bot::FindNearest(EntitySnapshot::EntityType type) const {
+  auto self = entities_.find(client_options_.id);
+  if (self == entities_.end()) {
+    return NULL;
+  }
+
+  const EntitySnapshot* nearest = NULL;
+  float32_t min_distance2 = MAX_TARGET_DISTANCE * MAX_TARGET_DISTANCE;
+  for (auto& itr : entities_) {
+    const EntitySnapshot& snapshot = itr.second;
+    if (snapshot.type != type || snapshot.id == client_options_.id) {
+      continue;
+    }
+    float32_t dx = snapshot.x - self->second.x;
+    float32_t dy = snapshot.y - self->second.y;
+    float32_t distance2 = dx * dx + dy * dy;
+    if (distance2 <= min_distance2) {
+      min_distance2 = distance2;
+      nearest = &snapshot;
+    }
+  }
+  return nearest;
+}
+
+template<class DataType>
+bool Bot::Send(Packet::Type type, const DataType& data, bool reliable) {
+  CHECK(peer_ != NULL);
+  stats_.sent_bytes += sizeof(type) + sizeof(data);
+  return SendPacket(peer_, type, data, reliable);
+}
+
+int64_t Bot::GetServerTime() const {
+  return Timestamp() + time_correction_;
+}
+
+}  // namespace bm
@@ -0,0 +1,126 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef BOT_BOT_H_
+#define BOT_BOT_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "net/enet.h"
+
+#include "engine/delta.h"
+#include "engine/protocol.h"
+#include "engine/snapshot_codec.h"
+
+namespace bm {
+
+// A scripted headless player. It walks around, shoots at the nearest
+// players and critters and opens the doors it passes by. Many bots are
+// driven by a single thread, so nothing blocks.
+class Bot {
+ public:
+  // Network statistics gathered since the last 'ResetStats()'.
+  struct Stats {
+    // Round trip time of the last time synchronization request, in ms.
+    int64_t rtt;
+    // Number of different world state ticks received.
+    uint32_t snapshot_count;
+    uint32_t received_bytes;
+    uint32_t sent_bytes;
+  };
+
+  Bot();
+  ~Bot();
+
+  // Starts connecting to the server.
+  bool Initialize(Enet* enet, const std::string& login);
+  void Finalize();
+
+  // Handles the received packets and sends the scripted input.
+  // Returns 'false' on error or disconnect.
+  bool Tick();
+
+  const std::string& GetLogin() const;
+  bool IsPlaying() const;
+
+  const Stats& GetStats() const;
+  void ResetStats();
+
+ private:
+  bool OnConnect();
+  bool OnPacket(const std::vector<char>& buffer);
+
+  bool OnClientOptions(const std::vector<char>& buffer);
+  bool OnTimeSyncResponse(const std::vector<char>& buffer);
+  bool OnWorldState(const std::vector<char>& buffer);
+
+  // Returns NULL if the server sends raw snapshots.
+  const SnapshotCodec* GetSnapshotCodec() const;
+
+  // The script.
+  bool Play(int64_t time);
+  bool ChangeDirection();
+  bool Shoot();
+  bool ActivateDoor();
+  bool SendTimeSyncRequest();
+  bool SendMousePosition();
+  bool SendSnapshotAcks();
+
+  // Returns NULL if the bot doesn't know any.
+  const EntitySnapshot* FindNearest(EntitySnapshot::EntityType type) const;
+
+  template<class DataType>
+  bool Send(Packet::Type type, const DataType& data, bool reliable);
+
+  int64_t GetServerTime() const;
+
+  std::string login_;
+
+  ClientHost* host_;
+  Event* event_;
+  Peer* peer_;
+
+  ClientOptions client_options_;
+  SnapshotCodec snapshot_codec_;
+  int64_t time_correction_;
+
+  // The latest snapshots of the entities the bot knows about.
+  std::map<uint32_t, EntitySnapshot> entities_;
+  std::map<uint32_t, SnapshotHistory> baselines_;
+  std::vector<EntitySnapshot> world_state_snapshots_;
+  std::map<uint32_t, uint32_t> received_parts_;
+  uint32_t last_tick_;
+
+  // Script timers.
+  int64_t start_time_;
+  int64_t next_input_;
+  int64_t next_turn_;
+  int64_t next_shot_;
+  int64_t next_activation_;
+  int64_t next_time_sync_;
+
+  bool key_pressed_;
+  KeyboardEvent::KeyType key_;
+  uint32_t input_sequence_;
+  float32_t aim_x_, aim_y_;
+
+  Stats stats_;
+
+  enum {
+    STATE_FINALIZED,
+    STATE_CONNECTING,
+    STATE_LOGGING_IN,
+    STATE_SYNCHRONIZING,
+    STATE_PLAYING
+  } state_;
+
+  DISALLOW_COPY_AND_ASSIGN(Bot);
+};
+
+}  // namespace bm
+
+#endif  // BOT_BOT_H_
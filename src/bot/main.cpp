@@ -0,0 +1,157 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/ctrlc.h"
+#include "base/error.h"
+#include "base/pstdint.h"
+#include "base/time.h"
+#include "base/utils.h"
+
+#include "net/enet.h"
+
+#include "engine/config.h"
+
+#include "bot/bot.h"
+
+// Connects a swarm of bots to the server from the client config and
+// periodically prints their network statistics.
+// Usage: bot [bot_count] [duration_in_seconds].
+
+namespace {
+
+const int DEFAULT_BOT_COUNT = 100;
+const int64_t REPORT_PERIOD = 5000;
+
+// New bots are connected at most this often, in ms.
+const int64_t CONNECT_PERIOD = 10;
+
+bool global_stop_flag = false;
+
+void CtrlCHandler() {
+  global_stop_flag = true;
+}
+
+void PrintStats(const std::vector<std::unique_ptr<bm::Bot> >& bots,
+    int64_t period) {
+  double seconds = period / 1000.0;
+  int playing = 0;
+  int64_t total_rtt = 0;
+  int rtt_count = 0;
+  uint64_t total_snapshots = 0;
+  uint64_t total_received = 0;
+  uint64_t total_sent = 0;
+
+  printf("%-12s %8s %12s %10s %10s\n", "bot", "rtt, ms", "snapshots/s",
+      "in, KB/s", "out, KB/s");
+  for (auto& bot : bots) {
+    const bm::Bot::Stats& stats = bot->GetStats();
+    printf("%-12s %8ld %12.1f %10.2f %10.2f\n", bot->GetLogin().c_str(),
+        stats.rtt, stats.snapshot_count / seconds,
+        stats.received_bytes / 1024.0 / seconds,
+        stats.sent_bytes / 1024.0 / seconds);
+    if (bot->IsPlaying()) {
+      playing++;
+    }
+    if (stats.rtt >= 0) {
+      total_rtt += stats.rtt;
+      rtt_count++;
+    }
+    total_snapshots += stats.snapshot_count;
+    total_received += stats.received_bytes;
+    total_sent += stats.sent_bytes;
+    bot->ResetStats();
+  }
+
+  printf("%d of %d bots playing, average rtt: %.1f ms, "
+      "snapshots: %.1f/s per bot, in: %.2f KB/s, out: %.2f KB/s.\n",
+      playing, static_cast<int>(bots.size()),
+      rtt_count != 0 ? static_cast<double>(total_rtt) / rtt_count : 0.0,
+      bots.empty() ? 0.0 : total_snapshots / seconds / bots.size(),
+      total_received / 1024.0 / seconds, total_sent / 1024.0 / seconds);
+  fflush(stdout);
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  int bot_count = DEFAULT_BOT_COUNT;
+  int64_t duration = 0;
+  if (argc > 1) {
+    bot_count = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    duration = atoi(argv[2]) * 1000LL;
+  }
+  if (bot_count <= 0 || duration < 0) {
+    fprintf(stderr, "Usage: %s [bot_count] [duration_in_seconds]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  SetCtrlCHandler(&CtrlCHandler);
+  srand(static_cast<unsigned>(time(NULL)));
+
+  if (!bm::Config::GetInstance()->Initialize()) {
+    bm::Error::Print();
+    return EXIT_FAILURE;
+  }
+
+  bm::Enet enet;
+  if (!enet.Initialize()) {
+    bm::Error::Print();
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::unique_ptr<bm::Bot> > bots;
+
+  int64_t start_time = bm::Timestamp();
+  int64_t last_connect = 0;
+  int64_t last_report = start_time;
+
+  while (!global_stop_flag) {
+    int64_t time = bm::Timestamp();
+    if (duration != 0 && time - start_time >= duration) {
+      break;
+    }
+
+    // Don't flood the server with connections.
+    if (static_cast<int>(bots.size()) < bot_count &&
+        time - last_connect >= CONNECT_PERIOD) {
+      std::unique_ptr<bm::Bot> bot(new bm::Bot());
+      std::string login = "bot" + bm::IntToStr(bots.size());
+      if (!bot->Initialize(&enet, login)) {
+        bm::Error::Print();
+        return EXIT_FAILURE;
+      }
+      bots.push_back(std::move(bot));
+      last_connect = time;
+    }
+
+    for (auto& bot : bots) {
+      if (!bot->Tick()) {
+        bm::Error::Print();
+        return EXIT_FAILURE;
+      }
+    }
+
+    if (time - last_report >= REPORT_PERIOD) {
+      PrintStats(bots, time - last_report);
+      last_report = time;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  bots.clear();
+  printf("Bots finished.\n");
+
+  return EXIT_SUCCESS;
+}
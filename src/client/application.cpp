@@ -31,13 +31,29 @@
 
 #include "client/contact_listener.h"
 #include "client/entity.h"
+#include "client/prediction.h"
 #include "client/render_window.h"
 #include "client/resource_manager.h"
 #include "client/sprite.h"
+#include "client/terrain_cache.h"
 #include "client/utils.h"
 
 namespace bm {
 
+namespace {
+
+// Returns 'false' if there is no entity config.
+template<class T>
+bool GetSpriteId(const T* entity_config, uint32_t* sprite_id) {
+  if (entity_config == NULL) {
+    return false;
+  }
+  *sprite_id = entity_config->sprite_id;
+  return true;
+}
+
+}  // anonymous namespace
+
 Application::Application()
   : client_(NULL),
     peer_(NULL),
@@ -87,9 +103,16 @@ bool Application::Initialize() {
 
   max_player_misposition_ =
       Config::GetInstance()->GetClientConfig().max_player_misposition;
+  prediction_tolerance_ =
+      Config::GetInstance()->GetClientConfig().prediction_tolerance;
   interpolation_offset_ =
       Config::GetInstance()->GetClientConfig().interpolation_offset;
 
+  input_sequence_ = 0;
+  prediction_.Clear();
+
+  last_world_state_tick_ = 0;
+
   state_ = STATE_INITIALIZED;
   return true;
 }
@@ -110,8 +133,13 @@ bool Application::Run() {
   b2Vec2 position(client_options_.x, client_options_.y);
   Sprite* sprite = resource_manager_.CreateSprite("man");
   CHECK(sprite != NULL);
+  uint32_t config_id;
+  if (!Config::FindId(Config::GetInstance()->GetPlayersConfig(), "player",
+          &config_id)) {
+    return false;
+  }
   player_ = new ClientEntity(world_.GetBox2DWorld(), client_options_.id,
-    Entity::TYPE_PLAYER, "player", position, sprite);
+    Entity::TYPE_PLAYER, config_id, position, sprite);
   CHECK(player_ != NULL);
   const Config::ClientConfig& config =
     Config::GetInstance()->GetClientConfig();
@@ -131,7 +159,9 @@ bool Application::Run() {
     }
 
     SimulatePhysics();
-    Render();
+    if (!Render()) {
+      return false;
+    }
 
     int64_t current_time = GetServerTime();
     if (current_time - last_tick_ > 1000.0 / tick_rate_) {
@@ -175,17 +205,27 @@ bool Application::InitializeGraphics() {
   render_window_.Initialize();
 
   // FIXME(xairy): receive map name from server.
-  if (!map_.Load("data/maps/map.json")) {
+  if (!map_.Load("data/maps/map.bmap")) {
     return false;
   }
 
-  for (auto sprite_name : map_.GetTerrain().sprite_names) {
-    Sprite* sprite = resource_manager_.CreateSprite(sprite_name);
+  const Map::Terrain& terrain = map_.GetTerrain();
+  std::vector<uint32_t> sprite_ids(terrain.sprite_names.size());
+  for (size_t i = 0; i < terrain.sprite_names.size(); i++) {
+    if (!Config::FindId(Config::GetInstance()->GetSpritesConfig(),
+            terrain.sprite_names[i], &sprite_ids[i])) {
+      return false;
+    }
+  }
+
+  for (auto tile : terrain.tiles) {
+    Sprite* sprite = resource_manager_.CreateSprite(sprite_ids[tile]);
     CHECK(sprite != NULL);
     terrain_.push_back(sprite);
   }
 
   float block_size = map_.GetBlockSize();
+  world_.SetGridCellSize(block_size);
   int width = map_.GetWidth();
   int height = map_.GetHeight();
 
@@ -198,6 +238,10 @@ bool Application::InitializeGraphics() {
     }
   }
 
+  if (!terrain_cache_.Initialize(terrain_)) {
+    return false;
+  }
+
   return true;
 }
 
@@ -215,7 +259,7 @@ bool Application::InitializeNetwork() {
     return false;
   }
 
-  std::auto_ptr<ClientHost> client(enet_.CreateClientHost());
+  std::auto_ptr<ClientHost> client(enet_.CreateClientHost(CHANNEL_COUNT));
   if (client.get() == NULL) {
     return false;
   }
@@ -239,7 +283,8 @@ bool Application::Connect() {
   const Config::ClientConfig& config =
     Config::GetInstance()->GetClientConfig();
 
-  peer_ = client_->Connect(config.server_host, config.server_port);
+  peer_ = client_->Connect(config.server_host, config.server_port,
+      CHANNEL_COUNT);
   if (peer_ == NULL) {
     return false;
   }
@@ -277,9 +322,12 @@ bool Application::Synchronize() {
 
   CHECK(config.player_name.size() <= LoginData::MAX_LOGIN_LENGTH);
   LoginData login_data;
+  login_data.protocol_version = config.protocol_version;
   std::copy(config.player_name.begin(), config.player_name.end(),
       &login_data.login[0]);
   login_data.login[config.player_name.size()] = '\0';
+  login_data.room = config.server_room;
+  login_data.interpolation_offset = config.interpolation_offset;
   bool rv = SendPacket(peer_, Packet::TYPE_LOGIN, login_data, true);
   if (rv == false) {
     return false;
@@ -326,6 +374,18 @@ bool Application::Synchronize() {
       return false;
     }
 
+    if (client_options_.protocol_version == PROTOCOL_VERSION_COMPACT) {
+      rv = snapshot_codec_.Initialize(client_options_.position_step,
+          client_options_.position_bits);
+      if (rv == false) {
+        return false;
+      }
+    } else if (client_options_.protocol_version != PROTOCOL_VERSION_RAW) {
+      REPORT_ERROR("Unsupported protocol version %u.",
+          client_options_.protocol_version);
+      return false;
+    }
+
     break;
   }
 
@@ -556,6 +616,7 @@ bool Application::OnKeyEvent(const sf::Event& event) {
       return true;
   }
 
+  keyboard_event.sequence = ++input_sequence_;
   keyboard_events_.push_back(keyboard_event);
 
   return true;
@@ -621,18 +682,26 @@ bool Application::ProcessPacket(const std::vector<char>& buffer) {
         REPORT_ERROR("Incorrect entity packet format!");
         return false;
       }
-      if (snapshot.type == EntitySnapshot::ENTITY_TYPE_PLAYER) {
-        player_scores_[snapshot.id] = static_cast<int>(snapshot.data[2]);
-      }
-      if (snapshot.id == player_->GetId()) {
-        OnPlayerUpdate(&snapshot);
-        break;
+      OnEntitySnapshot(&snapshot);
+    } break;
+
+    case Packet::TYPE_WORLD_STATE: {
+      if (!OnWorldState(buffer)) {
+        return false;
       }
-      if (world_.GetEntity(snapshot.id) != NULL) {
-        OnEntityUpdate(&snapshot);
-      } else {
-        OnEntityAppearance(&snapshot);
+    } break;
+
+    case Packet::TYPE_ENTITY_DISAPPEARED: {
+      EntityDisappearance disappearance;
+      bool rv = ExtractPacketData<Packet::Type, EntityDisappearance>(
+          buffer, &disappearance);
+      if (rv == false) {
+        REPORT_ERROR("Incorrect entity packet format!");
+        return false;
       }
+      // The entity has left our area of interest, but it is still alive,
+      // so the score table is left untouched.
+      OnEntityRemoval(disappearance.id, disappearance.tick);
     } break;
 
     case Packet::TYPE_GAME_EVENT: {
@@ -651,12 +720,10 @@ bool Application::ProcessPacket(const std::vector<char>& buffer) {
         explosion->Play();
         explosions_.push_back(explosion);
       } else if (event.type == GameEvent::TYPE_ENTITY_DISAPPEARED) {
-        if (event.entity.type == EntitySnapshot::ENTITY_TYPE_PLAYER) {
+        if (OnEntityRemoval(event.entity.id, event.tick) &&
+            event.entity.type == EntitySnapshot::ENTITY_TYPE_PLAYER) {
           player_scores_.erase(event.entity.id);
         }
-        if (!OnEntityDisappearance(&event.entity)) {
-          return false;
-        }
       }
     } break;
 
@@ -685,73 +752,157 @@ bool Application::ProcessPacket(const std::vector<char>& buffer) {
   return true;
 }
 
+bool Application::OnWorldState(const std::vector<char>& buffer) {
+  CHECK(state_ == STATE_INITIALIZED);
+
+  WorldState state;
+  size_t skipped_count;
+  bool rv = ExtractWorldState(buffer, GetSnapshotCodec(), &baselines_,
+      &state, &world_state_snapshots_, &skipped_count);
+  if (rv == false) {
+    REPORT_ERROR("Incorrect world state packet format!");
+    return false;
+  }
+
+  // Removals older than this world state won't match the later ones,
+  // since the late world states are dropped by ENet.
+  if (state.tick > last_world_state_tick_) {
+    last_world_state_tick_ = state.tick;
+    auto itr = removal_ticks_.begin();
+    while (itr != removal_ticks_.end()) {
+      if (itr->second < state.tick) {
+        itr = removal_ticks_.erase(itr);
+      } else {
+        ++itr;
+      }
+    }
+  }
+
+  for (auto& snapshot : world_state_snapshots_) {
+    auto removal = removal_ticks_.find(snapshot.id);
+    if (removal != removal_ticks_.end() && removal->second >= state.tick) {
+      baselines_.erase(snapshot.id);
+      continue;
+    }
+    snapshot_ticks_[snapshot.id] = state.tick;
+    OnEntitySnapshot(&snapshot);
+  }
+
+  // A part with skipped records isn't acknowledged, otherwise the server
+  // would keep sending deltas against the snapshots that are missing.
+  if (state.part < SnapshotAcks::MAX_PARTS && skipped_count == 0) {
+    received_parts_[state.tick] |= 1u << state.part;
+  }
+  return true;
+}
+
+const SnapshotCodec* Application::GetSnapshotCodec() const {
+  if (client_options_.protocol_version == PROTOCOL_VERSION_COMPACT) {
+    return &snapshot_codec_;
+  }
+  return NULL;
+}
+
+void Application::OnEntitySnapshot(const EntitySnapshot* snapshot) {
+  CHECK(state_ == STATE_INITIALIZED);
+  CHECK(snapshot != NULL);
+
+  if (snapshot->type == EntitySnapshot::ENTITY_TYPE_PLAYER) {
+    player_scores_[snapshot->id] = static_cast<int>(snapshot->data[2]);
+  }
+  if (snapshot->id == player_->GetId()) {
+    OnPlayerUpdate(snapshot);
+    return;
+  }
+  if (world_.GetEntity(snapshot->id) != NULL) {
+    OnEntityUpdate(snapshot);
+    return;
+  }
+
+  // The server reuses the slot of a removed entity only after sending
+  // the removal, but the removal is reliable and may arrive after the
+  // snapshots of the new entity. So an older generation is evicted.
+  Entity* stale = world_.GetEntityInSlot(snapshot->id);
+  if (stale != NULL && stale != player_) {
+    OnEntityDisappearance(stale->GetId());
+  }
+  OnEntityAppearance(snapshot);
+}
+
 void Application::OnEntityAppearance(const EntitySnapshot* snapshot) {
   CHECK(state_ == STATE_INITIALIZED);
   CHECK(snapshot != NULL);
 
   uint32_t id = snapshot->id;
   b2Vec2 position = b2Vec2(snapshot->x, snapshot->y);
-  std::string entity_name = std::string(&snapshot->name[0]);
+  uint32_t config_id = snapshot->config_id;
+  Config* config = Config::GetInstance();
 
   Entity::Type type;
-  std::string sprite_name;
+  uint32_t sprite_id = 0;
+  bool known = false;
 
   switch (snapshot->type) {
     case EntitySnapshot::ENTITY_TYPE_ACTIVATOR: {
       type = Entity::TYPE_ACTIVATOR;
-      sprite_name = Config::GetInstance()->
-        GetActivatorsConfig().at(entity_name).sprite_name;
+      known = GetSpriteId(config->GetActivatorConfig(config_id), &sprite_id);
     } break;
 
     case EntitySnapshot::ENTITY_TYPE_CRITTER: {
       type = Entity::TYPE_CRITTER;
-      sprite_name = Config::GetInstance()->
-        GetCrittersConfig().at(entity_name).sprite_name;
+      known = GetSpriteId(config->GetCritterConfig(config_id), &sprite_id);
     } break;
 
     case EntitySnapshot::ENTITY_TYPE_DOOR: {
       type = Entity::TYPE_DOOR;
-      sprite_name = Config::GetInstance()->
-        GetDoorsConfig().at(entity_name).sprite_name;
+      known = GetSpriteId(config->GetDoorConfig(config_id), &sprite_id);
     } break;
 
     case EntitySnapshot::ENTITY_TYPE_KIT: {
       type = Entity::TYPE_KIT;
-      sprite_name = Config::GetInstance()->
-        GetKitsConfig().at(entity_name).sprite_name;
+      known = GetSpriteId(config->GetKitConfig(config_id), &sprite_id);
     } break;
 
     case EntitySnapshot::ENTITY_TYPE_PROJECTILE: {
       type = Entity::TYPE_PROJECTILE;
-      sprite_name = Config::GetInstance()->
-        GetProjectilesConfig().at(entity_name).sprite_name;
+      known = GetSpriteId(config->GetProjectileConfig(config_id), &sprite_id);
     } break;
 
     case EntitySnapshot::ENTITY_TYPE_PLAYER: {
       type = Entity::TYPE_PLAYER;
-      sprite_name = Config::GetInstance()->
-        GetPlayersConfig().at(entity_name).sprite_name;
+      known = GetSpriteId(config->GetPlayerConfig(config_id), &sprite_id);
     } break;
 
     case EntitySnapshot::ENTITY_TYPE_WALL: {
       type = Entity::TYPE_WALL;
-      sprite_name = Config::GetInstance()->
-        GetWallsConfig().at(entity_name).sprite_name;
+      known = GetSpriteId(config->GetWallConfig(config_id), &sprite_id);
     } break;
 
     default:
       CHECK(false);  // Unreachable.
   }
 
-  Sprite* sprite = resource_manager_.CreateSprite(sprite_name);
+  if (!known) {
+    REPORT_WARNING("Unknown config %u of entity %u.", config_id, id);
+    return;
+  }
+
+  Sprite* sprite = resource_manager_.CreateSprite(sprite_id);
   CHECK(sprite != NULL);
 
   ClientEntity* entity = new ClientEntity(world_.GetBox2DWorld(),
-      id, type, entity_name, position, sprite);
+      id, type, config_id, position, sprite);
   CHECK(entity != NULL);
 
   entity->SetRotation(snapshot->angle);
+  if (!entity->IsStatic()) {
+    entity->AddInterpolationFrame(position, snapshot->angle, snapshot->time,
+        interpolation_offset_);
+  }
   world_.AddEntity(id, entity);
+  if (entity->IsStatic()) {
+    render_window_.InvalidateStaticEntities();
+  }
 }
 
 void Application::OnEntityUpdate(const EntitySnapshot* snapshot) {
@@ -772,6 +923,8 @@ void Application::OnEntityUpdate(const EntitySnapshot* snapshot) {
     CHECK(entity->IsStatic() == true);
     entity->SetPosition(position);
     entity->SetRotation(snapshot->angle);
+    world_.UpdateGrid(entity);
+    render_window_.InvalidateStaticEntities();
   } else {
     CHECK(entity->IsStatic() == false);
     int64_t server_time = GetServerTime();
@@ -779,12 +932,8 @@ void Application::OnEntityUpdate(const EntitySnapshot* snapshot) {
       // Ignore snapshots that are too old.
       return;
     }
-    entity->SetInterpolationPosition(position, snapshot->time,
-        interpolation_offset_, server_time);
-    entity->SetRotation(snapshot->angle);
-    // TODO(xairy): use SetInterpolationRotation.
-    // dynamic_entities_[snapshot->id]->SetInterpolationRotation(
-    //   snapshot->angle, snapshot->time, interpolation_offset_, server_time);
+    entity->AddInterpolationFrame(position, snapshot->angle, snapshot->time,
+        interpolation_offset_);
   }
 
   if (snapshot->type == EntitySnapshot::ENTITY_TYPE_PLAYER && !entity->HasCaption()) {
@@ -800,30 +949,58 @@ void Application::OnPlayerUpdate(const EntitySnapshot* snapshot) {
   player_energy_ = snapshot->data[1];
 
   b2Vec2 position = b2Vec2(snapshot->x, snapshot->y);
-  b2Vec2 distance = player_->GetPosition() - position;
+  uint32_t sequence = static_cast<uint32_t>(snapshot->data[3]);
+
+  PredictionHistory::State acked;
+  if (!prediction_.Acknowledge(sequence, snapshot->time, &acked)) {
+    // Either an outdated snapshot or nothing has been predicted yet.
+    if (prediction_.GetSize() == 0) {
+      b2Vec2 distance = player_->GetPosition() - position;
+      if (Length(distance) > max_player_misposition_) {
+        player_->SetPosition(position);
+      }
+    }
+    return;
+  }
 
-  if (Length(distance) > max_player_misposition_) {
-    player_->SetPosition(position);
+  b2Vec2 distance = acked.position - position;
+  if (Length(distance) > prediction_tolerance_) {
+    ReplayPrediction(position);
   }
 }
 
-bool Application::OnEntityDisappearance(const EntitySnapshot* snapshot) {
+bool Application::OnEntityRemoval(uint32_t id, uint32_t tick) {
+  CHECK(state_ == STATE_INITIALIZED);
+
+  auto seen = snapshot_ticks_.find(id);
+  if (seen != snapshot_ticks_.end() && seen->second > tick) {
+    return false;
+  }
+  if (tick >= last_world_state_tick_) {
+    removal_ticks_[id] = tick;
+  }
+  OnEntityDisappearance(id);
+  return true;
+}
+
+void Application::OnEntityDisappearance(uint32_t id) {
   CHECK(state_ == STATE_INITIALIZED);
-  CHECK(snapshot != NULL);
 
-  auto i = world_.GetDynamicEntities()->find(snapshot->id);
+  baselines_.erase(id);
+  snapshot_ticks_.erase(id);
+
+  auto i = world_.GetDynamicEntities()->find(id);
   if (i != world_.GetDynamicEntities()->end()) {
     delete i->second;
     world_.RemoveEntity(i->first);
   }
 
-  i = world_.GetStaticEntities()->find(snapshot->id);
+  i = world_.GetStaticEntities()->find(id);
   if (i != world_.GetStaticEntities()->end()) {
     delete i->second;
     world_.RemoveEntity(i->first);
+    render_window_.InvalidateStaticEntities();
   }
-
-  return true;
 }
 
 void Application::SimulatePhysics() {
@@ -841,14 +1018,67 @@ void Application::SimulatePhysics() {
       + keyboard_state_.down * (client_options_.speed);
     player_->SetImpulse(player_->GetMass() * velocity);
 
-    int32_t velocity_iterations = 6;
-    int32_t position_iterations = 2;
-    world_.GetBox2DWorld()->Step(static_cast<float>(delta_time) / 1000,
-      velocity_iterations, position_iterations);
+    int64_t server_time = GetServerTime();
+    for (auto itr : *world_.GetDynamicEntities()) {
+      ClientEntity* entity = static_cast<ClientEntity*>(itr.second);
+      if (entity != player_) {
+        entity->UpdateInterpolation(server_time);
+      }
+    }
+
+    StepPhysics(delta_time);
+    world_.UpdateGrid();
+
+    PredictionHistory::State state;
+    state.time = server_time;
+    state.delta_time = delta_time;
+    state.sequence = input_sequence_;
+    state.velocity = velocity;
+    state.position = player_->GetPosition();
+    prediction_.Add(state);
   }
 }
 
-void Application::Render() {
+void Application::StepPhysics(int64_t delta_time) {
+  int32_t velocity_iterations = 6;
+  int32_t position_iterations = 2;
+  world_.GetBox2DWorld()->Step(static_cast<float>(delta_time) / 1000,
+    velocity_iterations, position_iterations);
+}
+
+void Application::ReplayPrediction(const b2Vec2& position) {
+  CHECK(state_ == STATE_INITIALIZED);
+
+  replay_bodies_.clear();
+  for (auto itr : *world_.GetDynamicEntities()) {
+    Entity* entity = itr.second;
+    if (entity != player_) {
+      SavedBody body;
+      body.entity = entity;
+      body.position = entity->GetPosition();
+      body.velocity = entity->GetVelocity();
+      replay_bodies_.push_back(body);
+    }
+  }
+
+  // Only the player collides with anything on the client, so the other
+  // entities can't affect the replayed steps.
+  player_->SetPosition(position);
+  for (size_t i = 0; i < prediction_.GetSize(); i++) {
+    PredictionHistory::State* state = prediction_.Get(i);
+    player_->SetImpulse(player_->GetMass() * state->velocity);
+    StepPhysics(state->delta_time);
+    state->position = player_->GetPosition();
+  }
+
+  for (auto& body : replay_bodies_) {
+    body.entity->SetPosition(body.position);
+    body.entity->SetVelocity(body.velocity);
+  }
+  world_.UpdateGrid();
+}
+
+bool Application::Render() {
   CHECK(state_ == STATE_INITIALIZED);
 
   render_window_.StartFrame();
@@ -857,7 +1087,9 @@ void Application::Render() {
     b2Vec2 position = player_->GetPosition();
     render_window_.SetViewCenter(sf::Vector2f(position.x, position.y));
 
-    render_window_.RenderSprites(terrain_);
+    if (!render_window_.RenderTerrain(&terrain_cache_)) {
+      return false;
+    }
 
     // FIXME(xairy): madness.
     std::list<Sprite*>::iterator it2;
@@ -893,6 +1125,7 @@ void Application::Render() {
   }
 
   render_window_.EndFrame();
+  return true;
 }
 
 bool Application::SendInputEvents() {
@@ -928,6 +1161,19 @@ bool Application::SendInputEvents() {
     return false;
   }
 
+  // Acknowledge the received snapshots so that the server could use them
+  // as delta baselines.
+  for (auto itr : received_parts_) {
+    SnapshotAck ack;
+    ack.tick = itr.first;
+    ack.parts = itr.second;
+    rv = SendPacket(peer_, Packet::TYPE_SNAPSHOT_ACK, ack);
+    if (rv == false) {
+      return false;
+    }
+  }
+  received_parts_.clear();
+
   return true;
 }
 
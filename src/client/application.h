@@ -17,15 +17,20 @@
 #include "net/enet.h"
 
 #include "engine/config.h"
+#include "engine/delta.h"
 #include "engine/map.h"
 #include "engine/protocol.h"
+#include "engine/snapshot_codec.h"
+#include "engine/world_state.h"
 #include "engine/world.h"
 
 #include "client/contact_listener.h"
 #include "client/entity.h"
+#include "client/prediction.h"
 #include "client/render_window.h"
 #include "client/resource_manager.h"
 #include "client/sprite.h"
+#include "client/terrain_cache.h"
 
 namespace bm {
 
@@ -59,14 +64,30 @@ class Application {
   bool PumpPackets();
   bool ProcessPacket(const std::vector<char>& buffer);
 
+  // Restores the entity snapshots from the deltas and their baselines.
+  bool OnWorldState(const std::vector<char>& buffer);
+
+  // Returns NULL if the server sends raw snapshots.
+  const SnapshotCodec* GetSnapshotCodec() const;
+
+  void OnEntitySnapshot(const EntitySnapshot* snapshot);
   void OnEntityAppearance(const EntitySnapshot* snapshot);
   void OnEntityUpdate(const EntitySnapshot* snapshot);
+  // Reconciles the predicted player position with the server one.
   void OnPlayerUpdate(const EntitySnapshot* snapshot);
-  bool OnEntityDisappearance(const EntitySnapshot* snapshot);
+  // Removes the entity unless a world state newer than 'tick' has already
+  // shown it. Returns 'true' if the entity has been removed.
+  bool OnEntityRemoval(uint32_t id, uint32_t tick);
+  void OnEntityDisappearance(uint32_t id);
 
   void SimulatePhysics();
+  void StepPhysics(int64_t delta_time);
+
+  // Moves the player to 'position' and replays the pending predicted
+  // steps from there. The other entities are left in place.
+  void ReplayPrediction(const b2Vec2& position);
 
-  void Render();
+  bool Render();
 
   // Sends input events to the server and
   // clears the input event queues afterwards.
@@ -105,6 +126,7 @@ class Application {
 
   Map map_;
   std::vector<Sprite*> terrain_;
+  TerrainCache terrain_cache_;
 
   bool show_score_table_;
   std::map<uint32_t, int> player_scores_;
@@ -114,12 +136,40 @@ class Application {
   int player_energy_;
 
   float max_player_misposition_;
+  float prediction_tolerance_;
   int64_t interpolation_offset_;
 
+  // Snapshots restored from deltas, used as baselines for the next ones.
+  std::map<uint32_t, SnapshotHistory> baselines_;
+  // World state packets received since the last ack, see 'SnapshotAck'.
+  std::map<uint32_t, uint32_t> received_parts_;
+  std::vector<EntitySnapshot> world_state_snapshots_;
+
+  // World states and removals come through different channels, so either
+  // may be late. The snapshots from the world states not newer than the
+  // removal of an entity are dropped, and so are the removals older than
+  // the last world state the entity was in.
+  uint32_t last_world_state_tick_;
+  std::map<uint32_t, uint32_t> removal_ticks_;
+  std::map<uint32_t, uint32_t> snapshot_ticks_;
+
+  SnapshotCodec snapshot_codec_;
+
   // Input events since the last tick.
   std::vector<KeyboardEvent> keyboard_events_;
   std::vector<MouseEvent> mouse_events_;
 
+  // Sequence of the last keyboard event.
+  uint32_t input_sequence_;
+  PredictionHistory prediction_;
+
+  struct SavedBody {
+    Entity* entity;
+    b2Vec2 position;
+    b2Vec2 velocity;
+  };
+  std::vector<SavedBody> replay_bodies_;
+
   struct KeyboardState {
     KeyboardState() : up(false), down(false), right(false), left(false) { }
 
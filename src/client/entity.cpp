@@ -21,15 +21,26 @@
 
 namespace bm {
 
+namespace {
+
+// For how long an entity keeps moving after the last snapshot, in ms.
+const int64_t MAX_EXTRAPOLATION = 100;
+
+}  // anonymous namespace
+
 ClientEntity::ClientEntity(
   b2World* world,
   uint32_t id,
   Type type,
-  const std::string& entity_name,
+  uint32_t config_id,
   b2Vec2 position,
   Sprite* sprite
-) : Entity(world, id, type, entity_name, position, FILTER_DEFAULT, FILTER_ALL),
+) : Entity(world, id, type, config_id, position, FILTER_DEFAULT, FILTER_ALL),
     sprite_(sprite),
+    position_interpolator_(0, interpolator::MODE_HERMITE,
+        MAX_EXTRAPOLATION),
+    rotation_interpolator_(0, interpolator::MODE_LINEAR, 0),
+    last_angle_(0.0f),
     caption_visible_(false) {
   // XXX(xairy): create Sprite here?
 }
@@ -51,17 +62,36 @@ sf::Text* ClientEntity::GetCaption() {
   return &caption_text_;
 }
 
-void ClientEntity::SetInterpolationPosition(
+void ClientEntity::AddInterpolationFrame(
   const b2Vec2& position,
+  float angle,
   int64_t snapshot_time,
-  int64_t interpolation_offset,
-  int64_t server_time
+  int64_t interpolation_offset
 ) {
-  CHECK(server_time - interpolation_offset < snapshot_time);
-  b2Vec2 impulse = GetMass() /
-      (snapshot_time - (server_time - interpolation_offset)) * 1000 *
-      (b2Vec2(position.x, position.y) - GetPosition());
-  SetImpulse(impulse);
+  if (position_interpolator_.GetFrameCount() != 0 &&
+      snapshot_time <= position_interpolator_.GetLastTime()) {
+    return;
+  }
+  if (rotation_interpolator_.GetFrameCount() != 0) {
+    angle = last_angle_ + remainderf(angle - last_angle_,
+        2 * static_cast<float>(M_PI));
+  }
+  last_angle_ = angle;
+
+  position_interpolator_.SetTimeOffset(interpolation_offset);
+  rotation_interpolator_.SetTimeOffset(interpolation_offset);
+  position_interpolator_.Push(position, snapshot_time);
+  rotation_interpolator_.Push(angle, snapshot_time);
+}
+
+void ClientEntity::UpdateInterpolation(int64_t server_time) {
+  if (position_interpolator_.GetFrameCount() == 0) {
+    return;
+  }
+  SetPosition(position_interpolator_.Interpolate(server_time));
+  SetRotation(rotation_interpolator_.Interpolate(server_time));
+  // The entity is moved only by the interpolation.
+  SetVelocity(b2Vec2(0.0f, 0.0f));
 }
 
 void ClientEntity::EnableCaption(
@@ -14,6 +14,8 @@
 #include "engine/body.h"
 #include "engine/entity.h"
 
+#include "interpolator/interpolator.h"
+
 #include "client/sprite.h"
 
 namespace bm {
@@ -24,7 +26,7 @@ class ClientEntity : public Entity {
     b2World* world,
     uint32_t id,
     Type type,
-    const std::string& entity_name,
+    uint32_t config_id,
     b2Vec2 position,
     Sprite* sprite);
   ~ClientEntity();
@@ -34,16 +36,27 @@ class ClientEntity : public Entity {
   bool HasCaption();
   sf::Text* GetCaption();
 
-  // Makes object to start moving towards 'position' to be there when
-  // current time - 'interpolation_offset' == 'time'.
-  void SetInterpolationPosition(const b2Vec2& position,
-      int64_t snapshot_time, int64_t interpolation_offset, int64_t server_time);
+  // Adds the state of the entity at 'snapshot_time'. The entity is shown
+  // as it was 'interpolation_offset' ms ago.
+  // Snapshots older than the last one are ignored.
+  void AddInterpolationFrame(const b2Vec2& position, float angle,
+      int64_t snapshot_time, int64_t interpolation_offset);
+
+  // Moves the entity to its interpolated position and rotation. If no new
+  // snapshots arrive, e.g. because they were lost, the entity keeps
+  // moving for a while and then stops.
+  void UpdateInterpolation(int64_t server_time);
 
   void EnableCaption(const std::string& caption, const sf::Font& font);
 
  private:
   Sprite* sprite_;
 
+  interpolator::Interpolator<b2Vec2, int64_t> position_interpolator_;
+  // The angles are unwrapped to be interpolated along the shortest arc.
+  interpolator::Interpolator<float, int64_t> rotation_interpolator_;
+  float last_angle_;
+
   bool caption_visible_;
   sf::Text caption_text_;
 };
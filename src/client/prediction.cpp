@@ -0,0 +1,64 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "client/prediction.h"
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+namespace {
+
+// Compares sequences taking the wrap around into account.
+bool IsSequenceBefore(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+
+}  // anonymous namespace
+
+PredictionHistory::PredictionHistory() : first_(0), size_(0) { }
+
+void PredictionHistory::Clear() {
+  first_ = 0;
+  size_ = 0;
+}
+
+void PredictionHistory::Add(const State& state) {
+  if (size_ == SIZE) {
+    first_ = (first_ + 1) % SIZE;
+    size_--;
+  }
+  states_[(first_ + size_) % SIZE] = state;
+  size_++;
+}
+
+bool PredictionHistory::Acknowledge(uint32_t sequence, int64_t time,
+    State* acked) {
+  CHECK(acked != NULL);
+  bool dropped = false;
+  while (size_ != 0) {
+    const State& state = states_[first_];
+    bool covered = IsSequenceBefore(state.sequence, sequence) ||
+        (state.sequence == sequence && state.time <= time);
+    if (!covered) {
+      break;
+    }
+    *acked = state;
+    dropped = true;
+    first_ = (first_ + 1) % SIZE;
+    size_--;
+  }
+  return dropped;
+}
+
+size_t PredictionHistory::GetSize() const {
+  return size_;
+}
+
+PredictionHistory::State* PredictionHistory::Get(size_t index) {
+  CHECK(index < size_);
+  return &states_[(first_ + index) % SIZE];
+}
+
+}  // namespace bm
@@ -0,0 +1,59 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef CLIENT_PREDICTION_H_
+#define CLIENT_PREDICTION_H_
+
+#include <Box2D/Box2D.h>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+// Local player states predicted by the client, one per physics step.
+// A state is kept until the server acknowledges the keyboard event
+// the step was simulated with, so that the pending steps can be replayed
+// from an authoritative position. The oldest states are overwritten
+// when the history is full.
+class PredictionHistory {
+ public:
+  static const size_t SIZE = 256;
+
+  struct State {
+    // Approximate server time at the end of the step.
+    int64_t time;
+    int64_t delta_time;
+    // Sequence of the last keyboard event applied before the step.
+    uint32_t sequence;
+    b2Vec2 velocity;
+    // Position of the player after the step.
+    b2Vec2 position;
+  };
+
+  PredictionHistory();
+
+  void Clear();
+  void Add(const State& state);
+
+  // Drops the states covered by a server snapshot taken at 'time' after
+  // processing the keyboard event 'sequence': the states simulated with
+  // earlier events and the ones simulated with 'sequence' up to 'time'.
+  // Stores the last dropped state in 'acked'.
+  // Returns 'false' if no states were dropped.
+  bool Acknowledge(uint32_t sequence, int64_t time, State* acked);
+
+  // Pending states, from the oldest one.
+  size_t GetSize() const;
+  State* Get(size_t index);
+
+ private:
+  State states_[SIZE];
+  size_t first_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(PredictionHistory);
+};
+
+}  // namespace bm
+
+#endif  // CLIENT_PREDICTION_H_
@@ -18,11 +18,14 @@
 #include "client/entity.h"
 #include "client/resource_manager.h"
 #include "client/sprite.h"
+#include "client/sprite_batch.h"
+#include "client/terrain_cache.h"
 #include "client/utils.h"
 
 namespace bm {
 
-RenderWindow::RenderWindow() : state_(STATE_FINALIZED) { }
+RenderWindow::RenderWindow()
+  : static_batch_valid_(false), state_(STATE_FINALIZED) { }
 
 RenderWindow::~RenderWindow() {
   if (state_ == STATE_FINALIZED) {
@@ -80,42 +83,60 @@ void RenderWindow::RenderSprite(Sprite* sprite) {
   sprite->Render(render_window_);
 }
 
-void RenderWindow::RenderSprites(const std::vector<Sprite*>& sprites) {
+bool RenderWindow::RenderTerrain(TerrainCache* terrain) {
   CHECK(state_ == STATE_INITIALIZED);
-  for (auto sprite : sprites) {
-    RenderSprite(sprite);
-  }
+  return terrain->Render(render_window_, view_);
 }
 
 void RenderWindow::RenderEntity(ClientEntity* entity) {
   CHECK(state_ == STATE_INITIALIZED);
-
-  b2Vec2 b2p = entity->GetPosition();
-  sf::Vector2f position = Round(sf::Vector2f(b2p.x, b2p.y));
-
-  Sprite* sprite = entity->GetSprite();
-  sprite->SetPosition(position);
-  sprite->SetRotation(entity->GetRotation() / static_cast<float>(M_PI) * 180.0f);
-  RenderSprite(sprite);
-
-  if (entity->HasCaption()) {
-    sf::Vector2f caption_offset = sf::Vector2f(0.0f, -25.0f);
-    sf::Vector2f caption_pos = position + caption_offset;
-    entity->GetCaption()->setPosition(caption_pos.x, caption_pos.y);
-    render_window_->draw(*entity->GetCaption());
-  }
+  PlaceSprite(entity);
+  RenderSprite(entity->GetSprite());
+  RenderCaption(entity);
 }
 
 void RenderWindow::RenderWorld(World* world) {
   CHECK(state_ == STATE_INITIALIZED);
-  for (auto i : *world->GetStaticEntities()) {
+
+  if (!static_batch_valid_) {
+    static_batch_.Clear();
+    animated_entities_.clear();
+    for (auto i : *world->GetStaticEntities()) {
       ClientEntity* entity = static_cast<ClientEntity*>(i.second);
-      RenderEntity(entity);
+      if (entity->GetSprite()->IsAnimated()) {
+        animated_entities_.push_back(entity);
+        continue;
+      }
+      PlaceSprite(entity);
+      static_batch_.AddSprite(entity->GetSprite());
     }
-    for (auto i : *world->GetDynamicEntities()) {
-      ClientEntity* entity = static_cast<ClientEntity*>(i.second);
-      RenderEntity(entity);
+    static_batch_valid_ = true;
+  }
+
+  dynamic_batch_.Clear();
+  captioned_entities_.clear();
+  for (auto entity : animated_entities_) {
+    PlaceSprite(entity);
+    dynamic_batch_.AddSprite(entity->GetSprite());
+  }
+  for (auto i : *world->GetDynamicEntities()) {
+    ClientEntity* entity = static_cast<ClientEntity*>(i.second);
+    PlaceSprite(entity);
+    dynamic_batch_.AddSprite(entity->GetSprite());
+    if (entity->HasCaption()) {
+      captioned_entities_.push_back(entity);
     }
+  }
+
+  static_batch_.Render(render_window_);
+  dynamic_batch_.Render(render_window_);
+  for (auto entity : captioned_entities_) {
+    RenderCaption(entity);
+  }
+}
+
+void RenderWindow::InvalidateStaticEntities() {
+  static_batch_valid_ = false;
 }
 
 void RenderWindow::RenderPlayerStats(int health, int max_health,
@@ -198,34 +219,21 @@ void RenderWindow::RenderMinimap(World* world, ClientEntity* player) {
   compass_border.setFillColor(sf::Color(0xFF, 0xFF, 0xFF, 0x00));
   render_window_->draw(compass_border, top_right_transform);
 
-  for (auto i : *world->GetDynamicEntities()) {
-    Entity* obj = i.second;
-
-    b2Vec2 obj_pos = obj->GetPosition();
-    b2Vec2 player_pos = player->GetPosition();
-    b2Vec2 rel = obj_pos - player_pos;
-    if (Length(rel) < compass_range) {
-      rel = (compass_radius / compass_range) * rel;
-      sf::CircleShape circle(1.0f);
-      circle.setPosition(compass_center + sf::Vector2f(rel.x, rel.y));
-      circle.setFillColor(sf::Color(0xFF, 0x00, 0x00, 0xFF));
-      render_window_->draw(circle, top_right_transform);
-    }
-  }
-
-  for (auto i : *world->GetStaticEntities()) {
-    Entity* obj = i.second;
+  b2Vec2 player_pos = player->GetPosition();
+  minimap_entities_.clear();
+  world->QueryEntities(player_pos, compass_range, &minimap_entities_);
 
-    b2Vec2 obj_pos = obj->GetPosition();
-    b2Vec2 player_pos = player->GetPosition();
-    b2Vec2 rel = obj_pos - player_pos;
-    if (Length(rel) < compass_range) {
-      rel = (compass_radius / compass_range) * rel;
-      sf::CircleShape circle(1.0f);
-      circle.setPosition(compass_center + sf::Vector2f(rel.x, rel.y));
+  for (auto obj : minimap_entities_) {
+    b2Vec2 rel = obj->GetPosition() - player_pos;
+    rel = (compass_radius / compass_range) * rel;
+    sf::CircleShape circle(1.0f);
+    circle.setPosition(compass_center + sf::Vector2f(rel.x, rel.y));
+    if (obj->IsStatic()) {
       circle.setFillColor(sf::Color(0x00, 0xFF, 0x00, 0xFF));
-      render_window_->draw(circle, top_right_transform);
+    } else {
+      circle.setFillColor(sf::Color(0xFF, 0x00, 0x00, 0xFF));
     }
+    render_window_->draw(circle, top_right_transform);
   }
 
   sf::CircleShape circle(1.0f);
@@ -321,4 +329,25 @@ bool RenderWindow::PollEvent(sf::Event* event) {
   return render_window_->pollEvent(*event);
 }
 
+void RenderWindow::PlaceSprite(ClientEntity* entity) {
+  b2Vec2 b2p = entity->GetPosition();
+  sf::Vector2f position = Round(sf::Vector2f(b2p.x, b2p.y));
+
+  Sprite* sprite = entity->GetSprite();
+  sprite->SetPosition(position);
+  sprite->SetRotation(entity->GetRotation() / static_cast<float>(M_PI) * 180.0f);
+}
+
+void RenderWindow::RenderCaption(ClientEntity* entity) {
+  if (!entity->HasCaption()) {
+    return;
+  }
+  b2Vec2 b2p = entity->GetPosition();
+  sf::Vector2f position = Round(sf::Vector2f(b2p.x, b2p.y));
+  sf::Vector2f caption_offset = sf::Vector2f(0.0f, -25.0f);
+  sf::Vector2f caption_pos = position + caption_offset;
+  entity->GetCaption()->setPosition(caption_pos.x, caption_pos.y);
+  render_window_->draw(*entity->GetCaption());
+}
+
 }  // namespace bm
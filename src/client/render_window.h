@@ -18,6 +18,8 @@
 #include "client/entity.h"
 #include "client/resource_manager.h"
 #include "client/sprite.h"
+#include "client/sprite_batch.h"
+#include "client/terrain_cache.h"
 
 namespace bm {
 
@@ -34,10 +36,15 @@ class RenderWindow {
   void SetViewCenter(sf::Vector2f location);
 
   void RenderSprite(Sprite* sprite);
-  void RenderSprites(const std::vector<Sprite*>& sprites);
+  // Returns 'false' if a chunk texture can't be created.
+  bool RenderTerrain(TerrainCache* terrain);
 
   void RenderEntity(ClientEntity* entity);
+
+  // The static entities are batched once and rebatched only after
+  // 'InvalidateStaticEntities()', the dynamic ones are batched every frame.
   void RenderWorld(World* world);
+  void InvalidateStaticEntities();
 
   void RenderPlayerStats(
     int health, int max_health,
@@ -59,10 +66,23 @@ class RenderWindow {
   bool PollEvent(sf::Event* event);
 
  private:
+  // Moves the sprite of 'entity' to the entity.
+  void PlaceSprite(ClientEntity* entity);
+  void RenderCaption(ClientEntity* entity);
   sf::RenderWindow* render_window_;
   sf::View view_;
   sf::Font* font_;
 
+  std::vector<Entity*> minimap_entities_;
+
+  SpriteBatch static_batch_;
+  bool static_batch_valid_;
+  // Static entities with animated sprites, which can't be cached.
+  std::vector<ClientEntity*> animated_entities_;
+
+  SpriteBatch dynamic_batch_;
+  std::vector<ClientEntity*> captioned_entities_;
+
   enum {
     STATE_FINALIZED,
     STATE_INITIALIZED
@@ -2,12 +2,12 @@
 
 #include "client/resource_manager.h"
 
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "base/macros.h"
+#include "base/pstdint.h"
 
 #include "engine/config.h"
 
@@ -19,41 +19,51 @@ namespace bm {
 ResourceManager::ResourceManager() { }
 
 ResourceManager::~ResourceManager() {
-  for (auto i = textures_.begin(); i != textures_.end(); ++i) {
-    delete i->second;
+  for (auto texture : textures_) {
+    if (texture != NULL) delete texture;
   }
 }
 
-Sprite* ResourceManager::CreateSprite(const std::string& id) {
-  if (Config::GetInstance()->GetSpritesConfig().count(id) == 0) {
+Sprite* ResourceManager::CreateSprite(const std::string& name) {
+  uint32_t sprite_id;
+  if (!Config::FindId(Config::GetInstance()->GetSpritesConfig(), name,
+          &sprite_id)) {
     return NULL;
   }
-  const Config::SpriteConfig& config =
-    Config::GetInstance()->GetSpritesConfig().at(id);
+  return CreateSprite(sprite_id);
+}
 
-  TextureAtlas* texture = LoadTexture(config.texture_name);
+Sprite* ResourceManager::CreateSprite(uint32_t sprite_id) {
+  const Config::SpriteConfig* config =
+    Config::GetInstance()->GetSpriteConfig(sprite_id);
+  if (config == NULL) {
+    return NULL;
+  }
+
+  TextureAtlas* texture = LoadTexture(config->texture_id);
   if (texture == NULL) {
     return NULL;
   }
 
   Sprite* sprite = new Sprite();
   CHECK(sprite != NULL);
-  sprite->Initialize(texture, config.mode.tiles,
-      config.mode.timeout, config.mode.cyclic);
+  sprite->Initialize(texture, config->mode.tiles,
+      config->mode.timeout, config->mode.cyclic);
 
   return sprite;
 }
 
-TextureAtlas* ResourceManager::LoadTexture(const std::string& id) {
-  if (textures_.count(id) != 0) {
-    return textures_[id];
+TextureAtlas* ResourceManager::LoadTexture(uint32_t texture_id) {
+  if (texture_id < textures_.size() && textures_[texture_id] != NULL) {
+    return textures_[texture_id];
   }
 
-  if (Config::GetInstance()->GetTexturesConfig().count(id) == 0) {
+  const Config::TextureConfig* texture_config =
+    Config::GetInstance()->GetTextureConfig(texture_id);
+  if (texture_config == NULL) {
     return NULL;
   }
-  const Config::TextureConfig& config =
-    Config::GetInstance()->GetTexturesConfig().at(id);
+  const Config::TextureConfig& config = *texture_config;
 
   std::auto_ptr<TextureAtlas> texture(new TextureAtlas());
   CHECK(texture.get() != NULL);
@@ -76,7 +86,10 @@ TextureAtlas* ResourceManager::LoadTexture(const std::string& id) {
 
   CHECK(texture->GetTileCount() > 0);
 
-  textures_[id] = texture.get();
+  if (texture_id >= textures_.size()) {
+    textures_.resize(texture_id + 1, NULL);
+  }
+  textures_[texture_id] = texture.get();
   return texture.release();
 }
 
@@ -3,8 +3,11 @@
 #ifndef CLIENT_RESOURCE_MANAGER_H_
 #define CLIENT_RESOURCE_MANAGER_H_
 
-#include <map>
 #include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
 
 #include "client/sprite.h"
 #include "client/texture_atlas.h"
@@ -16,12 +19,15 @@ class ResourceManager {
   ResourceManager();
   ~ResourceManager();
 
-  Sprite* CreateSprite(const std::string& id);
+  // Returns NULL if there is no such sprite or its texture can't be loaded.
+  Sprite* CreateSprite(const std::string& name);
+  Sprite* CreateSprite(uint32_t sprite_id);
 
  private:
-  TextureAtlas* LoadTexture(const std::string& id);
+  TextureAtlas* LoadTexture(uint32_t texture_id);
 
-  std::map<std::string, TextureAtlas*> textures_;
+  // Indexed by the texture ids, NULL for the textures not loaded yet.
+  std::vector<TextureAtlas*> textures_;
 
   DISALLOW_COPY_AND_ASSIGN(ResourceManager);
 };
@@ -88,6 +88,45 @@ void Sprite::Render(sf::RenderWindow* render_window) {
   render_window->draw(*_frames[_current_frame]);
 }
 
+void Sprite::GetQuad(sf::Vertex* quad) {
+  CHECK(_state == STATE_PLAYING || _state == STATE_STOPPED);
+  DCHECK(_frames[_current_frame] != NULL);
+  UpdateCurrentFrame();
+  const sf::Sprite* frame = _frames[_current_frame];
+  const sf::Transform& transform = frame->getTransform();
+  const sf::IntRect& rect = frame->getTextureRect();
+
+  float width = static_cast<float>(rect.width);
+  float height = static_cast<float>(rect.height);
+  float left = static_cast<float>(rect.left);
+  float top = static_cast<float>(rect.top);
+
+  quad[0] = sf::Vertex(transform.transformPoint(0.0f, 0.0f),
+      sf::Vector2f(left, top));
+  quad[1] = sf::Vertex(transform.transformPoint(width, 0.0f),
+      sf::Vector2f(left + width, top));
+  quad[2] = sf::Vertex(transform.transformPoint(width, height),
+      sf::Vector2f(left + width, top + height));
+  quad[3] = sf::Vertex(transform.transformPoint(0.0f, height),
+      sf::Vector2f(left, top + height));
+}
+
+const sf::Texture* Sprite::GetTexture() const {
+  CHECK(_state == STATE_PLAYING || _state == STATE_STOPPED);
+  return _texture->GetTexture();
+}
+
+sf::FloatRect Sprite::GetBounds() const {
+  CHECK(_state == STATE_PLAYING || _state == STATE_STOPPED);
+  DCHECK(_frames[_current_frame] != NULL);
+  return _frames[_current_frame]->getGlobalBounds();
+}
+
+bool Sprite::IsAnimated() const {
+  CHECK(_state == STATE_PLAYING || _state == STATE_STOPPED);
+  return _frames_count > 1;
+}
+
 void Sprite::Play() {
   CHECK(_state == STATE_STOPPED);
   _last_frame_change = _timer.GetTime();
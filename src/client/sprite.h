@@ -31,6 +31,17 @@ class Sprite {
   // Renders current frame.
   void Render(sf::RenderWindow* render_window);
 
+  // Writes the current frame with its transform as a quad of 4 vertices,
+  // which should be drawn with 'GetTexture()'.
+  void GetQuad(sf::Vertex* quad);
+  const sf::Texture* GetTexture() const;
+
+  // Returns the bounding rectangle of the current frame.
+  sf::FloatRect GetBounds() const;
+
+  // Returns 'true' if the sprite has more than one frame.
+  bool IsAnimated() const;
+
   // Sets the mode of the sprite. 'mode' should be the name of one of the
   // modes declared in the sprite description file.
   // void SetMode(const std::string& mode);
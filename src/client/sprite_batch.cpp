@@ -0,0 +1,65 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "client/sprite_batch.h"
+
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "client/sprite.h"
+
+namespace bm {
+
+SpriteBatch::SpriteBatch() : batch_count_(0) { }
+
+SpriteBatch::~SpriteBatch() { }
+
+void SpriteBatch::Clear() {
+  for (size_t i = 0; i < batch_count_; i++) {
+    batches_[i].vertices.clear();
+  }
+  batch_count_ = 0;
+}
+
+void SpriteBatch::AddSprite(Sprite* sprite) {
+  CHECK(sprite != NULL);
+  Batch* batch = GetBatch(sprite->GetTexture());
+  sf::Vertex quad[4];
+  sprite->GetQuad(&quad[0]);
+  for (size_t i = 0; i < 4; i++) {
+    batch->vertices.append(quad[i]);
+  }
+}
+
+void SpriteBatch::Render(sf::RenderTarget* target) const {
+  CHECK(target != NULL);
+  for (size_t i = 0; i < batch_count_; i++) {
+    target->draw(batches_[i].vertices,
+        sf::RenderStates(batches_[i].texture));
+  }
+}
+
+SpriteBatch::Batch* SpriteBatch::GetBatch(const sf::Texture* texture) {
+  // There are only a few atlases, so a linear search is fine.
+  for (size_t i = 0; i < batch_count_; i++) {
+    if (batches_[i].texture == texture) {
+      return &batches_[i];
+    }
+  }
+
+  if (batch_count_ == batches_.size()) {
+    batches_.push_back(Batch());
+    batches_.back().vertices.setPrimitiveType(sf::Quads);
+  }
+  Batch* batch = &batches_[batch_count_];
+  batch_count_++;
+  batch->texture = texture;
+  batch->vertices.clear();
+  return batch;
+}
+
+}  // namespace bm
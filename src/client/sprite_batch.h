@@ -0,0 +1,49 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef CLIENT_SPRITE_BATCH_H_
+#define CLIENT_SPRITE_BATCH_H_
+
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "client/sprite.h"
+
+namespace bm {
+
+// Collects sprites into a vertex array per texture atlas, so that they
+// are drawn with one draw call per atlas instead of one per sprite.
+// The atlases are drawn in the order their first sprites were added.
+class SpriteBatch {
+ public:
+  SpriteBatch();
+  ~SpriteBatch();
+
+  // Removes the sprites but keeps the allocated vertex arrays.
+  void Clear();
+
+  // Adds the current frame of 'sprite' at its current position.
+  void AddSprite(Sprite* sprite);
+
+  void Render(sf::RenderTarget* target) const;
+
+ private:
+  struct Batch {
+    const sf::Texture* texture;
+    sf::VertexArray vertices;
+  };
+
+  Batch* GetBatch(const sf::Texture* texture);
+
+  std::vector<Batch> batches_;
+  size_t batch_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpriteBatch);
+};
+
+}  // namespace bm
+
+#endif  // CLIENT_SPRITE_BATCH_H_
@@ -0,0 +1,208 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "client/terrain_cache.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "client/sprite.h"
+#include "client/sprite_batch.h"
+
+namespace bm {
+
+TerrainCache::TerrainCache()
+  : chunk_size_(DEFAULT_CHUNK_SIZE), width_(0), height_(0),
+    state_(STATE_FINALIZED) { }
+
+TerrainCache::~TerrainCache() {
+  if (state_ == STATE_INITIALIZED) {
+    Finalize();
+  }
+}
+
+bool TerrainCache::Initialize(const std::vector<Sprite*>& tiles,
+    int32_t chunk_size) {
+  CHECK(state_ == STATE_FINALIZED);
+  CHECK(chunk_size > 0);
+
+  chunk_size_ = chunk_size;
+  width_ = 0;
+  height_ = 0;
+  state_ = STATE_INITIALIZED;
+
+  if (tiles.empty()) {
+    return true;
+  }
+
+  sf::FloatRect bounds = tiles[0]->GetBounds();
+  float left = bounds.left;
+  float top = bounds.top;
+  float right = bounds.left + bounds.width;
+  float bottom = bounds.top + bounds.height;
+  for (auto tile : tiles) {
+    bounds = tile->GetBounds();
+    left = std::min(left, bounds.left);
+    top = std::min(top, bounds.top);
+    right = std::max(right, bounds.left + bounds.width);
+    bottom = std::max(bottom, bounds.top + bounds.height);
+  }
+
+  float size = static_cast<float>(chunk_size_);
+  origin_ = sf::Vector2f(floorf(left), floorf(top));
+  width_ = std::max(1,
+      static_cast<int32_t>(ceilf((right - origin_.x) / size)));
+  height_ = std::max(1,
+      static_cast<int32_t>(ceilf((bottom - origin_.y) / size)));
+  chunks_.assign(width_ * height_, NULL);
+
+  for (auto tile : tiles) {
+    int32_t min_x, min_y, max_x, max_y;
+    if (!GetChunkRange(tile->GetBounds(), &min_x, &min_y, &max_x, &max_y)) {
+      continue;
+    }
+    for (int32_t y = min_y; y <= max_y; y++) {
+      for (int32_t x = min_x; x <= max_x; x++) {
+        Chunk*& chunk = chunks_[y * width_ + x];
+        if (chunk == NULL) {
+          chunk = new Chunk();
+          CHECK(chunk != NULL);
+          chunk->texture = NULL;
+          chunk->valid = false;
+        }
+        chunk->tiles.push_back(tile);
+      }
+    }
+  }
+
+  for (int32_t y = 0; y < height_; y++) {
+    for (int32_t x = 0; x < width_; x++) {
+      if (chunks_[y * width_ + x] != NULL && !RenderChunk(x, y)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void TerrainCache::Finalize() {
+  CHECK(state_ == STATE_INITIALIZED);
+  for (auto chunk : chunks_) {
+    if (chunk != NULL) {
+      if (chunk->texture != NULL) delete chunk->texture;
+      delete chunk;
+    }
+  }
+  chunks_.clear();
+  state_ = STATE_FINALIZED;
+}
+
+void TerrainCache::Invalidate(const sf::FloatRect& area) {
+  CHECK(state_ == STATE_INITIALIZED);
+  int32_t min_x, min_y, max_x, max_y;
+  if (!GetChunkRange(area, &min_x, &min_y, &max_x, &max_y)) {
+    return;
+  }
+  for (int32_t y = min_y; y <= max_y; y++) {
+    for (int32_t x = min_x; x <= max_x; x++) {
+      Chunk* chunk = chunks_[y * width_ + x];
+      if (chunk != NULL) {
+        chunk->valid = false;
+      }
+    }
+  }
+}
+
+bool TerrainCache::Render(sf::RenderTarget* target, const sf::View& view) {
+  CHECK(state_ == STATE_INITIALIZED);
+  CHECK(target != NULL);
+
+  sf::Vector2f size = view.getSize();
+  sf::Vector2f corner = view.getCenter() - size / 2.0f;
+  sf::FloatRect area(corner, size);
+
+  int32_t min_x, min_y, max_x, max_y;
+  if (!GetChunkRange(area, &min_x, &min_y, &max_x, &max_y)) {
+    return true;
+  }
+  for (int32_t y = min_y; y <= max_y; y++) {
+    for (int32_t x = min_x; x <= max_x; x++) {
+      Chunk* chunk = chunks_[y * width_ + x];
+      if (chunk == NULL) {
+        continue;
+      }
+      if (!chunk->valid && !RenderChunk(x, y)) {
+        return false;
+      }
+      target->draw(chunk->sprite);
+    }
+  }
+  return true;
+}
+
+bool TerrainCache::GetChunkRange(const sf::FloatRect& area, int32_t* min_x,
+    int32_t* min_y, int32_t* max_x, int32_t* max_y) const {
+  if (width_ == 0 || height_ == 0) {
+    return false;
+  }
+  float size = static_cast<float>(chunk_size_);
+  *min_x = static_cast<int32_t>(floorf((area.left - origin_.x) / size));
+  *min_y = static_cast<int32_t>(floorf((area.top - origin_.y) / size));
+  *max_x = static_cast<int32_t>(
+      floorf((area.left + area.width - origin_.x) / size));
+  *max_y = static_cast<int32_t>(
+      floorf((area.top + area.height - origin_.y) / size));
+  if (*max_x < 0 || *max_y < 0 || *min_x >= width_ || *min_y >= height_) {
+    return false;
+  }
+  *min_x = std::max(*min_x, 0);
+  *min_y = std::max(*min_y, 0);
+  *max_x = std::min(*max_x, width_ - 1);
+  *max_y = std::min(*max_y, height_ - 1);
+  return true;
+}
+
+bool TerrainCache::RenderChunk(int32_t x, int32_t y) {
+  Chunk* chunk = chunks_[y * width_ + x];
+  CHECK(chunk != NULL);
+
+  if (chunk->texture == NULL) {
+    chunk->texture = new sf::RenderTexture();
+    CHECK(chunk->texture != NULL);
+    if (!chunk->texture->create(chunk_size_, chunk_size_)) {
+      REPORT_ERROR("Unable to create a %dx%d terrain chunk texture.",
+          chunk_size_, chunk_size_);
+      return false;
+    }
+  }
+
+  float size = static_cast<float>(chunk_size_);
+  sf::Vector2f position = origin_ + sf::Vector2f(x * size, y * size);
+
+  batch_.Clear();
+  for (auto tile : chunk->tiles) {
+    batch_.AddSprite(tile);
+  }
+
+  sf::View view;
+  view.reset(sf::FloatRect(position.x, position.y, size, size));
+  chunk->texture->setView(view);
+  chunk->texture->clear(sf::Color::Transparent);
+  batch_.Render(chunk->texture);
+  chunk->texture->display();
+
+  chunk->sprite.setTexture(chunk->texture->getTexture(), true);
+  chunk->sprite.setPosition(position);
+  chunk->valid = true;
+  return true;
+}
+
+}  // namespace bm
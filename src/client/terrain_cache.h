@@ -0,0 +1,79 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef CLIENT_TERRAIN_CACHE_H_
+#define CLIENT_TERRAIN_CACHE_H_
+
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "client/sprite.h"
+#include "client/sprite_batch.h"
+
+namespace bm {
+
+// Pre-renders the terrain tiles into square chunk textures, so that
+// drawing the terrain takes a few draw calls for the chunks intersecting
+// the view. A chunk is rendered again only after it is invalidated.
+class TerrainCache {
+ public:
+  static const int32_t DEFAULT_CHUNK_SIZE = 512;
+
+  TerrainCache();
+  ~TerrainCache();
+
+  // Splits the area covered by 'tiles' into chunks and renders them.
+  // The tiles should stay alive and keep their positions until
+  // 'Finalize()' is called. Returns 'false' if a texture can't be created.
+  bool Initialize(const std::vector<Sprite*>& tiles,
+      int32_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+  // Cleans up. Automatically called in the destructor.
+  void Finalize();
+
+  // Makes the chunks intersecting 'area' to be rendered again before
+  // they are drawn next time, e.g. after the tiles there have changed.
+  void Invalidate(const sf::FloatRect& area);
+
+  // Draws the chunks intersecting 'view'.
+  // Returns 'false' if a texture can't be created.
+  bool Render(sf::RenderTarget* target, const sf::View& view);
+
+ private:
+  struct Chunk {
+    std::vector<Sprite*> tiles;
+    sf::RenderTexture* texture;
+    sf::Sprite sprite;
+    bool valid;
+  };
+
+  // Returns 'false' if the rectangle doesn't intersect any chunk.
+  bool GetChunkRange(const sf::FloatRect& area, int32_t* min_x,
+      int32_t* min_y, int32_t* max_x, int32_t* max_y) const;
+
+  bool RenderChunk(int32_t x, int32_t y);
+
+  int32_t chunk_size_;
+  sf::Vector2f origin_;
+  int32_t width_;
+  int32_t height_;
+
+  // Indexed by 'y * width_ + x'. Chunks without tiles are NULL.
+  std::vector<Chunk*> chunks_;
+
+  SpriteBatch batch_;
+
+  enum {
+    STATE_FINALIZED,
+    STATE_INITIALIZED
+  } state_;
+
+  DISALLOW_COPY_AND_ASSIGN(TerrainCache);
+};
+
+}  // namespace bm
+
+#endif  // CLIENT_TERRAIN_CACHE_H_
@@ -0,0 +1,31 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "base/error.h"
+
+#include "engine/config.h"
+
+// Validates the JSON configs and compiles the game data configs into
+// a bundle, which is then loaded by 'Config::Initialize()'.
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <output bundle>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  bm::Config* config = bm::Config::GetInstance();
+  if (!config->InitializeFromJson()) {
+    bm::Error::Print();
+    return EXIT_FAILURE;
+  }
+
+  if (!config->SaveBundle(argv[1])) {
+    bm::Error::Print();
+    return EXIT_FAILURE;
+  }
+
+  printf("Config bundle '%s' written.\n", argv[1]);
+  return EXIT_SUCCESS;
+}
@@ -1,8 +1,9 @@
 #!/usr/bin/python
 
-from __future__ import unicode_literals
+from __future__ import print_function, unicode_literals
 
 import json
+import struct
 import sys
 
 terrain_tilesets = {
@@ -52,71 +53,137 @@ def get_layer(tm, layer_name):
       return layer
   assert False
 
-assert len(sys.argv) == 2
+def convert(tm):
+  m = {}
+  m['width'] = tm['width']
+  m['height'] = tm['height']
+  m['block_size'] = float(tm['tilewidth'])
+
+  m['terrain'] = []
+  for id in get_layer(tm, 'Terrain')['data']:
+    m['terrain'].append(terrain_tile_to_sprite_name(*id_to_tile(id, tm)))
+
+  m['spawns'] = []
+  m['zombie_spawns'] = []
+  for i, id in enumerate(get_layer(tm, 'Control')['data']):
+    if id == 0:
+      continue
+    x = i % m['width']
+    y = i // m['width']
+    tileset_name, tile_id = id_to_tile(id, tm)
+    assert tileset_name == 'control'
+    assert tile_id <= 1
+    if tile_id == 0:
+      m['spawns'].append({'x': x, 'y': y})
+    else:
+      m['zombie_spawns'].append({'x': x, 'y': y})
+
+  m['doors'] = []
+  m['walls'] = []
+  m['kits'] = []
+  for i, id in enumerate(get_layer(tm, 'Entity')['data']):
+    if id == 0:
+      continue
+
+    flipped_hori = False if id & 0x80000000 == 0 else True
+    flipped_vert = False if id & 0x40000000 == 0 else True
+    flipped_diag = False if id & 0x20000000 == 0 else True
+    # FFF => 0, TFT => 90, TTF => 180, FTT => 270
+    if (flipped_hori, flipped_vert, flipped_diag) == (False, False, False):
+      rotation = 0;
+    elif (flipped_hori, flipped_vert, flipped_diag) == (True, False, True):
+      rotation = 90
+    elif (flipped_hori, flipped_vert, flipped_diag) == (True, True, False):
+      rotation = 180
+    elif (flipped_hori, flipped_vert, flipped_diag) == (False, True, True):
+      rotation = 270
+    else:
+      assert False
+    id &= ~(0x80000000 | 0x40000000 | 0x20000000)
+
+    x = i % m['width']
+    y = i // m['width']
+    tileset_name, tile_id = id_to_tile(id, tm)
+    entity_name = entity_tile_to_entity_name(tileset_name, tile_id)
+    entity = {'entity': entity_name, 'x': x, 'y': y, 'rotation': rotation}
+
+    if tileset_name in door_tilesets.keys():
+      m['doors'].append(entity)
+    elif tileset_name in wall_tilesets.keys():
+      m['walls'].append(entity)
+    elif tileset_name in kits_tilesets.keys():
+      m['kits'].append(entity)
+    else:
+      assert False
+
+  return m
+
+# Must match 'Map::BinaryHeader' in 'src/engine/map.h'.
+BMAP_MAGIC = b'BMAP'
+BMAP_VERSION = 1
+
+def pad(data):
+  return data + b'\0' * (-len(data) % 4)
+
+def intern(names, index, name):
+  if name not in index:
+    index[name] = len(names)
+    names.append(name)
+  return index[name]
+
+def compile_bmap(m):
+  sprite_names, sprite_index = [], {}
+  tiles = [intern(sprite_names, sprite_index, name) for name in m['terrain']]
+  assert len(sprite_names) <= 0xFFFF
+
+  entity_names, entity_index = [], {}
+  entities = m['doors'] + m['kits'] + m['walls']
+  for entity in entities:
+    intern(entity_names, entity_index, entity['entity'])
+
+  strings = b''
+  string_table = b''
+  for name in sprite_names + entity_names:
+    encoded = name.encode('utf-8')
+    string_table += struct.pack('<II', len(strings), len(encoded))
+    strings += encoded
+
+  tiles = struct.pack('<%dH' % len(tiles), *tiles)
+
+  spawns = b''
+  for spawn in m['spawns'] + m['zombie_spawns']:
+    spawns += struct.pack('<ii', spawn['x'], spawn['y'])
+
+  placements = b''
+  for entity in entities:
+    placements += struct.pack('<iiiI', entity['x'], entity['y'],
+                              entity.get('rotation', 0),
+                              entity_index[entity['entity']])
+
+  header = BMAP_MAGIC + struct.pack('<Ifii8I', BMAP_VERSION,
+      m['block_size'], m['width'], m['height'],
+      len(sprite_names), len(entity_names), len(strings),
+      len(m['spawns']), len(m['zombie_spawns']),
+      len(m['doors']), len(m['kits']), len(m['walls']))
+  assert len(header) == 52
+
+  return (header + string_table + pad(strings) + pad(tiles) +
+          spawns + placements)
+
+# Usage: convert.py <tiled map or map .json> [<output .json or .bmap>]
+assert len(sys.argv) in (2, 3)
 src = sys.argv[1]
 
 tm = json.loads(open(src).read())
 
-m = {}
-m['width'] = tm['width']
-m['height'] = tm['height']
-m['block_size'] = float(tm['tilewidth'])
-
-m['terrain'] = []
-for id in get_layer(tm, 'Terrain')['data']:
-  m['terrain'].append(terrain_tile_to_sprite_name(*id_to_tile(id, tm)))
-
-m['spawns'] = []
-m['zombie_spawns'] = []
-for i, id in enumerate(get_layer(tm, 'Control')['data']):
-  if id == 0:
-    continue
-  x = i % m['width']
-  y = i / m['width']
-  tileset_name, tile_id = id_to_tile(id, tm)
-  assert tileset_name == 'control'
-  assert tile_id <= 1
-  if tile_id == 0:
-    m['spawns'].append({'x': x, 'y': y})
-  else:
-    m['zombie_spawns'].append({'x': x, 'y': y})
-
-m['doors'] = []
-m['walls'] = []
-m['kits'] = []
-for i, id in enumerate(get_layer(tm, 'Entity')['data']):
-  if id == 0:
-    continue
-
-  flipped_hori = False if id & 0x80000000 == 0 else True
-  flipped_vert = False if id & 0x40000000 == 0 else True
-  flipped_diag = False if id & 0x20000000 == 0 else True
-  # FFF => 0, TFT => 90, TTF => 180, FTT => 270
-  if (flipped_hori, flipped_vert, flipped_diag) == (False, False, False):
-    rotation = 0;
-  elif (flipped_hori, flipped_vert, flipped_diag) == (True, False, True):
-    rotation = 90
-  elif (flipped_hori, flipped_vert, flipped_diag) == (True, True, False):
-    rotation = 180
-  elif (flipped_hori, flipped_vert, flipped_diag) == (False, True, True):
-    rotation = 270
-  else:
-    assert False
-  id &= ~(0x80000000 | 0x40000000 | 0x20000000)
-
-  x = i % m['width']
-  y = i / m['width']
-  tileset_name, tile_id = id_to_tile(id, tm)
-  entity_name = entity_tile_to_entity_name(tileset_name, tile_id)
-  entity = {'entity': entity_name, 'x': x, 'y': y, 'rotation': rotation}
-
-  if tileset_name in door_tilesets.keys():
-    m['doors'].append(entity)
-  elif tileset_name in wall_tilesets.keys():
-    m['walls'].append(entity)
-  elif tileset_name in kits_tilesets.keys():
-    m['kits'].append(entity)
-  else:
-    assert False
-
-print json.dumps(m, indent=4, separators=(',', ': '))
+# Already converted maps are only compiled.
+m = convert(tm) if 'tilesets' in tm else tm
+
+if len(sys.argv) == 2:
+  print(json.dumps(m, indent=4, separators=(',', ': ')))
+elif sys.argv[2].endswith('.bmap'):
+  with open(sys.argv[2], 'wb') as f:
+    f.write(compile_bmap(m))
+else:
+  with open(sys.argv[2], 'w') as f:
+    f.write(json.dumps(m, indent=4, separators=(',', ': ')) + '\n')
@@ -22,16 +22,16 @@ Body::~Body() {
   }
 }
 
-void Body::Create(b2World* world, const std::string& body_name) {
+void Body::Create(b2World* world, uint32_t body_id) {
   CHECK(state_ == STATE_DESTROYED);
   CHECK(world != NULL);
 
   world_ = world;
 
-  // FIXME(xairy): check.
-  CHECK(Config::GetInstance()->GetBodiesConfig().count(body_name) > 0);
-  const Config::BodyConfig& config =
-    Config::GetInstance()->GetBodiesConfig().at(body_name);
+  const Config::BodyConfig* body_config =
+    Config::GetInstance()->GetBodyConfig(body_id);
+  CHECK(body_config != NULL);
+  const Config::BodyConfig& config = *body_config;
 
   b2BodyDef body_def;
   body_def.type = config.dynamic ? b2_dynamicBody : b2_staticBody;
@@ -8,6 +8,7 @@
 #include <Box2D/Box2D.h>
 
 #include "base/macros.h"
+#include "base/pstdint.h"
 
 #include "engine/dll.h"
 
@@ -18,7 +19,7 @@ class BM_ENGINE_DECL Body {
   Body();
   virtual ~Body();
 
-  void Create(b2World* world, const std::string& body_config);
+  void Create(b2World* world, uint32_t body_id);
   void Destroy();
 
   b2Body* GetBody();
@@ -2,19 +2,337 @@
 
 #include "engine/config.h"
 
+#include <cstring>
+
 #include <map>
 #include <string>
 #include <fstream>  // NOLINT
+#include <type_traits>
 #include <vector>
 
 #include "base/error.h"
 #include "base/json.h"
 #include "base/macros.h"
+#include "base/mapped_file.h"
 #include "base/pstdint.h"
 #include "base/singleton.h"
+#include "base/utils.h"
 
 namespace bm {
 
+namespace {
+
+template<class T>
+void AssignIds(std::map<std::string, T>* configs,
+    std::vector<const T*>* configs_by_id) {
+  configs_by_id->clear();
+  for (auto& config : *configs) {
+    config.second.id = static_cast<uint32_t>(configs_by_id->size());
+    configs_by_id->push_back(&config.second);
+  }
+}
+
+template<class T>
+const T* GetById(const std::vector<const T*>& configs_by_id, uint32_t id) {
+  if (id >= configs_by_id.size()) {
+    return NULL;
+  }
+  return configs_by_id[id];
+}
+
+// Resolves 'body_name' and 'sprite_name' of the entity configs.
+template<class T>
+bool ResolveEntityIds(const char* kind, std::map<std::string, T>* configs,
+    const std::map<std::string, Config::BodyConfig>& bodies,
+    const std::map<std::string, Config::SpriteConfig>& sprites) {
+  for (auto& entity : *configs) {
+    T& value = entity.second;
+    if (!Config::FindId(bodies, value.body_name, &value.body_id)) {
+      REPORT_ERROR("Body of %s '%s' not found.", kind, value.name.c_str());
+      return false;
+    }
+    if (!Config::FindId(sprites, value.sprite_name, &value.sprite_id)) {
+      REPORT_ERROR("Sprite of %s '%s' not found.", kind, value.name.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// A bundle is 'BundleHeader' followed by 'BundleHeader::size' bytes of
+// the game data configs. 'BUNDLE_VERSION' must be increased whenever the
+// configs or the way they are written by 'Transfer()' change.
+const char BUNDLE_FILE[] = "data/config.bundle";
+const uint32_t BUNDLE_MAGIC = 0x46434D42;  // "BMCF"
+const uint32_t BUNDLE_VERSION = 1;
+
+// The bundle is stale if any of these is newer.
+const char* const BUNDLE_SOURCES[] = {
+  "data/bodies.json",
+  "data/textures.json",
+  "data/sprites.json",
+  "data/entities.json",
+  "data/guns.json"
+};
+
+struct BundleHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+};
+
+// The writer and the reader share the 'Transfer()' functions below, so
+// the configs are read in the same order as they are written.
+class BundleWriter {
+ public:
+  explicit BundleWriter(std::vector<char>* buffer) : buffer_(buffer) { }
+
+  template<class T>
+  void Transfer(T* value) {
+    static_assert(std::is_pod<T>::value, "Only POD values are copied.");
+    const char* data = reinterpret_cast<const char*>(value);
+    buffer_->insert(buffer_->end(), data, data + sizeof(*value));
+  }
+
+  void Transfer(bool* value) {
+    uint8_t byte = *value ? 1 : 0;
+    Transfer(&byte);
+  }
+
+  void Transfer(std::string* value) {
+    uint32_t size = static_cast<uint32_t>(value->size());
+    Transfer(&size);
+    buffer_->insert(buffer_->end(), value->begin(), value->end());
+  }
+
+  template<class T>
+  void Transfer(std::vector<T>* values) {
+    uint32_t size = static_cast<uint32_t>(values->size());
+    Transfer(&size);
+    for (size_t i = 0; i < values->size(); i++) {
+      Transfer(&(*values)[i]);
+    }
+  }
+
+ private:
+  std::vector<char>* buffer_;
+};
+
+class BundleReader {
+ public:
+  BundleReader(const char* data, size_t size)
+    : data_(data), size_(size), offset_(0), valid_(true) { }
+
+  // Returns 'false' if the data has ended prematurely.
+  bool IsValid() const {
+    return valid_;
+  }
+
+  bool IsAtEnd() const {
+    return offset_ == size_;
+  }
+
+  template<class T>
+  void Transfer(T* value) {
+    static_assert(std::is_pod<T>::value, "Only POD values are copied.");
+    if (!Skip(sizeof(*value))) {
+      return;
+    }
+    memcpy(value, data_ + offset_ - sizeof(*value), sizeof(*value));
+  }
+
+  void Transfer(bool* value) {
+    uint8_t byte = 0;
+    Transfer(&byte);
+    *value = (byte != 0);
+  }
+
+  void Transfer(std::string* value) {
+    uint32_t size = 0;
+    Transfer(&size);
+    if (!Skip(size)) {
+      return;
+    }
+    value->assign(data_ + offset_ - size, size);
+  }
+
+  template<class T>
+  void Transfer(std::vector<T>* values) {
+    uint32_t size = 0;
+    Transfer(&size);
+    // Every element takes at least a byte.
+    if (!valid_ || size > size_ - offset_) {
+      valid_ = false;
+      return;
+    }
+    values->resize(size);
+    for (size_t i = 0; i < values->size(); i++) {
+      Transfer(&(*values)[i]);
+    }
+  }
+
+ private:
+  bool Skip(size_t size) {
+    if (!valid_ || size > size_ - offset_) {
+      valid_ = false;
+      return false;
+    }
+    offset_ += size;
+    return true;
+  }
+
+  const char* data_;
+  size_t size_;
+  size_t offset_;
+  bool valid_;
+};
+
+template<class Archive>
+void Transfer(Archive* archive, Config::BodyConfig* config) {
+  archive->Transfer(&config->name);
+  archive->Transfer(&config->dynamic);
+  archive->Transfer(&config->shape_type);
+  archive->Transfer(&config->box_config);
+  archive->Transfer(&config->circle_config);
+  archive->Transfer(&config->polygon_config.vertices);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::TextureConfig* config) {
+  archive->Transfer(&config->name);
+  archive->Transfer(&config->image);
+  archive->Transfer(&config->transparent_color);
+  archive->Transfer(&config->tiled);
+  archive->Transfer(&config->tile_start_x);
+  archive->Transfer(&config->tile_start_y);
+  archive->Transfer(&config->tile_step_x);
+  archive->Transfer(&config->tile_step_y);
+  archive->Transfer(&config->tile_width);
+  archive->Transfer(&config->tile_height);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::SpriteConfig* config) {
+  archive->Transfer(&config->name);
+  archive->Transfer(&config->texture_name);
+  archive->Transfer(&config->has_modes);
+  archive->Transfer(&config->mode.tiles);
+  archive->Transfer(&config->mode.timeout);
+  archive->Transfer(&config->mode.cyclic);
+}
+
+// The fields shared by all the entity configs.
+template<class Archive, class T>
+void TransferEntity(Archive* archive, T* config) {
+  archive->Transfer(&config->name);
+  archive->Transfer(&config->body_name);
+  archive->Transfer(&config->sprite_name);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::ActivatorConfig* config) {
+  TransferEntity(archive, config);
+  archive->Transfer(&config->activation_distance);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::CritterConfig* config) {
+  TransferEntity(archive, config);
+  archive->Transfer(&config->speed);
+  archive->Transfer(&config->damage);
+  archive->Transfer(&config->type);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::DoorConfig* config) {
+  TransferEntity(archive, config);
+  archive->Transfer(&config->activation_distance);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::KitConfig* config) {
+  TransferEntity(archive, config);
+  archive->Transfer(&config->health_regen);
+  archive->Transfer(&config->energy_regen);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::PlayerConfig* config) {
+  TransferEntity(archive, config);
+  archive->Transfer(&config->speed);
+  archive->Transfer(&config->health_max);
+  archive->Transfer(&config->health_regen);
+  archive->Transfer(&config->energy_max);
+  archive->Transfer(&config->energy_regen);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::ProjectileConfig* config) {
+  TransferEntity(archive, config);
+  archive->Transfer(&config->speed);
+  archive->Transfer(&config->type);
+  archive->Transfer(&config->rocket_config);
+  archive->Transfer(&config->slime_config);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::WallConfig* config) {
+  TransferEntity(archive, config);
+  archive->Transfer(&config->type);
+}
+
+template<class Archive>
+void Transfer(Archive* archive, Config::GunConfig* config) {
+  archive->Transfer(&config->name);
+  archive->Transfer(&config->projectile_name);
+  archive->Transfer(&config->energy_consumption);
+}
+
+template<class T>
+void WriteConfigs(BundleWriter* writer,
+    const std::map<std::string, T>& configs) {
+  uint32_t count = static_cast<uint32_t>(configs.size());
+  writer->Transfer(&count);
+  for (auto& config : configs) {
+    T copy = config.second;
+    Transfer(writer, &copy);
+  }
+}
+
+template<class T>
+bool ReadConfigs(BundleReader* reader, std::map<std::string, T>* configs) {
+  uint32_t count = 0;
+  reader->Transfer(&count);
+  for (uint32_t i = 0; i < count && reader->IsValid(); i++) {
+    T config;
+    Transfer(reader, &config);
+    if (!reader->IsValid() || configs->count(config.name) != 0) {
+      return false;
+    }
+    (*configs)[config.name] = config;
+  }
+  return reader->IsValid();
+}
+
+template<class T>
+bool HaveSameNames(const char* kind, const std::map<std::string, T>& first,
+    const std::map<std::string, T>& second) {
+  auto itr = first.begin();
+  auto other = second.begin();
+  for (; itr != first.end() && other != second.end(); ++itr, ++other) {
+    if (itr->first != other->first) {
+      break;
+    }
+  }
+  if (itr != first.end() || other != second.end()) {
+    REPORT_ERROR("The set of %s configs has changed.", kind);
+    return false;
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
 Config* Config::GetInstance() {
   static Config instance;
   return &instance;
@@ -24,19 +342,43 @@ Config::Config() : state_(STATE_FINALIZED) { }
 Config::~Config() { }
 
 bool Config::Initialize() {
+  return Load(true);
+}
+
+bool Config::InitializeFromJson() {
+  return Load(false);
+}
+
+bool Config::Load(bool use_bundle) {
   CHECK(state_ == STATE_FINALIZED);
   if (!LoadMasterServerConfig() || !LoadServerConfig() || !LoadClientConfig()) {
     return false;
   }
-  if (!LoadBodiesConfig() || !LoadTexturesConfig() || !LoadSpritesConfig()) {
-    return false;
+
+  bool loaded = false;
+  if (use_bundle && IsBundleFresh()) {
+    loaded = LoadBundle(BUNDLE_FILE);
+    if (!loaded) {
+      REPORT_WARNING("Can't load '%s', parsing the JSON configs instead.",
+          BUNDLE_FILE);
+    }
   }
-  if (!LoadActivatorsConfig() || !LoadCrittersConfig() || !LoadDoorsConfig() ||
-      !LoadKitsConfig() || !LoadPlayersConfig() || !LoadProjectilesConfig() ||
-      !LoadWallsConfig()) {
-    return false;
+
+  if (!loaded) {
+    if (!LoadBodiesConfig() || !LoadTexturesConfig() || !LoadSpritesConfig()) {
+      return false;
+    }
+    if (!LoadActivatorsConfig() || !LoadCrittersConfig() ||
+        !LoadDoorsConfig() || !LoadKitsConfig() || !LoadPlayersConfig() ||
+        !LoadProjectilesConfig() || !LoadWallsConfig()) {
+      return false;
+    }
+    if (!LoadGunsConfig()) {
+      return false;
+    }
   }
-  if (!LoadGunsConfig()) {
+
+  if (!AssignIds()) {
     return false;
   }
   state_ = STATE_INITIALIZED;
@@ -124,6 +466,62 @@ Config::GetGunsConfig() const {
   return guns_;
 }
 
+const Config::BodyConfig* Config::GetBodyConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(bodies_by_id_, id);
+}
+
+const Config::TextureConfig* Config::GetTextureConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(textures_by_id_, id);
+}
+
+const Config::SpriteConfig* Config::GetSpriteConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(sprites_by_id_, id);
+}
+
+const Config::ActivatorConfig* Config::GetActivatorConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(activators_by_id_, id);
+}
+
+const Config::CritterConfig* Config::GetCritterConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(critters_by_id_, id);
+}
+
+const Config::DoorConfig* Config::GetDoorConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(doors_by_id_, id);
+}
+
+const Config::KitConfig* Config::GetKitConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(kits_by_id_, id);
+}
+
+const Config::PlayerConfig* Config::GetPlayerConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(players_by_id_, id);
+}
+
+const Config::ProjectileConfig*
+Config::GetProjectileConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(projectiles_by_id_, id);
+}
+
+const Config::WallConfig* Config::GetWallConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(walls_by_id_, id);
+}
+
+const Config::GunConfig* Config::GetGunConfig(uint32_t id) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  return GetById(guns_by_id_, id);
+}
+
 bool Config::LoadMasterServerConfig() {
   std::string file = "data/master-server.json";
   Json::Reader reader;
@@ -187,6 +585,67 @@ bool Config::LoadServerConfig() {
         "server", "tick_rate", "int", file.c_str());
     return false;
   }
+  if (!GetInt32(server["max_catch_up_ticks"], &server_.max_catch_up_ticks)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "max_catch_up_ticks", "int", file.c_str());
+    return false;
+  }
+  if (!GetInt32(server["max_lag"], &server_.max_lag)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "max_lag", "int", file.c_str());
+    return false;
+  }
+  if (!GetInt32(server["max_rewind"], &server_.max_rewind)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "max_rewind", "int", file.c_str());
+    return false;
+  }
+  if (!GetInt32(server["max_interpolation_offset"],
+                &server_.max_interpolation_offset)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "max_interpolation_offset", "int", file.c_str());
+    return false;
+  }
+  if (!GetFloat32(server["view_radius"], &server_.view_radius)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "view_radius", "float", file.c_str());
+    return false;
+  }
+  if (!GetBool(server["delta_snapshots"], &server_.delta_snapshots)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "delta_snapshots", "bool", file.c_str());
+    return false;
+  }
+  if (!GetInt32(server["worker_threads"], &server_.worker_threads)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "worker_threads", "int", file.c_str());
+    return false;
+  }
+  if (!GetInt32(server["room_count"], &server_.room_count)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "room_count", "int", file.c_str());
+    return false;
+  }
+  if (!GetInt32(server["max_clients"], &server_.max_clients)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "max_clients", "int", file.c_str());
+    return false;
+  }
+  if (!GetInt32(server["stats_period"], &server_.stats_period)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "stats_period", "int", file.c_str());
+    return false;
+  }
+  if (!GetString(server["stats_file"], &server_.stats_file)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "stats_file", "string", file.c_str());
+    return false;
+  }
+  if (!GetBool(server["reload_configs"], &server_.reload_configs)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "reload_configs", "bool", file.c_str());
+    return false;
+  }
   if (!GetString(server["map"], &server_.map)) {
     REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
         "server", "map", "string", file.c_str());
@@ -249,6 +708,11 @@ bool Config::LoadClientConfig() {
     return false;
   }
   client_.server_port = static_cast<uint16_t>(port);
+  if (!GetUInt32(server["room"], &client_.server_room)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "server", "room", "int", file.c_str());
+    return false;
+  }
 
   Json::Value master_server = root["master-server"];
   if (master_server.isNull() || !master_server.isObject()) {
@@ -330,11 +794,22 @@ bool Config::LoadClientConfig() {
         "net", "max_player_misposition", "float", file.c_str());
     return false;
   }
+  if (!GetFloat32(net["prediction_tolerance"],
+                &client_.prediction_tolerance)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "net", "prediction_tolerance", "float", file.c_str());
+    return false;
+  }
   if (!GetInt32(net["interpolation_offset"], &client_.interpolation_offset)) {
     REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
         "net", "interpolation_offset", "int", file.c_str());
     return false;
   }
+  if (!GetInt32(net["protocol_version"], &client_.protocol_version)) {
+    REPORT_ERROR("Config '%s.%s' of type '%s' not found in '%s'.",
+        "net", "protocol_version", "int", file.c_str());
+    return false;
+  }
 
   return true;
 }
@@ -1130,4 +1605,228 @@ bool Config::LoadGunsConfig() {
   return true;
 }
 
+bool Config::IsBundleFresh() const {
+  int64_t bundle_time;
+  if (!GetModificationTime(BUNDLE_FILE, &bundle_time)) {
+    return false;
+  }
+  for (auto source : BUNDLE_SOURCES) {
+    int64_t source_time;
+    if (GetModificationTime(source, &source_time) &&
+        source_time >= bundle_time) {
+      REPORT_WARNING("'%s' is older than '%s', parsing the JSON configs.",
+          BUNDLE_FILE, source);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Config::LoadBundle(const std::string& file) {
+  MappedFile mapping;
+  if (!mapping.Open(file)) {
+    return false;
+  }
+
+  BundleHeader header;
+  if (mapping.GetSize() < sizeof(header)) {
+    REPORT_ERROR("Bundle '%s' is truncated.", file.c_str());
+    return false;
+  }
+  memcpy(&header, mapping.GetData(), sizeof(header));
+  if (header.magic != BUNDLE_MAGIC) {
+    REPORT_ERROR("'%s' is not a config bundle.", file.c_str());
+    return false;
+  }
+  if (header.version != BUNDLE_VERSION) {
+    REPORT_ERROR("Bundle '%s' has version %u, expected %u.", file.c_str(),
+        header.version, BUNDLE_VERSION);
+    return false;
+  }
+  if (header.size != mapping.GetSize() - sizeof(header)) {
+    REPORT_ERROR("Bundle '%s' is truncated.", file.c_str());
+    return false;
+  }
+
+  // Nothing is changed unless the whole bundle is valid.
+  std::map<std::string, BodyConfig> bodies;
+  std::map<std::string, TextureConfig> textures;
+  std::map<std::string, SpriteConfig> sprites;
+  std::map<std::string, ActivatorConfig> activators;
+  std::map<std::string, CritterConfig> critters;
+  std::map<std::string, DoorConfig> doors;
+  std::map<std::string, KitConfig> kits;
+  std::map<std::string, PlayerConfig> players;
+  std::map<std::string, ProjectileConfig> projectiles;
+  std::map<std::string, WallConfig> walls;
+  std::map<std::string, GunConfig> guns;
+
+  BundleReader reader(mapping.GetData() + sizeof(header), header.size);
+  bool success = ReadConfigs(&reader, &bodies) &&
+      ReadConfigs(&reader, &textures) &&
+      ReadConfigs(&reader, &sprites) &&
+      ReadConfigs(&reader, &activators) &&
+      ReadConfigs(&reader, &critters) &&
+      ReadConfigs(&reader, &doors) &&
+      ReadConfigs(&reader, &kits) &&
+      ReadConfigs(&reader, &players) &&
+      ReadConfigs(&reader, &projectiles) &&
+      ReadConfigs(&reader, &walls) &&
+      ReadConfigs(&reader, &guns) &&
+      reader.IsAtEnd();
+  if (!success) {
+    REPORT_ERROR("Bundle '%s' is malformed.", file.c_str());
+    return false;
+  }
+
+  bodies_.swap(bodies);
+  textures_.swap(textures);
+  sprites_.swap(sprites);
+  activators_.swap(activators);
+  critters_.swap(critters);
+  doors_.swap(doors);
+  kits_.swap(kits);
+  players_.swap(players);
+  projectiles_.swap(projectiles);
+  walls_.swap(walls);
+  guns_.swap(guns);
+  return true;
+}
+
+bool Config::SaveBundle(const std::string& file) const {
+  CHECK(state_ == STATE_INITIALIZED);
+
+  std::vector<char> data;
+  BundleWriter writer(&data);
+  WriteConfigs(&writer, bodies_);
+  WriteConfigs(&writer, textures_);
+  WriteConfigs(&writer, sprites_);
+  WriteConfigs(&writer, activators_);
+  WriteConfigs(&writer, critters_);
+  WriteConfigs(&writer, doors_);
+  WriteConfigs(&writer, kits_);
+  WriteConfigs(&writer, players_);
+  WriteConfigs(&writer, projectiles_);
+  WriteConfigs(&writer, walls_);
+  WriteConfigs(&writer, guns_);
+
+  BundleHeader header;
+  header.magic = BUNDLE_MAGIC;
+  header.version = BUNDLE_VERSION;
+  header.size = static_cast<uint32_t>(data.size());
+
+  std::ofstream stream(file.c_str(), std::ios::out | std::ios::binary);
+  if (!stream.is_open()) {
+    REPORT_ERROR("Unable to open '%s' for writing.", file.c_str());
+    return false;
+  }
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream.write(data.data(), data.size());
+  stream.close();
+  if (stream.fail()) {
+    REPORT_ERROR("Unable to write '%s'.", file.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::vector<std::string> Config::GetGameDataFiles() {
+  std::vector<std::string> files;
+  for (auto source : BUNDLE_SOURCES) {
+    files.push_back(source);
+  }
+  files.push_back(BUNDLE_FILE);
+  return files;
+}
+
+bool Config::SwapGameData(Config* other) {
+  CHECK(state_ == STATE_INITIALIZED);
+  CHECK(other != NULL);
+  CHECK(other->state_ == STATE_INITIALIZED);
+
+  if (!HaveSameNames("activator", activators_, other->activators_) ||
+      !HaveSameNames("critter", critters_, other->critters_) ||
+      !HaveSameNames("door", doors_, other->doors_) ||
+      !HaveSameNames("kit", kits_, other->kits_) ||
+      !HaveSameNames("player", players_, other->players_) ||
+      !HaveSameNames("projectile", projectiles_, other->projectiles_) ||
+      !HaveSameNames("wall", walls_, other->walls_) ||
+      !HaveSameNames("gun", guns_, other->guns_)) {
+    return false;
+  }
+
+  // Swapping the maps keeps their elements in place, so the vectors
+  // indexed by the ids stay valid.
+  bodies_.swap(other->bodies_);
+  textures_.swap(other->textures_);
+  sprites_.swap(other->sprites_);
+  activators_.swap(other->activators_);
+  critters_.swap(other->critters_);
+  doors_.swap(other->doors_);
+  kits_.swap(other->kits_);
+  players_.swap(other->players_);
+  projectiles_.swap(other->projectiles_);
+  walls_.swap(other->walls_);
+  guns_.swap(other->guns_);
+
+  bodies_by_id_.swap(other->bodies_by_id_);
+  textures_by_id_.swap(other->textures_by_id_);
+  sprites_by_id_.swap(other->sprites_by_id_);
+  activators_by_id_.swap(other->activators_by_id_);
+  critters_by_id_.swap(other->critters_by_id_);
+  doors_by_id_.swap(other->doors_by_id_);
+  kits_by_id_.swap(other->kits_by_id_);
+  players_by_id_.swap(other->players_by_id_);
+  projectiles_by_id_.swap(other->projectiles_by_id_);
+  walls_by_id_.swap(other->walls_by_id_);
+  guns_by_id_.swap(other->guns_by_id_);
+  return true;
+}
+
+bool Config::AssignIds() {
+  bm::AssignIds(&bodies_, &bodies_by_id_);
+  bm::AssignIds(&textures_, &textures_by_id_);
+  bm::AssignIds(&sprites_, &sprites_by_id_);
+
+  bm::AssignIds(&activators_, &activators_by_id_);
+  bm::AssignIds(&critters_, &critters_by_id_);
+  bm::AssignIds(&doors_, &doors_by_id_);
+  bm::AssignIds(&kits_, &kits_by_id_);
+  bm::AssignIds(&players_, &players_by_id_);
+  bm::AssignIds(&projectiles_, &projectiles_by_id_);
+  bm::AssignIds(&walls_, &walls_by_id_);
+
+  bm::AssignIds(&guns_, &guns_by_id_);
+
+  for (auto& sprite : sprites_) {
+    if (!FindId(textures_, sprite.second.texture_name,
+            &sprite.second.texture_id)) {
+      REPORT_ERROR("Texture of sprite '%s' not found.",
+          sprite.second.name.c_str());
+      return false;
+    }
+  }
+
+  if (!ResolveEntityIds("activator", &activators_, bodies_, sprites_) ||
+      !ResolveEntityIds("critter", &critters_, bodies_, sprites_) ||
+      !ResolveEntityIds("door", &doors_, bodies_, sprites_) ||
+      !ResolveEntityIds("kit", &kits_, bodies_, sprites_) ||
+      !ResolveEntityIds("player", &players_, bodies_, sprites_) ||
+      !ResolveEntityIds("projectile", &projectiles_, bodies_, sprites_) ||
+      !ResolveEntityIds("wall", &walls_, bodies_, sprites_)) {
+    return false;
+  }
+
+  for (auto& gun : guns_) {
+    if (!FindId(projectiles_, gun.second.projectile_name,
+            &gun.second.projectile_id)) {
+      REPORT_ERROR("Projectile of gun '%s' not found.",
+          gun.second.name.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
 }  // namespace bm
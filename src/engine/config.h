@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 
+#include "base/error.h"
 #include "base/macros.h"
 #include "base/pstdint.h"
 
@@ -25,7 +26,19 @@ class Config {
   struct ServerConfig {
     uint16_t port;
     int32_t tick_rate;
+    int32_t max_catch_up_ticks;
+    int32_t max_lag;
+    int32_t max_rewind;
+    int32_t max_interpolation_offset;
     int32_t broadcast_rate;
+    float32_t view_radius;
+    bool delta_snapshots;
+    int32_t worker_threads;
+    int32_t room_count;
+    int32_t max_clients;
+    int32_t stats_period;
+    std::string stats_file;
+    bool reload_configs;
     std::string map;
     std::string name;
 
@@ -36,6 +49,7 @@ class Config {
   struct ClientConfig {
     std::string server_host;
     uint16_t server_port;
+    uint32_t server_room;
 
     std::string master_server_host;
     uint16_t master_server_port;
@@ -50,7 +64,9 @@ class Config {
     int32_t connect_timeout;
     int32_t sync_timeout;
     float32_t max_player_misposition;  // FIXME(xairy): rename.
+    float32_t prediction_tolerance;
     int32_t interpolation_offset;
+    int32_t protocol_version;
   };
 
   struct BodyConfig {
@@ -76,6 +92,7 @@ class Config {
       std::vector<Vertice> vertices;
     };
 
+    uint32_t id;
     std::string name;
     bool dynamic;
     ShapeType shape_type;
@@ -85,6 +102,7 @@ class Config {
   };
 
   struct TextureConfig {
+    uint32_t id;
     std::string name;
     std::string image;
     uint32_t transparent_color;
@@ -102,17 +120,22 @@ class Config {
       bool cyclic;
     };
 
+    uint32_t id;
     std::string name;
     std::string texture_name;
+    uint32_t texture_id;
 
     bool has_modes;
     Mode mode;  // TODO(xairy): support multiple modes.
   };
 
   struct ActivatorConfig {
+    uint32_t id;
     std::string name;
     std::string body_name;
     std::string sprite_name;
+    uint32_t body_id;
+    uint32_t sprite_id;
     float32_t activation_distance;
   };
 
@@ -121,33 +144,45 @@ class Config {
       TYPE_ZOMBIE,
     };
 
+    uint32_t id;
     std::string name;
     std::string body_name;
     std::string sprite_name;
+    uint32_t body_id;
+    uint32_t sprite_id;
     float32_t speed;
     int32_t damage;
     Type type;
   };
 
   struct DoorConfig {
+    uint32_t id;
     std::string name;
     std::string body_name;
     std::string sprite_name;
+    uint32_t body_id;
+    uint32_t sprite_id;
     float32_t activation_distance;
   };
 
   struct KitConfig {
+    uint32_t id;
     std::string name;
     std::string body_name;
     std::string sprite_name;
+    uint32_t body_id;
+    uint32_t sprite_id;
     int32_t health_regen;
     int32_t energy_regen;
   };
 
   struct PlayerConfig {
+    uint32_t id;
     std::string name;
     std::string body_name;
     std::string sprite_name;
+    uint32_t body_id;
+    uint32_t sprite_id;
     float32_t speed;
     int32_t health_max;
     int32_t health_regen;
@@ -170,9 +205,12 @@ class Config {
       int32_t explosion_radius;
     };
 
+    uint32_t id;
     std::string name;
     std::string body_name;
     std::string sprite_name;
+    uint32_t body_id;
+    uint32_t sprite_id;
     float32_t speed;
     Type type;
     RocketConfig rocket_config;
@@ -185,15 +223,20 @@ class Config {
       TYPE_UNBREAKABLE,
     };
 
+    uint32_t id;
     std::string name;
     std::string body_name;
     std::string sprite_name;
+    uint32_t body_id;
+    uint32_t sprite_id;
     Type type;
   };
 
   struct GunConfig {
+    uint32_t id;
     std::string name;
     std::string projectile_name;
+    uint32_t projectile_id;
     int32_t energy_consumption;
   };
 
@@ -202,8 +245,29 @@ class Config {
   BM_ENGINE_DECL Config();
   BM_ENGINE_DECL ~Config();
 
+  // The game data configs (bodies, textures, sprites, entities and guns)
+  // are loaded from the bundle 'data/config.bundle' if it's newer than
+  // the JSON files it was compiled from. Otherwise, e.g. while the JSON
+  // files are edited, they are parsed.
   BM_ENGINE_DECL bool Initialize();
 
+  // Parses the JSON files even if there is a bundle.
+  BM_ENGINE_DECL bool InitializeFromJson();
+
+  // Writes the game data configs into a bundle. Used by 'config-compiler'.
+  BM_ENGINE_DECL bool SaveBundle(const std::string& file) const;
+
+  // The files the game data configs are loaded from, the bundle included.
+  BM_ENGINE_DECL static std::vector<std::string> GetGameDataFiles();
+
+  // Replaces the game data configs with the ones of 'other', which gets
+  // the current ones in return. Both must be initialized. Fails if the
+  // configs of the entities or the guns are added, removed or renamed,
+  // since that would change the ids. Must be called when no other thread
+  // uses the configs, and the pointers returned by the getters before
+  // the swap point into 'other' afterwards.
+  BM_ENGINE_DECL bool SwapGameData(Config* other);
+
   BM_ENGINE_DECL const MasterServerConfig& GetMasterServerConfig() const;
   BM_ENGINE_DECL const ServerConfig& GetServerConfig() const;
   BM_ENGINE_DECL const ClientConfig& GetClientConfig() const;
@@ -222,6 +286,39 @@ class Config {
 
   BM_ENGINE_DECL const std::map<std::string, GunConfig>& GetGunsConfig() const;
 
+  // Every named config has an 'id' equal to its index in the name order,
+  // so the ids match wherever the configs match. The references between
+  // the configs are resolved into ids as well.
+  // The getters return NULL if there is no config with the id.
+
+  BM_ENGINE_DECL const BodyConfig* GetBodyConfig(uint32_t id) const;
+  BM_ENGINE_DECL const TextureConfig* GetTextureConfig(uint32_t id) const;
+  BM_ENGINE_DECL const SpriteConfig* GetSpriteConfig(uint32_t id) const;
+
+  BM_ENGINE_DECL const ActivatorConfig* GetActivatorConfig(uint32_t id) const;
+  BM_ENGINE_DECL const CritterConfig* GetCritterConfig(uint32_t id) const;
+  BM_ENGINE_DECL const DoorConfig* GetDoorConfig(uint32_t id) const;
+  BM_ENGINE_DECL const KitConfig* GetKitConfig(uint32_t id) const;
+  BM_ENGINE_DECL const PlayerConfig* GetPlayerConfig(uint32_t id) const;
+  BM_ENGINE_DECL const ProjectileConfig* GetProjectileConfig(uint32_t id) const;
+  BM_ENGINE_DECL const WallConfig* GetWallConfig(uint32_t id) const;
+
+  BM_ENGINE_DECL const GunConfig* GetGunConfig(uint32_t id) const;
+
+  // Finds the id of the config named 'name' in 'configs', which is one of
+  // the maps above. Meant for resolving names once, not for hot paths.
+  template<class T>
+  static bool FindId(const std::map<std::string, T>& configs,
+      const std::string& name, uint32_t* id) {
+    auto itr = configs.find(name);
+    if (itr == configs.end()) {
+      REPORT_ERROR("Config '%s' not found.", name.c_str());
+      return false;
+    }
+    *id = itr->second.id;
+    return true;
+  }
+
  private:
   bool LoadMasterServerConfig();
   bool LoadServerConfig();
@@ -241,6 +338,12 @@ class Config {
 
   bool LoadGunsConfig();
 
+  bool Load(bool use_bundle);
+  bool IsBundleFresh() const;
+  bool LoadBundle(const std::string& file);
+
+  bool AssignIds();
+
   MasterServerConfig master_server_;
   ServerConfig server_;
   ClientConfig client_;
@@ -259,6 +362,21 @@ class Config {
 
   std::map<std::string, GunConfig> guns_;
 
+  // Point into the maps above, indexed by the ids.
+  std::vector<const BodyConfig*> bodies_by_id_;
+  std::vector<const TextureConfig*> textures_by_id_;
+  std::vector<const SpriteConfig*> sprites_by_id_;
+
+  std::vector<const ActivatorConfig*> activators_by_id_;
+  std::vector<const CritterConfig*> critters_by_id_;
+  std::vector<const DoorConfig*> doors_by_id_;
+  std::vector<const KitConfig*> kits_by_id_;
+  std::vector<const PlayerConfig*> players_by_id_;
+  std::vector<const ProjectileConfig*> projectiles_by_id_;
+  std::vector<const WallConfig*> walls_by_id_;
+
+  std::vector<const GunConfig*> guns_by_id_;
+
   enum {
     STATE_FINALIZED,
     STATE_INITIALIZED
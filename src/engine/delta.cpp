@@ -0,0 +1,240 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "engine/delta.h"
+
+#include <cstring>
+
+#include <vector>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/protocol.h"
+
+namespace bm {
+
+namespace {
+
+template<class T>
+void Append(std::vector<char>* buffer, const T& value) {
+  buffer->insert(buffer->end(),
+    reinterpret_cast<const char*>(&value),
+    reinterpret_cast<const char*>(&value) + sizeof(value));
+}
+
+template<class T>
+bool Extract(const std::vector<char>& buffer, size_t* offset, T* value) {
+  if (buffer.size() < *offset + sizeof(*value)) {
+    return false;
+  }
+  memcpy(value, &buffer[*offset], sizeof(*value));
+  *offset += sizeof(*value);
+  return true;
+}
+
+const size_t DATA_FIELD_COUNT = 4;
+const uint16_t DATA_FIELDS[DATA_FIELD_COUNT] = {
+  EntityDelta::FIELD_DATA_0,
+  EntityDelta::FIELD_DATA_1,
+  EntityDelta::FIELD_DATA_2,
+  EntityDelta::FIELD_DATA_3
+};
+
+}  // anonymous namespace
+
+uint16_t GetChangedFields(const EntitySnapshot& baseline,
+    const EntitySnapshot& snapshot) {
+  uint16_t fields = 0;
+  if (snapshot.time != baseline.time) {
+    fields |= EntityDelta::FIELD_TIME;
+  }
+  if (snapshot.x != baseline.x || snapshot.y != baseline.y) {
+    fields |= EntityDelta::FIELD_POSITION;
+  }
+  if (snapshot.angle != baseline.angle) {
+    fields |= EntityDelta::FIELD_ANGLE;
+  }
+  if (snapshot.config_id != baseline.config_id) {
+    fields |= EntityDelta::FIELD_CONFIG;
+  }
+  if (snapshot.type != baseline.type) {
+    fields |= EntityDelta::FIELD_TYPE;
+  }
+  for (size_t i = 0; i < DATA_FIELD_COUNT; i++) {
+    if (snapshot.data[i] != baseline.data[i]) {
+      fields |= DATA_FIELDS[i];
+    }
+  }
+  return fields;
+}
+
+void AppendEntityDelta(std::vector<char>* buffer,
+    const EntityDelta& delta, const EntitySnapshot& snapshot) {
+  CHECK(buffer != NULL);
+  // The fields are written one by one, so the padding of the structure
+  // isn't sent.
+  Append(buffer, delta.baseline_tick);
+  Append(buffer, delta.id);
+  Append(buffer, delta.fields);
+  if (delta.fields & EntityDelta::FIELD_TIME) {
+    Append(buffer, snapshot.time);
+  }
+  if (delta.fields & EntityDelta::FIELD_POSITION) {
+    Append(buffer, snapshot.x);
+    Append(buffer, snapshot.y);
+  }
+  if (delta.fields & EntityDelta::FIELD_ANGLE) {
+    Append(buffer, snapshot.angle);
+  }
+  if (delta.fields & EntityDelta::FIELD_CONFIG) {
+    Append(buffer, snapshot.config_id);
+  }
+  if (delta.fields & EntityDelta::FIELD_TYPE) {
+    Append(buffer, static_cast<int32_t>(snapshot.type));
+  }
+  for (size_t i = 0; i < DATA_FIELD_COUNT; i++) {
+    if (delta.fields & DATA_FIELDS[i]) {
+      Append(buffer, snapshot.data[i]);
+    }
+  }
+}
+
+bool ExtractEntityDelta(const std::vector<char>& buffer,
+    size_t* offset, EntityDelta* delta) {
+  CHECK(offset != NULL);
+  CHECK(delta != NULL);
+  if (!Extract(buffer, offset, &delta->baseline_tick) ||
+      !Extract(buffer, offset, &delta->id) ||
+      !Extract(buffer, offset, &delta->fields)) {
+    return false;
+  }
+  if (delta->fields & ~EntityDelta::FIELD_ALL) {
+    return false;
+  }
+  if (delta->baseline_tick == 0 && delta->fields != EntityDelta::FIELD_ALL) {
+    return false;
+  }
+  return true;
+}
+
+bool ExtractEntityDeltaFields(const std::vector<char>& buffer,
+    size_t* offset, const EntityDelta& delta, EntitySnapshot* snapshot) {
+  CHECK(offset != NULL);
+  CHECK(snapshot != NULL);
+  snapshot->id = delta.id;
+  if (delta.fields & EntityDelta::FIELD_TIME) {
+    if (!Extract(buffer, offset, &snapshot->time)) {
+      return false;
+    }
+  }
+  if (delta.fields & EntityDelta::FIELD_POSITION) {
+    if (!Extract(buffer, offset, &snapshot->x)) {
+      return false;
+    }
+    if (!Extract(buffer, offset, &snapshot->y)) {
+      return false;
+    }
+  }
+  if (delta.fields & EntityDelta::FIELD_ANGLE) {
+    if (!Extract(buffer, offset, &snapshot->angle)) {
+      return false;
+    }
+  }
+  if (delta.fields & EntityDelta::FIELD_CONFIG) {
+    if (!Extract(buffer, offset, &snapshot->config_id)) {
+      return false;
+    }
+  }
+  if (delta.fields & EntityDelta::FIELD_TYPE) {
+    int32_t type;
+    if (!Extract(buffer, offset, &type)) {
+      return false;
+    }
+    snapshot->type = static_cast<EntitySnapshot::EntityType>(type);
+  }
+  for (size_t i = 0; i < DATA_FIELD_COUNT; i++) {
+    if (delta.fields & DATA_FIELDS[i]) {
+      if (!Extract(buffer, offset, &snapshot->data[i])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+SnapshotAcks::SnapshotAcks() {
+  for (uint32_t i = 0; i < SIZE; i++) {
+    entries_[i].tick = 0;
+    entries_[i].parts = 0;
+  }
+}
+
+void SnapshotAcks::Ack(uint32_t tick, uint32_t parts) {
+  CHECK(tick != 0);
+  Entry* entry = &entries_[tick % SIZE];
+  if (entry->tick != tick) {
+    // Acks of newer ticks are kept if an old one comes late.
+    if (entry->tick > tick) {
+      return;
+    }
+    entry->tick = tick;
+    entry->parts = 0;
+  }
+  entry->parts |= parts;
+}
+
+bool SnapshotAcks::IsAcked(uint32_t tick, uint32_t part) const {
+  const Entry* entry = &entries_[tick % SIZE];
+  if (tick == 0 || entry->tick != tick || part >= MAX_PARTS) {
+    return false;
+  }
+  return (entry->parts & (1u << part)) != 0;
+}
+
+SnapshotHistory::SnapshotHistory() {
+  for (uint32_t i = 0; i < SIZE; i++) {
+    entries_[i].tick = 0;
+    entries_[i].part = 0;
+  }
+}
+
+void SnapshotHistory::Add(uint32_t tick, uint32_t part,
+    const EntitySnapshot& snapshot) {
+  CHECK(tick != 0);
+  Entry* entry = &entries_[tick % SIZE];
+  entry->tick = tick;
+  entry->part = part;
+  entry->snapshot = snapshot;
+}
+
+const EntitySnapshot* SnapshotHistory::Get(uint32_t tick) const {
+  const Entry* entry = &entries_[tick % SIZE];
+  if (tick == 0 || entry->tick != tick) {
+    return NULL;
+  }
+  return &entry->snapshot;
+}
+
+const EntitySnapshot* SnapshotHistory::GetLatestAcked(
+    const SnapshotAcks& acks, uint32_t min_tick, uint32_t* tick) const {
+  CHECK(tick != NULL);
+  const Entry* latest = NULL;
+  for (uint32_t i = 0; i < SIZE; i++) {
+    const Entry* entry = &entries_[i];
+    if (entry->tick == 0 || entry->tick < min_tick ||
+        !acks.IsAcked(entry->tick, entry->part)) {
+      continue;
+    }
+    if (latest == NULL || entry->tick > latest->tick) {
+      latest = entry;
+    }
+  }
+  if (latest == NULL) {
+    return NULL;
+  }
+  *tick = latest->tick;
+  return &latest->snapshot;
+}
+
+}  // namespace bm
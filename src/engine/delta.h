@@ -0,0 +1,90 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef ENGINE_DELTA_H_
+#define ENGINE_DELTA_H_
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/dll.h"
+#include "engine/protocol.h"
+
+namespace bm {
+
+// Returns the mask of 'EntityDelta::Field's that differ in the snapshots.
+BM_ENGINE_DECL uint16_t GetChangedFields(const EntitySnapshot& baseline,
+    const EntitySnapshot& snapshot);
+
+// Appends 'delta' and the fields of 'snapshot' listed in 'delta.fields'.
+BM_ENGINE_DECL void AppendEntityDelta(std::vector<char>* buffer,
+    const EntityDelta& delta, const EntitySnapshot& snapshot);
+
+// Extracts 'EntityDelta' starting from 'offset' and advances 'offset'.
+// Returns 'false' when the format is incorrect.
+BM_ENGINE_DECL bool ExtractEntityDelta(const std::vector<char>& buffer,
+    size_t* offset, EntityDelta* delta);
+
+// Extracts the fields listed in 'delta.fields' into 'snapshot', which
+// should already contain the baseline, and advances 'offset'.
+// Returns 'false' when the format is incorrect.
+BM_ENGINE_DECL bool ExtractEntityDeltaFields(const std::vector<char>& buffer,
+    size_t* offset, const EntityDelta& delta, EntitySnapshot* snapshot);
+
+// World state packets of the last ticks acknowledged by a client.
+// Only the first 32 packets of each tick can be acknowledged.
+class SnapshotAcks {
+ public:
+  static const uint32_t SIZE = 32;
+  static const uint32_t MAX_PARTS = 32;
+
+  BM_ENGINE_DECL SnapshotAcks();
+
+  // Bit 'i' of 'parts' is set if the packet 'i' of 'tick' was received.
+  BM_ENGINE_DECL void Ack(uint32_t tick, uint32_t parts);
+
+  BM_ENGINE_DECL bool IsAcked(uint32_t tick, uint32_t part) const;
+
+ private:
+  struct Entry {
+    uint32_t tick;
+    uint32_t parts;
+  };
+
+  Entry entries_[SIZE];
+};
+
+// Last snapshots of a single entity indexed by tick. Ticks start from 1.
+class SnapshotHistory {
+ public:
+  static const uint32_t SIZE = SnapshotAcks::SIZE;
+
+  BM_ENGINE_DECL SnapshotHistory();
+
+  // 'part' is the world state packet of 'tick' the snapshot was sent in.
+  BM_ENGINE_DECL void Add(uint32_t tick, uint32_t part,
+      const EntitySnapshot& snapshot);
+
+  // Returns NULL if there is no snapshot for 'tick'.
+  BM_ENGINE_DECL const EntitySnapshot* Get(uint32_t tick) const;
+
+  // Returns the acknowledged snapshot with the latest tick which is not
+  // less than 'min_tick' and stores its tick in 'tick'.
+  // Returns NULL if there is no such snapshot.
+  BM_ENGINE_DECL const EntitySnapshot* GetLatestAcked(
+      const SnapshotAcks& acks, uint32_t min_tick, uint32_t* tick) const;
+
+ private:
+  struct Entry {
+    uint32_t tick;
+    uint32_t part;
+    EntitySnapshot snapshot;
+  };
+
+  Entry entries_[SIZE];
+};
+
+}  // namespace bm
+
+#endif  // ENGINE_DELTA_H_
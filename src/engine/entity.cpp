@@ -23,69 +23,62 @@ Entity::Entity(
   b2World* world,
   uint32_t id,
   Type type,
-  const std::string& entity_name,
+  uint32_t config_id,
   b2Vec2 position,
   uint16_t collision_category,
   uint16_t collision_mask
 ) : id_(id),
     type_(type),
-    body_(NULL),
-    name_(entity_name) {
-  std::string body_name;
+    config_id_(config_id) {
+  Config* config = Config::GetInstance();
+  uint32_t body_id;
   switch (type) {
     case TYPE_ACTIVATOR: {
-      auto config = Config::GetInstance()->GetActivatorsConfig();
-      CHECK(config.count(entity_name) == 1);
-      body_name = config.at(entity_name).body_name;
+      auto entity_config = config->GetActivatorConfig(config_id);
+      CHECK(entity_config != NULL);
+      body_id = entity_config->body_id;
     } break;
     case TYPE_CRITTER: {
-      auto config = Config::GetInstance()->GetCrittersConfig();
-      CHECK(config.count(entity_name) == 1);
-      body_name = config.at(entity_name).body_name;
+      auto entity_config = config->GetCritterConfig(config_id);
+      CHECK(entity_config != NULL);
+      body_id = entity_config->body_id;
     } break;
     case TYPE_DOOR: {
-      auto config = Config::GetInstance()->GetDoorsConfig();
-      CHECK(config.count(entity_name) == 1);
-      body_name = config.at(entity_name).body_name;
+      auto entity_config = config->GetDoorConfig(config_id);
+      CHECK(entity_config != NULL);
+      body_id = entity_config->body_id;
     } break;
     case TYPE_KIT: {
-      auto config = Config::GetInstance()->GetKitsConfig();
-      CHECK(config.count(entity_name) == 1);
-      body_name = config.at(entity_name).body_name;
+      auto entity_config = config->GetKitConfig(config_id);
+      CHECK(entity_config != NULL);
+      body_id = entity_config->body_id;
     } break;
     case TYPE_PLAYER: {
-      auto config = Config::GetInstance()->GetPlayersConfig();
-      CHECK(config.count(entity_name) == 1);
-      body_name = config.at(entity_name).body_name;
+      auto entity_config = config->GetPlayerConfig(config_id);
+      CHECK(entity_config != NULL);
+      body_id = entity_config->body_id;
     } break;
     case TYPE_PROJECTILE: {
-      auto config = Config::GetInstance()->GetProjectilesConfig();
-      CHECK(config.count(entity_name) == 1);
-      body_name = config.at(entity_name).body_name;
+      auto entity_config = config->GetProjectileConfig(config_id);
+      CHECK(entity_config != NULL);
+      body_id = entity_config->body_id;
     } break;
     case TYPE_WALL: {
-      auto config = Config::GetInstance()->GetWallsConfig();
-      CHECK(config.count(entity_name) == 1);
-      body_name = config.at(entity_name).body_name;
+      auto entity_config = config->GetWallConfig(config_id);
+      CHECK(entity_config != NULL);
+      body_id = entity_config->body_id;
     } break;
     default:
       CHECK(false);  // Unreachable.
   }
 
-  body_ = new Body();
-  CHECK(body_ != NULL);
-  body_->Create(world, body_name);
-  body_->SetUserData(this);
-  body_->SetPosition(position);
-  body_->SetCollisionFilter(collision_category, collision_mask);
+  body_.Create(world, body_id);
+  body_.SetUserData(this);
+  body_.SetPosition(position);
+  body_.SetCollisionFilter(collision_category, collision_mask);
 }
 
-Entity::~Entity() {
-  if (body_ != NULL) {
-    delete body_;
-    body_ = NULL;
-  }
-}
+Entity::~Entity() { }
 
 uint32_t Entity::GetId() const {
   return id_;
@@ -95,6 +88,10 @@ Entity::Type Entity::GetType() const {
   return type_;
 }
 
+uint32_t Entity::GetConfigId() const {
+  return config_id_;
+}
+
 bool Entity::IsStatic() const {
   if (type_ == TYPE_ACTIVATOR || type_ == TYPE_DOOR ||
       type_ == TYPE_KIT || type_ == TYPE_WALL) {
@@ -104,37 +101,37 @@ bool Entity::IsStatic() const {
 }
 
 b2Vec2 Entity::GetPosition() const {
-  return body_->GetPosition();
+  return body_.GetPosition();
 }
 void Entity::SetPosition(const b2Vec2& position) {
-  body_->SetPosition(position);
+  body_.SetPosition(position);
 }
 
 float Entity::GetRotation() const {
-  return body_->GetRotation();
+  return body_.GetRotation();
 }
 void Entity::SetRotation(float angle) {
-  body_->SetRotation(angle);
+  body_.SetRotation(angle);
 }
 
 b2Vec2 Entity::GetVelocity() const {
-  return body_->GetVelocity();
+  return body_.GetVelocity();
 }
 
 void Entity::SetVelocity(const b2Vec2& velocity) {
-  body_->SetVelocity(velocity);
+  body_.SetVelocity(velocity);
 }
 
 float Entity::GetMass() const {
-  return body_->GetMass();
+  return body_.GetMass();
 }
 
 void Entity::ApplyImpulse(const b2Vec2& impulse) {
-  body_->ApplyImpulse(impulse);
+  body_.ApplyImpulse(impulse);
 }
 
 void Entity::SetImpulse(const b2Vec2& impulse) {
-  body_->SetImpulse(impulse);
+  body_.SetImpulse(impulse);
 }
 
 }  // namespace bm
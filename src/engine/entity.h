@@ -47,7 +47,7 @@ class Entity {
     b2World* world,
     uint32_t id,
     Type type,
-    const std::string& entity_name,
+    uint32_t config_id,
     b2Vec2 position,
     uint16_t collision_category,
     uint16_t collision_mask);
@@ -55,6 +55,8 @@ class Entity {
 
   BM_ENGINE_DECL uint32_t GetId() const;
   BM_ENGINE_DECL Type GetType() const;
+  // Id of the config of the entity among the configs of its type.
+  BM_ENGINE_DECL uint32_t GetConfigId() const;
   BM_ENGINE_DECL bool IsStatic() const;
 
   BM_ENGINE_DECL b2Vec2 GetPosition() const;
@@ -73,8 +75,8 @@ class Entity {
  protected:
   uint32_t id_;
   Type type_;
-  Body* body_;
-  std::string name_;
+  Body body_;
+  uint32_t config_id_;
 };
 
 }  // namespace bm
@@ -0,0 +1,115 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "engine/entity_map.h"
+
+#include <utility>
+#include <vector>
+
+#include "base/id_manager.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+EntityMap::EntityMap() { }
+EntityMap::~EntityMap() { }
+
+EntityMap::iterator EntityMap::begin() {
+  return entities_.begin();
+}
+
+EntityMap::iterator EntityMap::end() {
+  return entities_.end();
+}
+
+EntityMap::const_iterator EntityMap::begin() const {
+  return entities_.begin();
+}
+
+EntityMap::const_iterator EntityMap::end() const {
+  return entities_.end();
+}
+
+size_t EntityMap::size() const {
+  return entities_.size();
+}
+
+bool EntityMap::empty() const {
+  return entities_.empty();
+}
+
+EntityMap::iterator EntityMap::find(uint32_t id) {
+  uint32_t index = GetDenseIndex(id);
+  if (index == NO_INDEX) {
+    return entities_.end();
+  }
+  return entities_.begin() + index;
+}
+
+EntityMap::const_iterator EntityMap::find(uint32_t id) const {
+  uint32_t index = GetDenseIndex(id);
+  if (index == NO_INDEX) {
+    return entities_.end();
+  }
+  return entities_.begin() + index;
+}
+
+size_t EntityMap::count(uint32_t id) const {
+  return GetDenseIndex(id) == NO_INDEX ? 0 : 1;
+}
+
+Entity* EntityMap::Get(uint32_t id) const {
+  uint32_t index = GetDenseIndex(id);
+  if (index == NO_INDEX) {
+    return NULL;
+  }
+  return entities_[index].second;
+}
+
+Entity* EntityMap::GetInSlot(uint32_t id) const {
+  uint32_t slot = IdManager::GetIndex(id);
+  if (slot >= dense_indices_.size() || dense_indices_[slot] == NO_INDEX) {
+    return NULL;
+  }
+  return entities_[dense_indices_[slot]].second;
+}
+
+void EntityMap::insert(uint32_t id, Entity* entity) {
+  uint32_t slot = IdManager::GetIndex(id);
+  if (slot >= dense_indices_.size()) {
+    dense_indices_.resize(slot + 1, NO_INDEX);
+  }
+  CHECK(dense_indices_[slot] == NO_INDEX);
+  dense_indices_[slot] = static_cast<uint32_t>(entities_.size());
+  entities_.push_back(value_type(id, entity));
+}
+
+void EntityMap::erase(uint32_t id) {
+  uint32_t index = GetDenseIndex(id);
+  CHECK(index != NO_INDEX);
+  if (index + 1 != entities_.size()) {
+    entities_[index] = entities_.back();
+    dense_indices_[IdManager::GetIndex(entities_[index].first)] = index;
+  }
+  entities_.pop_back();
+  dense_indices_[IdManager::GetIndex(id)] = NO_INDEX;
+}
+
+void EntityMap::clear() {
+  entities_.clear();
+  dense_indices_.clear();
+}
+
+uint32_t EntityMap::GetDenseIndex(uint32_t id) const {
+  uint32_t slot = IdManager::GetIndex(id);
+  if (slot >= dense_indices_.size()) {
+    return NO_INDEX;
+  }
+  uint32_t index = dense_indices_[slot];
+  if (index == NO_INDEX || entities_[index].first != id) {
+    return NO_INDEX;
+  }
+  return index;
+}
+
+}  // namespace bm
@@ -0,0 +1,71 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef ENGINE_ENTITY_MAP_H_
+#define ENGINE_ENTITY_MAP_H_
+
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/dll.h"
+
+namespace bm {
+
+class Entity;
+
+// Slot map of entities keyed by the generational ids from 'IdManager'.
+// The entities are stored contiguously in no particular order and are
+// found through a table indexed by the slot of the id. An id of a removed
+// entity isn't found even if its slot has been reused.
+// Inserting and erasing invalidate the iterators.
+class EntityMap {
+ public:
+  typedef std::pair<uint32_t, Entity*> value_type;
+  typedef std::vector<value_type>::iterator iterator;
+  typedef std::vector<value_type>::const_iterator const_iterator;
+
+  BM_ENGINE_DECL EntityMap();
+  BM_ENGINE_DECL ~EntityMap();
+
+  BM_ENGINE_DECL iterator begin();
+  BM_ENGINE_DECL iterator end();
+  BM_ENGINE_DECL const_iterator begin() const;
+  BM_ENGINE_DECL const_iterator end() const;
+
+  BM_ENGINE_DECL size_t size() const;
+  BM_ENGINE_DECL bool empty() const;
+
+  // Returns 'end()' if there is no entity with 'id'.
+  BM_ENGINE_DECL iterator find(uint32_t id);
+  BM_ENGINE_DECL const_iterator find(uint32_t id) const;
+  BM_ENGINE_DECL size_t count(uint32_t id) const;
+
+  // Returns NULL if there is no entity with 'id'.
+  BM_ENGINE_DECL Entity* Get(uint32_t id) const;
+  // Returns the entity in the slot of 'id' whatever its generation,
+  // or NULL if the slot is free.
+  BM_ENGINE_DECL Entity* GetInSlot(uint32_t id) const;
+
+  BM_ENGINE_DECL void insert(uint32_t id, Entity* entity);
+  // Moves the last entity to the place of the erased one.
+  BM_ENGINE_DECL void erase(uint32_t id);
+  BM_ENGINE_DECL void clear();
+
+ private:
+  static const uint32_t NO_INDEX = 0xffffffff;
+
+  // Returns 'NO_INDEX' if there is no entity with 'id'.
+  uint32_t GetDenseIndex(uint32_t id) const;
+
+  std::vector<value_type> entities_;
+  // Indices in 'entities_' indexed by slot.
+  std::vector<uint32_t> dense_indices_;
+
+  DISALLOW_COPY_AND_ASSIGN(EntityMap);
+};
+
+}  // namespace bm
+
+#endif  // ENGINE_ENTITY_MAP_H_
@@ -2,20 +2,131 @@
 
 #include "engine/map.h"
 
+#include <cstring>
+
+#include <algorithm>
 #include <fstream>  // NOLINT
+#include <map>
 #include <string>
 #include <vector>
 
 #include "base/error.h"
 #include "base/json.h"
+#include "base/mapped_file.h"
 #include "base/pstdint.h"
 
 namespace bm {
 
-Map::Map() { }
+namespace {
+
+class NameTable {
+ public:
+  explicit NameTable(std::vector<std::string>* names) : names_(names) { }
+
+  uint32_t Intern(const std::string& name) {
+    auto itr = index_.find(name);
+    if (itr != index_.end()) {
+      return itr->second;
+    }
+    uint32_t index = static_cast<uint32_t>(names_->size());
+    names_->push_back(name);
+    index_[name] = index;
+    return index;
+  }
+
+ private:
+  std::vector<std::string>* names_;
+  std::map<std::string, uint32_t> index_;
+};
+
+bool LoadPlacements(const std::string& file, const char* name,
+    const Json::Value& root, NameTable* names,
+    std::vector<Map::Placement>* placements) {
+  Json::Value array = root[name];
+  if (array.isNull()) {
+    REPORT_ERROR("Config '%s' of type '%s' not found in '%s'.",
+        name, "array", file.c_str());
+    return false;
+  }
+
+  for (int i = 0; i < static_cast<int>(array.size()); i++) {
+    int32_t x, y;
+    int32_t rotation;
+    std::string entity_name;
+
+    if (!GetInt32(array[i]["x"], &x)) {
+      REPORT_ERROR("Config '%s[%d].x' of type '%s' not found in '%s'.",
+          name, i, "int", file.c_str());
+      return false;
+    }
+    if (!GetInt32(array[i]["y"], &y)) {
+      REPORT_ERROR("Config '%s[%d].y' of type '%s' not found in '%s'.",
+          name, i, "int", file.c_str());
+      return false;
+    }
+    if (!GetInt32(array[i]["rotation"], &rotation)) {
+      rotation = 0;
+    }
+    if (!GetString(array[i]["entity"], &entity_name)) {
+      REPORT_ERROR("Config '%s[%d].entity' of type '%s' not found in '%s'.",
+          name, i, "string", file.c_str());
+      return false;
+    }
+
+    placements->push_back(
+        Map::Placement {x, y, rotation, names->Intern(entity_name)});
+  }
+
+  return true;
+}
+
+// Copies 'count' elements at '*offset' into 'output' and advances
+// '*offset' past them and the padding to the next 4-byte boundary.
+template<class T>
+bool ReadArray(const MappedFile& mapping, size_t* offset, size_t count,
+    std::vector<T>* output) {
+  size_t available = mapping.GetSize() - *offset;
+  if (count > available / sizeof(T)) {
+    return false;
+  }
+  size_t size = count * sizeof(T);
+  output->resize(count);
+  if (size != 0) {
+    memcpy(&(*output)[0], mapping.GetData() + *offset, size);
+  }
+  *offset += size;
+  *offset = std::min((*offset + 3) & ~static_cast<size_t>(3),
+      mapping.GetSize());
+  return true;
+}
+
+bool ValidatePlacements(const std::vector<Map::Placement>& placements,
+    size_t entity_name_count) {
+  for (auto placement : placements) {
+    if (placement.entity_name >= entity_name_count) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+Map::Map() : block_size_(0.0f), width_(0), height_(0) { }
 Map::~Map() { }
 
 bool Map::Load(const std::string& file) {
+  Clear();
+  const std::string extension = ".bmap";
+  if (file.size() >= extension.size() &&
+      file.compare(file.size() - extension.size(), extension.size(),
+          extension) == 0) {
+    return LoadBinary(file);
+  }
+  return LoadJson(file);
+}
+
+bool Map::LoadJson(const std::string& file) {
   Json::Reader reader;
   Json::Value root;
 
@@ -58,6 +169,7 @@ bool Map::Load(const std::string& file) {
     return false;
   }
 
+  NameTable sprite_names(&terrain_.sprite_names);
   for (int i = 0; i < static_cast<int>(terrain.size()); i++) {
     std::string sprite_name;
 
@@ -67,7 +179,13 @@ bool Map::Load(const std::string& file) {
       return false;
     }
 
-    terrain_.sprite_names.push_back(sprite_name);
+    uint32_t index = sprite_names.Intern(sprite_name);
+    if (index > UINT16_MAX) {
+      REPORT_ERROR("Too many different terrain sprites in '%s'.",
+          file.c_str());
+      return false;
+    }
+    terrain_.tiles.push_back(static_cast<uint16_t>(index));
   }
 
   // Load spawns.
@@ -122,117 +240,113 @@ bool Map::Load(const std::string& file) {
     zombie_spawns_.push_back(Spawn {x, y});
   }
 
-  // Load doors.
+  // Load doors, kits and walls.
 
-  Json::Value doors = root["doors"];
-  if (doors.isNull()) {
-    REPORT_ERROR("Config '%s' of type '%s' not found in '%s'.",
-        "doors", "array", file.c_str());
+  NameTable entity_names(&entity_names_);
+  if (!LoadPlacements(file, "doors", root, &entity_names, &doors_)) {
     return false;
   }
-
-  for (int i = 0; i < static_cast<int>(doors.size()); i++) {
-    int32_t x, y;
-    int32_t rotation;
-    std::string entity_name;
-
-    if (!GetInt32(doors[i]["x"], &x)) {
-      REPORT_ERROR("Config 'doors[%d].x' of type '%s' not found in '%s'.",
-          i, "int", file.c_str());
-      return false;
-    }
-    if (!GetInt32(doors[i]["y"], &y)) {
-      REPORT_ERROR("Config 'doors[%d].y' of type '%s' not found in '%s'.",
-          i, "int", file.c_str());
-      return false;
-    }
-    if (!GetInt32(doors[i]["rotation"], &rotation)) {
-      rotation = 0;
-    }
-    if (!GetString(doors[i]["entity"], &entity_name)) {
-      REPORT_ERROR("Config 'doors[%d].entity' of type '%s' not found in '%s'.",
-          i, "string", file.c_str());
-      return false;
-    }
-
-    doors_.push_back(Door {x, y, rotation, entity_name});
+  if (!LoadPlacements(file, "kits", root, &entity_names, &kits_)) {
+    return false;
   }
-
-  // Load kits.
-
-  Json::Value kits = root["kits"];
-  if (kits.isNull()) {
-    REPORT_ERROR("Config '%s' of type '%s' not found in '%s'.",
-        "kits", "array", file.c_str());
+  if (!LoadPlacements(file, "walls", root, &entity_names, &walls_)) {
     return false;
   }
 
-  for (int i = 0; i < static_cast<int>(kits.size()); i++) {
-    int32_t x, y;
-    int32_t rotation;
-    std::string entity_name;
-
-    if (!GetInt32(kits[i]["x"], &x)) {
-      REPORT_ERROR("Config 'kits[%d].x' of type '%s' not found in '%s'.",
-          i, "int", file.c_str());
-      return false;
-    }
-    if (!GetInt32(kits[i]["y"], &y)) {
-      REPORT_ERROR("Config 'kits[%d].y' of type '%s' not found in '%s'.",
-          i, "int", file.c_str());
-      return false;
-    }
-    if (!GetInt32(kits[i]["rotation"], &rotation)) {
-      rotation = 0;
-    }
-    if (!GetString(kits[i]["entity"], &entity_name)) {
-      REPORT_ERROR("Config 'kits[%d].entity' of type '%s' not found in '%s'.",
-          i, "string", file.c_str());
-      return false;
-    }
+  return true;
+}
 
-    kits_.push_back(Kit {x, y, rotation, entity_name});
+bool Map::LoadBinary(const std::string& file) {
+  MappedFile mapping;
+  if (!mapping.Open(file)) {
+    return false;
   }
 
-  // Load walls.
-
-  Json::Value walls = root["walls"];
-  if (walls.isNull()) {
-    REPORT_ERROR("Config '%s' of type '%s' not found in '%s'.",
-        "walls", "array", file.c_str());
+  BinaryHeader header;
+  if (mapping.GetSize() < sizeof(header)) {
+    REPORT_ERROR("Map '%s' is truncated.", file.c_str());
+    return false;
+  }
+  memcpy(&header, mapping.GetData(), sizeof(header));
+  if (header.magic != BINARY_MAGIC) {
+    REPORT_ERROR("Map '%s' is not a compiled map.", file.c_str());
+    return false;
+  }
+  if (header.version != BINARY_VERSION) {
+    REPORT_ERROR("Map '%s' has version %u, expected %u.", file.c_str(),
+        header.version, BINARY_VERSION);
+    return false;
+  }
+  if (header.width < 0 || header.height < 0 || header.spawn_count == 0) {
+    REPORT_ERROR("Map '%s' is malformed.", file.c_str());
     return false;
   }
 
-  for (int i = 0; i < static_cast<int>(walls.size()); i++) {
-    int32_t x, y;
-    int32_t rotation;
-    std::string entity_name;
+  block_size_ = header.block_size;
+  width_ = header.width;
+  height_ = header.height;
+
+  size_t offset = sizeof(header);
+  size_t name_count = static_cast<size_t>(header.sprite_name_count) +
+      header.entity_name_count;
+  size_t tile_count = static_cast<size_t>(width_) * height_;
+
+  std::vector<BinaryString> strings;
+  std::vector<char> blob;
+  bool success = ReadArray(mapping, &offset, name_count, &strings) &&
+      ReadArray(mapping, &offset, header.string_size, &blob) &&
+      ReadArray(mapping, &offset, tile_count, &terrain_.tiles) &&
+      ReadArray(mapping, &offset, header.spawn_count, &spawns_) &&
+      ReadArray(mapping, &offset, header.zombie_spawn_count,
+          &zombie_spawns_) &&
+      ReadArray(mapping, &offset, header.door_count, &doors_) &&
+      ReadArray(mapping, &offset, header.kit_count, &kits_) &&
+      ReadArray(mapping, &offset, header.wall_count, &walls_);
+  if (!success) {
+    REPORT_ERROR("Map '%s' is truncated.", file.c_str());
+    return false;
+  }
 
-    if (!GetInt32(walls[i]["x"], &x)) {
-      REPORT_ERROR("Config 'walls[%d].x' of type '%s' not found in '%s'.",
-          i, "int", file.c_str());
-      return false;
-    }
-    if (!GetInt32(walls[i]["y"], &y)) {
-      REPORT_ERROR("Config 'walls[%d].y' of type '%s' not found in '%s'.",
-          i, "int", file.c_str());
+  for (size_t i = 0; i < name_count; i++) {
+    const BinaryString& string = strings[i];
+    if (string.offset > blob.size() ||
+        string.length > blob.size() - string.offset) {
+      REPORT_ERROR("Map '%s' is malformed.", file.c_str());
       return false;
     }
-    if (!GetInt32(walls[i]["rotation"], &rotation)) {
-      rotation = 0;
-    }
-    if (!GetString(walls[i]["entity"], &entity_name)) {
-      REPORT_ERROR("Config 'walls[%d].entity' of type '%s' not found in '%s'.",
-          i, "string", file.c_str());
+    std::vector<std::string>* names = (i < header.sprite_name_count) ?
+        &terrain_.sprite_names : &entity_names_;
+    names->push_back(
+        std::string(blob.data() + string.offset, string.length));
+  }
+
+  for (auto tile : terrain_.tiles) {
+    if (tile >= header.sprite_name_count) {
+      REPORT_ERROR("Map '%s' is malformed.", file.c_str());
       return false;
     }
-
-    walls_.push_back(Wall {x, y, rotation, entity_name});
+  }
+  if (!ValidatePlacements(doors_, entity_names_.size()) ||
+      !ValidatePlacements(kits_, entity_names_.size()) ||
+      !ValidatePlacements(walls_, entity_names_.size())) {
+    REPORT_ERROR("Map '%s' is malformed.", file.c_str());
+    return false;
   }
 
   return true;
 }
 
+void Map::Clear() {
+  terrain_.sprite_names.clear();
+  terrain_.tiles.clear();
+  spawns_.clear();
+  zombie_spawns_.clear();
+  doors_.clear();
+  kits_.clear();
+  walls_.clear();
+  entity_names_.clear();
+}
+
 float32_t Map::GetBlockSize() const {
   return block_size_;
 }
@@ -269,4 +383,13 @@ const std::vector<Map::Wall>& Map::GetWalls() const {
   return walls_;
 }
 
+const std::vector<std::string>& Map::GetEntityNames() const {
+  return entity_names_;
+}
+
+const std::string& Map::GetEntityName(const Placement& placement) const {
+  CHECK(placement.entity_name < entity_names_.size());
+  return entity_names_[placement.entity_name];
+}
+
 }  // namespace bm
@@ -12,37 +12,70 @@
 
 namespace bm {
 
+// A map is loaded either from a '.json' file or from a '.bmap' file
+// compiled by 'src/editor/convert.py'. Sprite and entity names are
+// interned, tiles and entities refer to them by index.
+//
+// The '.bmap' format is little-endian, all sections are 4-byte aligned:
+//   BinaryHeader;
+//   BinaryString[sprite_name_count + entity_name_count];
+//   char[string_size]; (padded)
+//   uint16_t[width * height]; (padded, indices into sprite names)
+//   Spawn[spawn_count];
+//   Spawn[zombie_spawn_count];
+//   Placement[door_count];
+//   Placement[kit_count];
+//   Placement[wall_count];
 class Map {
  public:
-  struct Terrain {
-    std::vector<std::string> sprite_names;
+  static const uint32_t BINARY_MAGIC = 0x50414D42;  // "BMAP"
+  static const uint32_t BINARY_VERSION = 1;
+
+  struct BinaryHeader {
+    uint32_t magic;
+    uint32_t version;
+    float32_t block_size;
+    int32_t width;
+    int32_t height;
+    uint32_t sprite_name_count;
+    uint32_t entity_name_count;
+    uint32_t string_size;
+    uint32_t spawn_count;
+    uint32_t zombie_spawn_count;
+    uint32_t door_count;
+    uint32_t kit_count;
+    uint32_t wall_count;
   };
 
-  struct Spawn {
-    int32_t x, y;
+  struct BinaryString {
+    uint32_t offset;
+    uint32_t length;
   };
 
-  struct Door {
-    int32_t x, y;
-    int32_t rotation;
-    std::string entity_name;
+  struct Terrain {
+    // Tile at (x, y) is 'sprite_names[tiles[y * width + x]]'.
+    std::vector<std::string> sprite_names;
+    std::vector<uint16_t> tiles;
   };
 
-  struct Kit {
+  struct Spawn {
     int32_t x, y;
-    int32_t rotation;
-    std::string entity_name;
   };
 
-  struct Wall {
+  struct Placement {
     int32_t x, y;
     int32_t rotation;
-    std::string entity_name;
+    uint32_t entity_name;  // Index into 'GetEntityNames()'.
   };
 
+  typedef Placement Door;
+  typedef Placement Kit;
+  typedef Placement Wall;
+
   BM_ENGINE_DECL Map();
   BM_ENGINE_DECL ~Map();
 
+  // Files with the '.bmap' extension are loaded as compiled maps.
   BM_ENGINE_DECL bool Load(const std::string& file);
 
   BM_ENGINE_DECL float32_t GetBlockSize() const;
@@ -57,7 +90,16 @@ class Map {
   BM_ENGINE_DECL const std::vector<Door>& GetDoors() const;
   BM_ENGINE_DECL const std::vector<Wall>& GetWalls() const;
 
+  BM_ENGINE_DECL const std::vector<std::string>& GetEntityNames() const;
+  BM_ENGINE_DECL const std::string& GetEntityName(
+      const Placement& placement) const;
+
  private:
+  bool LoadJson(const std::string& file);
+  bool LoadBinary(const std::string& file);
+
+  void Clear();
+
   float32_t block_size_;
   int32_t width_;
   int32_t height_;
@@ -68,6 +110,8 @@ class Map {
   std::vector<Door> doors_;
   std::vector<Kit> kits_;
   std::vector<Wall> walls_;
+
+  std::vector<std::string> entity_names_;
 };
 
 }  // namespace bm
@@ -10,6 +10,24 @@
 
 namespace bm {
 
+// Channels of the connection between the client and the server.
+enum Channel {
+  // Login, time synchronization, player info and input.
+  CHANNEL_CONTROL = 0,
+
+  // World states are sent unreliably and a late one is dropped once a newer
+  // one has arrived. Nothing reliable is sent here, since ENet would hold
+  // the newer world states back until a lost reliable packet is resent.
+  CHANNEL_WORLD,
+
+  // Game events and entity disappearances are sent reliably. They carry
+  // the tick of the broadcast they were sent with, so the client orders
+  // them with the world states by the tick.
+  CHANNEL_EVENTS,
+
+  CHANNEL_COUNT
+};
+
 class Packet {
  public:
   enum Type {
@@ -35,6 +53,15 @@ class Packet {
     // S -> C. Followed by 'EntitySnapshot' with the entity description.
     TYPE_ENTITY_APPEARED,  // FIXME(xairy): make a GameEvent.
     TYPE_ENTITY_UPDATED,
+    // S -> C. Followed by 'EntityDisappearance' of an entity that has left
+    // the client's area of interest. The entity still exists on the server.
+    TYPE_ENTITY_DISAPPEARED,
+    // S -> C. Followed by 'WorldState' and 'WorldState::entity_count'
+    // entity records, each is 'EntityDelta' and the changed snapshot fields.
+    TYPE_WORLD_STATE,
+
+    // C -> S. Followed by 'SnapshotAck'.
+    TYPE_SNAPSHOT_ACK,
 
     // S -> C. Followed by 'GameEvent'.
     TYPE_GAME_EVENT,
@@ -54,10 +81,27 @@ class Packet {
   DISALLOW_IMPLICIT_CONSTRUCTORS(Packet);
 };
 
+// Wire encoding of the entity snapshots.
+enum ProtocolVersion {
+  // Snapshots are sent as raw structures.
+  PROTOCOL_VERSION_RAW = 1,
+  // Snapshots are quantized and bit-packed by 'SnapshotCodec'.
+  PROTOCOL_VERSION_COMPACT = 2,
+
+  PROTOCOL_VERSION_LATEST = PROTOCOL_VERSION_COMPACT
+};
+
 struct LoginData {
   static const size_t MAX_LOGIN_LENGTH = 31;
 
+  uint32_t protocol_version;
   char login[MAX_LOGIN_LENGTH + 1];
+
+  // Index of the room on the server.
+  uint32_t room;
+
+  // How far in the past the client renders other entities, in ms.
+  int32_t interpolation_offset;
 };
 
 struct ClientOptions {
@@ -66,6 +110,12 @@ struct ClientOptions {
   float32_t x, y;
   int32_t max_health;
   int32_t energy_capacity;
+
+  // The protocol version chosen by the server and
+  // the position quantization parameters.
+  uint32_t protocol_version;
+  float32_t position_step;
+  int32_t position_bits;
 };
 
 struct TimeSyncData {
@@ -90,6 +140,7 @@ struct PlayerInfo {
 //   data[0] - health
 //   data[1] - energy
 //   data[2] - score
+//   data[3] - sequence of the last processed 'KeyboardEvent'
 // type == EntitySnapshot::ENTITY_TYPE_PROJECTILE:
 //    data[0] - projectile type
 // type == EntitySnapshot::ENTITY_TYPE_WALL:
@@ -138,19 +189,69 @@ struct EntitySnapshot {
     KIT_TYPE_MAX_VALUE
   };
 
-  static const size_t MAX_NAME_LENGTH = 16;
-
   int64_t time;
   uint32_t id;
   float32_t x, y;
   float32_t angle;
 
-  // FIXME(xairy): use numerical id instead.
-  char name[MAX_NAME_LENGTH + 1];
   EntityType type;
+  // Id of the config of the entity among the configs of 'type', see
+  // 'Config'. The client and the server must have the same configs.
+  uint32_t config_id;
   int32_t data[4];
 };
 
+// Header of a world state packet, written field by field without the
+// padding of the structure. A single tick may be split into several
+// world state packets to avoid fragmentation. The entity records store
+// their time relative to 'time' when 'PROTOCOL_VERSION_COMPACT' is used.
+struct WorldState {
+  uint32_t tick;
+  uint16_t part;
+  uint16_t entity_count;
+  int64_t time;
+};
+
+// Header of a delta-compressed 'EntitySnapshot', written field by field
+// without the padding of the structure. Followed by the fields
+// listed in 'fields' in the order of the bits. When 'baseline_tick' is 0
+// all the fields are present, otherwise the omitted fields are the same
+// as in the snapshot of the entity received at 'baseline_tick'.
+struct EntityDelta {
+  enum Field {
+    FIELD_TIME     = 0x0001,
+    FIELD_POSITION = 0x0002,
+    FIELD_ANGLE    = 0x0004,
+    FIELD_CONFIG   = 0x0008,
+    FIELD_TYPE     = 0x0010,
+    FIELD_DATA_0   = 0x0020,
+    FIELD_DATA_1   = 0x0040,
+    FIELD_DATA_2   = 0x0080,
+    FIELD_DATA_3   = 0x0100,
+    FIELD_ALL      = 0x01ff
+  };
+
+  uint32_t baseline_tick;
+  uint32_t id;
+  uint16_t fields;
+};
+
+// The entity isn't in the world states from 'tick' on. Newer world states
+// may show it again if it comes back into the client's area of interest.
+struct EntityDisappearance {
+  uint32_t tick;
+  uint32_t id;
+};
+
+// The client acknowledges the world state packets of 'tick' it has
+// received, so the entity snapshots in them may be used as baselines.
+// Bit 'i' of 'parts' is set if the packet with 'WorldState::part' equal
+// to 'i' has been received.
+struct SnapshotAck {
+  uint32_t tick;
+  uint32_t parts;
+};
+
 struct GameEvent {
   enum EventType {
     TYPE_EXPLOSION,
@@ -158,6 +259,9 @@ struct GameEvent {
   };
 
   EventType type;
+  // The tick of the broadcast the event was sent with. A destroyed entity
+  // isn't in the world states from this tick on.
+  uint32_t tick;
   float32_t x, y;
   EntitySnapshot entity;
 };
@@ -175,6 +279,8 @@ struct KeyboardEvent {
   };
 
   int64_t time;
+  // Increases with every event sent by a client, starting from 1.
+  uint32_t sequence;
   KeyType key_type;
   EventType event_type;
 };
@@ -0,0 +1,283 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "engine/snapshot_codec.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "net/utils.h"
+
+#include "engine/config.h"
+#include "engine/protocol.h"
+
+namespace bm {
+
+namespace {
+
+const float32_t PI = 3.14159265358979f;
+
+const size_t FIELD_BITS = 9;
+SCHECK(EntityDelta::FIELD_ALL < (1 << FIELD_BITS));
+
+const size_t DATA_FIELD_COUNT = 4;
+const uint16_t DATA_FIELDS[DATA_FIELD_COUNT] = {
+  EntityDelta::FIELD_DATA_0,
+  EntityDelta::FIELD_DATA_1,
+  EntityDelta::FIELD_DATA_2,
+  EntityDelta::FIELD_DATA_3
+};
+
+size_t GetIdBits(uint32_t count) {
+  size_t bits = 0;
+  while (count > 1 && ((count - 1) >> bits) != 0) {
+    bits++;
+  }
+  return bits;
+}
+
+}  // anonymous namespace
+
+SnapshotCodec::SnapshotCodec()
+  : position_step_(1.0f), position_bits_(0), state_(STATE_FINALIZED) { }
+
+SnapshotCodec::~SnapshotCodec() { }
+
+int32_t SnapshotCodec::GetPositionBits(float32_t bound,
+    float32_t position_step) {
+  CHECK(position_step > 0.0f);
+  uint32_t steps = static_cast<uint32_t>(std::ceil(bound / position_step));
+  // One more bit for the sign.
+  int32_t bits = 1;
+  while (steps != 0) {
+    bits++;
+    steps >>= 1;
+  }
+  return bits;
+}
+
+bool SnapshotCodec::Initialize(float32_t position_step,
+    int32_t position_bits) {
+  CHECK(state_ == STATE_FINALIZED);
+
+  if (position_step <= 0.0f || position_bits < 2 || position_bits > 32) {
+    REPORT_ERROR("Incorrect position quantization: step %f, %d bits.",
+        position_step, position_bits);
+    return false;
+  }
+  position_step_ = position_step;
+  position_bits_ = position_bits;
+
+  Config* config = Config::GetInstance();
+  config_counts_.assign(EntitySnapshot::ENTITY_TYPE_MAX_VALUE, 0);
+  config_counts_[EntitySnapshot::ENTITY_TYPE_ACTIVATOR] =
+      config->GetActivatorsConfig().size();
+  config_counts_[EntitySnapshot::ENTITY_TYPE_CRITTER] =
+      config->GetCrittersConfig().size();
+  config_counts_[EntitySnapshot::ENTITY_TYPE_DOOR] =
+      config->GetDoorsConfig().size();
+  config_counts_[EntitySnapshot::ENTITY_TYPE_KIT] =
+      config->GetKitsConfig().size();
+  config_counts_[EntitySnapshot::ENTITY_TYPE_PLAYER] =
+      config->GetPlayersConfig().size();
+  config_counts_[EntitySnapshot::ENTITY_TYPE_PROJECTILE] =
+      config->GetProjectilesConfig().size();
+  config_counts_[EntitySnapshot::ENTITY_TYPE_WALL] =
+      config->GetWallsConfig().size();
+
+  config_id_bits_.resize(config_counts_.size());
+  for (size_t i = 0; i < config_counts_.size(); i++) {
+    config_id_bits_[i] = GetIdBits(config_counts_[i]);
+  }
+
+  state_ = STATE_INITIALIZED;
+  return true;
+}
+
+void SnapshotCodec::Encode(BitWriter* writer, const WorldState& state,
+    const EntityDelta& delta, const EntitySnapshot& snapshot) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  CHECK(writer != NULL);
+  CHECK(delta.baseline_tick < state.tick);
+
+  writer->WriteVarUint(delta.id);
+  writer->WriteVarUint(delta.baseline_tick == 0 ? 0 :
+      state.tick - delta.baseline_tick);
+  writer->WriteBits(delta.fields, FIELD_BITS);
+  EncodeFields(writer, state.time, delta.fields, snapshot);
+}
+
+bool SnapshotCodec::DecodeDelta(BitReader* reader, const WorldState& state,
+    EntityDelta* delta) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  CHECK(reader != NULL);
+  CHECK(delta != NULL);
+
+  uint32_t distance;
+  uint32_t fields;
+  if (!reader->ReadVarUint(&delta->id) ||
+      !reader->ReadVarUint(&distance) ||
+      !reader->ReadBits(FIELD_BITS, &fields)) {
+    return false;
+  }
+  if (distance >= state.tick) {
+    return false;
+  }
+  delta->baseline_tick = (distance == 0) ? 0 : state.tick - distance;
+  delta->fields = static_cast<uint16_t>(fields);
+  if (delta->fields & ~EntityDelta::FIELD_ALL) {
+    return false;
+  }
+  if (delta->baseline_tick == 0 && delta->fields != EntityDelta::FIELD_ALL) {
+    return false;
+  }
+  return true;
+}
+
+bool SnapshotCodec::DecodeFields(BitReader* reader, const WorldState& state,
+    const EntityDelta& delta, EntitySnapshot* snapshot) const {
+  CHECK(state_ == STATE_INITIALIZED);
+  CHECK(reader != NULL);
+  CHECK(snapshot != NULL);
+  snapshot->id = delta.id;
+  return DecodeFields(reader, state.time, delta.fields, snapshot);
+}
+
+// The fields are written in the following order: time, position, angle,
+// type, config id and data. The type goes before the config id, since the
+// id takes as many bits as the number of the configs of that type needs.
+
+void SnapshotCodec::EncodeFields(BitWriter* writer, int64_t base_time,
+    uint16_t fields, const EntitySnapshot& snapshot) const {
+  if (fields & EntityDelta::FIELD_TIME) {
+    int64_t offset = snapshot.time - base_time;
+    writer->WriteBool(offset == 0);
+    if (offset != 0) {
+      offset = std::max<int64_t>(offset, INT32_MIN);
+      offset = std::min<int64_t>(offset, INT32_MAX);
+      writer->WriteVarInt(static_cast<int32_t>(offset));
+    }
+  }
+  if (fields & EntityDelta::FIELD_POSITION) {
+    EncodePosition(writer, snapshot.x);
+    EncodePosition(writer, snapshot.y);
+  }
+  if (fields & EntityDelta::FIELD_ANGLE) {
+    float32_t angle = std::fmod(snapshot.angle, 2 * PI);
+    if (angle < 0.0f) {
+      angle += 2 * PI;
+    }
+    uint32_t steps = 1u << ANGLE_BITS;
+    uint32_t value = static_cast<uint32_t>(
+        std::floor(angle / (2 * PI) * steps + 0.5f));
+    writer->WriteBits(value & (steps - 1), ANGLE_BITS);
+  }
+  if (fields & EntityDelta::FIELD_TYPE) {
+    writer->WriteBits(static_cast<uint32_t>(snapshot.type), TYPE_BITS);
+  }
+  if (fields & EntityDelta::FIELD_CONFIG) {
+    EncodeConfigId(writer, snapshot.type, snapshot.config_id);
+  }
+  for (size_t i = 0; i < DATA_FIELD_COUNT; i++) {
+    if (fields & DATA_FIELDS[i]) {
+      writer->WriteVarInt(snapshot.data[i]);
+    }
+  }
+}
+
+bool SnapshotCodec::DecodeFields(BitReader* reader, int64_t base_time,
+    uint16_t fields, EntitySnapshot* snapshot) const {
+  if (fields & EntityDelta::FIELD_TIME) {
+    bool same;
+    if (!reader->ReadBool(&same)) {
+      return false;
+    }
+    int32_t offset = 0;
+    if (!same && !reader->ReadVarInt(&offset)) {
+      return false;
+    }
+    snapshot->time = base_time + offset;
+  }
+  if (fields & EntityDelta::FIELD_POSITION) {
+    if (!DecodePosition(reader, &snapshot->x) ||
+        !DecodePosition(reader, &snapshot->y)) {
+      return false;
+    }
+  }
+  if (fields & EntityDelta::FIELD_ANGLE) {
+    uint32_t value;
+    if (!reader->ReadBits(ANGLE_BITS, &value)) {
+      return false;
+    }
+    snapshot->angle = value * (2 * PI) / (1u << ANGLE_BITS);
+  }
+  if (fields & EntityDelta::FIELD_TYPE) {
+    uint32_t type;
+    if (!reader->ReadBits(TYPE_BITS, &type)) {
+      return false;
+    }
+    if (type >= EntitySnapshot::ENTITY_TYPE_MAX_VALUE) {
+      return false;
+    }
+    snapshot->type = static_cast<EntitySnapshot::EntityType>(type);
+  }
+  if (fields & EntityDelta::FIELD_CONFIG) {
+    if (!DecodeConfigId(reader, snapshot->type, &snapshot->config_id)) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < DATA_FIELD_COUNT; i++) {
+    if (fields & DATA_FIELDS[i]) {
+      if (!reader->ReadVarInt(&snapshot->data[i])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void SnapshotCodec::EncodePosition(BitWriter* writer, float32_t value) const {
+  int64_t max = (static_cast<int64_t>(1) << (position_bits_ - 1)) - 1;
+  int64_t steps = static_cast<int64_t>(
+      std::floor(value / position_step_ + 0.5f));
+  steps = std::max(steps, -max);
+  steps = std::min(steps, max);
+  writer->WriteBits(static_cast<uint32_t>(steps + max), position_bits_);
+}
+
+bool SnapshotCodec::DecodePosition(BitReader* reader,
+    float32_t* value) const {
+  int64_t max = (static_cast<int64_t>(1) << (position_bits_ - 1)) - 1;
+  uint32_t bits;
+  if (!reader->ReadBits(position_bits_, &bits)) {
+    return false;
+  }
+  *value = (static_cast<int64_t>(bits) - max) * position_step_;
+  return true;
+}
+
+void SnapshotCodec::EncodeConfigId(BitWriter* writer,
+    EntitySnapshot::EntityType type, uint32_t config_id) const {
+  CHECK(type < EntitySnapshot::ENTITY_TYPE_MAX_VALUE);
+  CHECK(config_id < config_counts_[type]);
+  writer->WriteBits(config_id, config_id_bits_[type]);
+}
+
+bool SnapshotCodec::DecodeConfigId(BitReader* reader,
+    EntitySnapshot::EntityType type, uint32_t* config_id) const {
+  if (type >= EntitySnapshot::ENTITY_TYPE_MAX_VALUE) {
+    return false;
+  }
+  if (!reader->ReadBits(config_id_bits_[type], config_id)) {
+    return false;
+  }
+  return *config_id < config_counts_[type];
+}
+
+}  // namespace bm
@@ -0,0 +1,83 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef ENGINE_SNAPSHOT_CODEC_H_
+#define ENGINE_SNAPSHOT_CODEC_H_
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "net/utils.h"
+
+#include "engine/dll.h"
+#include "engine/protocol.h"
+
+namespace bm {
+
+// Quantized bit-packed encoding of the entity snapshots used by
+// 'PROTOCOL_VERSION_COMPACT'. Positions are quantized to 'position_step',
+// angles are stored in 'ANGLE_BITS' bits and config ids are stored in
+// as many bits as the number of the configs of the entity type needs.
+class SnapshotCodec {
+ public:
+  static const size_t ANGLE_BITS = 10;
+  static const size_t TYPE_BITS = 3;
+
+  // Position quantization step is the block size divided by this.
+  static const int32_t POSITION_STEPS_PER_BLOCK = 64;
+
+  BM_ENGINE_DECL SnapshotCodec();
+  BM_ENGINE_DECL ~SnapshotCodec();
+
+  // Positions within [-bound, bound] are encoded in 'position_bits' bits.
+  BM_ENGINE_DECL static int32_t GetPositionBits(float32_t bound,
+      float32_t position_step);
+
+  // Counts the entity configs of each type.
+  BM_ENGINE_DECL bool Initialize(float32_t position_step,
+      int32_t position_bits);
+
+  // Encodes an entity record of the world state 'state'. The time of the
+  // snapshot is stored relative to 'state.time'.
+  BM_ENGINE_DECL void Encode(BitWriter* writer, const WorldState& state,
+      const EntityDelta& delta, const EntitySnapshot& snapshot) const;
+
+  BM_ENGINE_DECL bool DecodeDelta(BitReader* reader, const WorldState& state,
+      EntityDelta* delta) const;
+  // 'snapshot' should already contain the baseline.
+  BM_ENGINE_DECL bool DecodeFields(BitReader* reader, const WorldState& state,
+      const EntityDelta& delta, EntitySnapshot* snapshot) const;
+
+ private:
+  void EncodeFields(BitWriter* writer, int64_t base_time,
+      uint16_t fields, const EntitySnapshot& snapshot) const;
+  bool DecodeFields(BitReader* reader, int64_t base_time,
+      uint16_t fields, EntitySnapshot* snapshot) const;
+
+  void EncodePosition(BitWriter* writer, float32_t value) const;
+  bool DecodePosition(BitReader* reader, float32_t* value) const;
+
+  void EncodeConfigId(BitWriter* writer, EntitySnapshot::EntityType type,
+      uint32_t config_id) const;
+  bool DecodeConfigId(BitReader* reader, EntitySnapshot::EntityType type,
+      uint32_t* config_id) const;
+
+  float32_t position_step_;
+  int32_t position_bits_;
+
+  // Number of the configs of each entity type and the bits for their ids.
+  std::vector<uint32_t> config_counts_;
+  std::vector<size_t> config_id_bits_;
+
+  enum {
+    STATE_FINALIZED,
+    STATE_INITIALIZED
+  } state_;
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotCodec);
+};
+
+}  // namespace bm
+
+#endif  // ENGINE_SNAPSHOT_CODEC_H_
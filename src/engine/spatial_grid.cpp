@@ -0,0 +1,130 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "engine/spatial_grid.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+SpatialGrid::SpatialGrid(float cell_size) : cell_size_(cell_size) {
+  CHECK(cell_size > 0.0f);
+}
+
+SpatialGrid::~SpatialGrid() { }
+
+float SpatialGrid::GetCellSize() const {
+  return cell_size_;
+}
+
+void SpatialGrid::Reset(float cell_size) {
+  CHECK(cell_size > 0.0f);
+  cell_size_ = cell_size;
+  cells_.clear();
+  entity_cells_.clear();
+}
+
+void SpatialGrid::Insert(uint32_t id, const b2Vec2& position) {
+  CHECK(entity_cells_.count(id) == 0);
+  CellKey key = GetCellKey(position);
+  entity_cells_[id] = key;
+  AddToCell(id, key);
+}
+
+void SpatialGrid::Remove(uint32_t id) {
+  auto itr = entity_cells_.find(id);
+  CHECK(itr != entity_cells_.end());
+  RemoveFromCell(id, itr->second);
+  entity_cells_.erase(itr);
+}
+
+void SpatialGrid::Move(uint32_t id, const b2Vec2& position) {
+  auto itr = entity_cells_.find(id);
+  CHECK(itr != entity_cells_.end());
+  CellKey key = GetCellKey(position);
+  if (key == itr->second) {
+    return;
+  }
+  RemoveFromCell(id, itr->second);
+  AddToCell(id, key);
+  itr->second = key;
+}
+
+void SpatialGrid::Query(const b2Vec2& lower, const b2Vec2& upper,
+    std::vector<uint32_t>* ids) const {
+  CHECK(ids != NULL);
+  int32_t min_x = GetCellCoordinate(lower.x);
+  int32_t min_y = GetCellCoordinate(lower.y);
+  int32_t max_x = GetCellCoordinate(upper.x);
+  int32_t max_y = GetCellCoordinate(upper.y);
+  if (min_x > max_x || min_y > max_y) {
+    return;
+  }
+
+  // Walking over the stored cells is cheaper for huge rectangles.
+  int64_t cell_count = static_cast<int64_t>(max_x - min_x + 1) *
+      (max_y - min_y + 1);
+  if (cell_count > static_cast<int64_t>(cells_.size())) {
+    for (auto& cell : cells_) {
+      int32_t x = static_cast<int32_t>(cell.first >> 32);
+      int32_t y = static_cast<int32_t>(cell.first & 0xffffffff);
+      if (x >= min_x && x <= max_x && y >= min_y && y <= max_y) {
+        ids->insert(ids->end(), cell.second.begin(), cell.second.end());
+      }
+    }
+    return;
+  }
+
+  for (int32_t x = min_x; x <= max_x; x++) {
+    for (int32_t y = min_y; y <= max_y; y++) {
+      auto cell = cells_.find(GetCellKey(x, y));
+      if (cell != cells_.end()) {
+        ids->insert(ids->end(), cell->second.begin(), cell->second.end());
+      }
+    }
+  }
+}
+
+int32_t SpatialGrid::GetCellCoordinate(float value) const {
+  return static_cast<int32_t>(floorf(value / cell_size_));
+}
+
+SpatialGrid::CellKey SpatialGrid::GetCellKey(int32_t x, int32_t y) const {
+  // The coordinates are made unsigned first, since shifting a negative
+  // value is undefined.
+  return (static_cast<CellKey>(static_cast<uint32_t>(x)) << 32) |
+      static_cast<CellKey>(static_cast<uint32_t>(y));
+}
+
+SpatialGrid::CellKey SpatialGrid::GetCellKey(const b2Vec2& position) const {
+  return GetCellKey(GetCellCoordinate(position.x),
+      GetCellCoordinate(position.y));
+}
+
+void SpatialGrid::AddToCell(uint32_t id, CellKey key) {
+  cells_[key].push_back(id);
+}
+
+void SpatialGrid::RemoveFromCell(uint32_t id, CellKey key) {
+  auto cell = cells_.find(key);
+  CHECK(cell != cells_.end());
+  std::vector<uint32_t>* ids = &cell->second;
+  auto itr = std::find(ids->begin(), ids->end(), id);
+  CHECK(itr != ids->end());
+  *itr = ids->back();
+  ids->pop_back();
+  if (ids->empty()) {
+    cells_.erase(cell);
+  }
+}
+
+}  // namespace bm
@@ -0,0 +1,61 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef ENGINE_SPATIAL_GRID_H_
+#define ENGINE_SPATIAL_GRID_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/dll.h"
+
+namespace bm {
+
+// Uniform grid of square cells that indexes entity ids by position.
+// Only the non-empty cells are stored.
+class SpatialGrid {
+ public:
+  BM_ENGINE_DECL explicit SpatialGrid(float cell_size);
+  BM_ENGINE_DECL ~SpatialGrid();
+
+  BM_ENGINE_DECL float GetCellSize() const;
+
+  // Removes all the entities and changes the cell size.
+  BM_ENGINE_DECL void Reset(float cell_size);
+
+  BM_ENGINE_DECL void Insert(uint32_t id, const b2Vec2& position);
+  BM_ENGINE_DECL void Remove(uint32_t id);
+
+  // Moves the entity to the cell containing 'position' if it has changed.
+  BM_ENGINE_DECL void Move(uint32_t id, const b2Vec2& position);
+
+  // Appends the ids of the entities from all the cells overlapping the
+  // rectangle ['lower', 'upper']. Some of the entities may lie outside.
+  BM_ENGINE_DECL void Query(const b2Vec2& lower, const b2Vec2& upper,
+      std::vector<uint32_t>* ids) const;
+
+ private:
+  typedef uint64_t CellKey;
+
+  int32_t GetCellCoordinate(float value) const;
+  CellKey GetCellKey(int32_t x, int32_t y) const;
+  CellKey GetCellKey(const b2Vec2& position) const;
+
+  void AddToCell(uint32_t id, CellKey key);
+  void RemoveFromCell(uint32_t id, CellKey key);
+
+  float cell_size_;
+
+  std::unordered_map<CellKey, std::vector<uint32_t> > cells_;
+  std::unordered_map<uint32_t, CellKey> entity_cells_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpatialGrid);
+};
+
+}  // namespace bm
+
+#endif  // ENGINE_SPATIAL_GRID_H_
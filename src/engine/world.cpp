@@ -2,16 +2,26 @@
 
 #include "engine/world.h"
 
-#include <map>
+#include <vector>
 
 #include <Box2D/Box2D.h>
 
+#include "base/error.h"
 #include "base/id_manager.h"
 #include "base/pstdint.h"
 
+#include "engine/spatial_grid.h"
+
 namespace bm {
 
-World::World() : world_(b2Vec2(0.0f, 0.0f)) { }
+namespace {
+
+// Replaced with the block size once the map is loaded.
+const float DEFAULT_GRID_CELL_SIZE = 32.0f;
+
+}  // anonymous namespace
+
+World::World() : world_(b2Vec2(0.0f, 0.0f)), grid_(DEFAULT_GRID_CELL_SIZE) { }
 
 World::~World() {
   for (auto i : static_entities_) {
@@ -26,43 +36,109 @@ b2World* World::GetBox2DWorld() {
   return &world_;
 }
 
-Entity* World::GetEntity(uint32_t id) {
-  if (static_entities_.count(id) == 1) {
-    return static_entities_[id];
-  } else if (dynamic_entities_.count(id) == 1) {
-    return dynamic_entities_[id];
+Entity* World::GetEntity(uint32_t id) const {
+  Entity* entity = dynamic_entities_.Get(id);
+  if (entity == NULL) {
+    entity = static_entities_.Get(id);
+  }
+  return entity;
+}
+
+Entity* World::GetEntityInSlot(uint32_t id) const {
+  Entity* entity = dynamic_entities_.GetInSlot(id);
+  if (entity == NULL) {
+    entity = static_entities_.GetInSlot(id);
   }
-  return NULL;
+  return entity;
 }
 
-std::map<uint32_t, Entity*>* World::GetStaticEntities() {
+EntityMap* World::GetStaticEntities() {
   return &static_entities_;
 }
 
-std::map<uint32_t, Entity*>* World::GetDynamicEntities() {
+EntityMap* World::GetDynamicEntities() {
+  return &dynamic_entities_;
+}
+
+const EntityMap* World::GetDynamicEntities() const {
   return &dynamic_entities_;
 }
 
 void World::AddEntity(uint32_t id, Entity* entity) {
   CHECK(static_entities_.count(id) == 0 && dynamic_entities_.count(id) == 0);
   if (entity->IsStatic()) {
-    static_entities_[id] = entity;
+    static_entities_.insert(id, entity);
   } else {
-    dynamic_entities_[id] = entity;
+    dynamic_entities_.insert(id, entity);
   }
+  grid_.Insert(id, entity->GetPosition());
 }
 
 void World::RemoveEntity(uint32_t id) {
   CHECK(static_entities_.count(id) + dynamic_entities_.count(id) == 1);
-  Entity* entity = NULL;
   if (static_entities_.count(id) == 1) {
-    entity = static_entities_[id];
     static_entities_.erase(id);
-  } else if (dynamic_entities_.count(id) == 1) {
-    entity = dynamic_entities_[id];
+  } else {
     dynamic_entities_.erase(id);
   }
+  grid_.Remove(id);
+}
+
+void World::SetGridCellSize(float cell_size) {
+  grid_.Reset(cell_size);
+  for (auto i : static_entities_) {
+    grid_.Insert(i.first, i.second->GetPosition());
+  }
+  for (auto i : dynamic_entities_) {
+    grid_.Insert(i.first, i.second->GetPosition());
+  }
+}
+
+void World::UpdateGrid() {
+  for (auto i : dynamic_entities_) {
+    grid_.Move(i.first, i.second->GetPosition());
+  }
+}
+
+void World::UpdateGrid(Entity* entity) {
   CHECK(entity != NULL);
+  grid_.Move(entity->GetId(), entity->GetPosition());
+}
+
+void World::QueryEntities(const b2Vec2& center, float radius,
+    std::vector<Entity*>* entities) {
+  QueryEntities(center, radius, &query_ids_, entities);
+}
+
+void World::QueryEntities(const b2Vec2& center, float radius,
+    std::vector<uint32_t>* ids, std::vector<Entity*>* entities) const {
+  CHECK(ids != NULL);
+  CHECK(entities != NULL);
+  ids->clear();
+  b2Vec2 extent(radius, radius);
+  grid_.Query(center - extent, center + extent, ids);
+  float radius2 = radius * radius;
+  for (uint32_t id : *ids) {
+    Entity* entity = GetEntity(id);
+    if ((entity->GetPosition() - center).LengthSquared() <= radius2) {
+      entities->push_back(entity);
+    }
+  }
+}
+
+void World::QueryEntities(const b2Vec2& lower, const b2Vec2& upper,
+    std::vector<Entity*>* entities) {
+  CHECK(entities != NULL);
+  query_ids_.clear();
+  grid_.Query(lower, upper, &query_ids_);
+  for (uint32_t id : query_ids_) {
+    Entity* entity = GetEntity(id);
+    b2Vec2 position = entity->GetPosition();
+    if (position.x >= lower.x && position.x <= upper.x &&
+        position.y >= lower.y && position.y <= upper.y) {
+      entities->push_back(entity);
+    }
+  }
 }
 
 }  // namespace bm
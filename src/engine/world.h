@@ -3,7 +3,7 @@
 #ifndef ENGINE_WORLD_H_
 #define ENGINE_WORLD_H_
 
-#include <map>
+#include <vector>
 
 #include <Box2D/Box2D.h>
 
@@ -12,6 +12,8 @@
 
 #include "engine/dll.h"
 #include "engine/entity.h"
+#include "engine/entity_map.h"
+#include "engine/spatial_grid.h"
 
 namespace bm {
 
@@ -22,19 +24,49 @@ class World {
 
   BM_ENGINE_DECL b2World* GetBox2DWorld();
 
-  BM_ENGINE_DECL Entity* GetEntity(uint32_t id);
-  BM_ENGINE_DECL std::map<uint32_t, Entity*>* GetStaticEntities();
-  BM_ENGINE_DECL std::map<uint32_t, Entity*>* GetDynamicEntities();
+  // Entity ids are generational, see 'IdManager'.
+  // Returns NULL if the entity has been removed.
+  BM_ENGINE_DECL Entity* GetEntity(uint32_t id) const;
+  // Returns the entity in the slot of 'id' whatever its generation,
+  // or NULL if the slot is free.
+  BM_ENGINE_DECL Entity* GetEntityInSlot(uint32_t id) const;
+  BM_ENGINE_DECL EntityMap* GetStaticEntities();
+  BM_ENGINE_DECL EntityMap* GetDynamicEntities();
+  BM_ENGINE_DECL const EntityMap* GetDynamicEntities() const;
 
   // 'RemoveEntity()' doesn't delete the entity object.
   BM_ENGINE_DECL void AddEntity(uint32_t id, Entity* entity);
   BM_ENGINE_DECL void RemoveEntity(uint32_t id);
 
+  // The entities are indexed in a uniform grid by their positions.
+  // The grid is rebuilt when the cell size is changed.
+  BM_ENGINE_DECL void SetGridCellSize(float cell_size);
+
+  // Moves the dynamic entities to their current cells in the grid.
+  // Should be called after the physics step.
+  BM_ENGINE_DECL void UpdateGrid();
+  // Should be called after the entity is moved outside of the physics step.
+  BM_ENGINE_DECL void UpdateGrid(Entity* entity);
+
+  // Appends the entities with positions within 'radius' from 'center'.
+  BM_ENGINE_DECL void QueryEntities(const b2Vec2& center, float radius,
+      std::vector<Entity*>* entities);
+  // Same as above, but uses 'ids' as the scratch buffer, so it may be called
+  // from several threads at once while the world isn't modified.
+  BM_ENGINE_DECL void QueryEntities(const b2Vec2& center, float radius,
+      std::vector<uint32_t>* ids, std::vector<Entity*>* entities) const;
+  // Appends the entities with positions within ['lower', 'upper'].
+  BM_ENGINE_DECL void QueryEntities(const b2Vec2& lower, const b2Vec2& upper,
+      std::vector<Entity*>* entities);
+
  private:
   b2World world_;
 
-  std::map<uint32_t, Entity*> static_entities_;
-  std::map<uint32_t, Entity*> dynamic_entities_;
+  EntityMap static_entities_;
+  EntityMap dynamic_entities_;
+
+  SpatialGrid grid_;
+  std::vector<uint32_t> query_ids_;
 };
 
 }  // namespace bm
@@ -0,0 +1,211 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "engine/world_state.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include <map>
+#include <vector>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "net/utils.h"
+
+#include "engine/delta.h"
+#include "engine/protocol.h"
+#include "engine/snapshot_codec.h"
+
+namespace bm {
+
+namespace {
+
+// The header is written field by field, so its layout doesn't depend on
+// how the compiler pads 'WorldState'.
+const size_t ENTITY_COUNT_OFFSET =
+    sizeof(Packet::Type) + sizeof(uint32_t) + sizeof(uint16_t);
+const size_t HEADER_SIZE =
+    ENTITY_COUNT_OFFSET + sizeof(uint16_t) + sizeof(int64_t);
+
+template<class T>
+void AppendField(std::vector<char>* buffer, const T& value) {
+  buffer->insert(buffer->end(),
+    reinterpret_cast<const char*>(&value),
+    reinterpret_cast<const char*>(&value) + sizeof(value));
+}
+
+// The size of 'buffer' should be checked by the caller.
+template<class T>
+void ReadField(const std::vector<char>& buffer, size_t* offset, T* value) {
+  memcpy(value, &buffer[*offset], sizeof(*value));
+  *offset += sizeof(*value);
+}
+
+}  // anonymous namespace
+
+WorldStateWriter::WorldStateWriter()
+  : max_packet_size_(0), codec_(NULL), packet_count_(0), packet_bits_(0) {
+  header_.tick = 0;
+  header_.part = 0;
+  header_.entity_count = 0;
+  header_.time = 0;
+}
+
+WorldStateWriter::~WorldStateWriter() { }
+
+void WorldStateWriter::Reset(uint32_t tick, int64_t time,
+    size_t max_packet_size, const SnapshotCodec* codec) {
+  CHECK(max_packet_size > HEADER_SIZE);
+  header_.tick = tick;
+  header_.part = 0;
+  header_.entity_count = 0;
+  header_.time = time;
+  max_packet_size_ = max_packet_size;
+  codec_ = codec;
+  packet_count_ = 0;
+  packet_bits_ = 0;
+}
+
+uint32_t WorldStateWriter::AddEntity(const EntityDelta& delta,
+    const EntitySnapshot& snapshot) {
+  record_.clear();
+  size_t record_bits;
+  if (codec_ != NULL) {
+    BitWriter writer(&record_);
+    codec_->Encode(&writer, header_, delta, snapshot);
+    record_bits = writer.GetBitCount();
+  } else {
+    AppendEntityDelta(&record_, delta, snapshot);
+    record_bits = record_.size() * 8;
+  }
+
+  // A record larger than the limit gets a packet of its own.
+  if (packet_count_ == 0 || (header_.entity_count != 0 &&
+      (packet_bits_ + record_bits + 7) / 8 > max_packet_size_)) {
+    StartPacket();
+  }
+
+  std::vector<char>* packet = &packets_[packet_count_ - 1];
+  if (codec_ != NULL) {
+    BitWriter writer(packet, packet_bits_);
+    writer.WriteBuffer(record_, record_bits);
+    packet_bits_ = writer.GetBitCount();
+  } else {
+    packet->insert(packet->end(), record_.begin(), record_.end());
+    packet_bits_ = packet->size() * 8;
+  }
+
+  header_.entity_count++;
+  memcpy(&(*packet)[ENTITY_COUNT_OFFSET], &header_.entity_count,
+      sizeof(header_.entity_count));
+
+  return header_.part;
+}
+
+size_t WorldStateWriter::GetPacketCount() const {
+  return packet_count_;
+}
+
+const std::vector<char>& WorldStateWriter::GetPacket(size_t index) const {
+  CHECK(index < packet_count_);
+  return packets_[index];
+}
+
+void WorldStateWriter::StartPacket() {
+  if (packet_count_ == packets_.size()) {
+    packets_.push_back(std::vector<char>());
+    packets_.back().reserve(max_packet_size_);
+  }
+  std::vector<char>* packet = &packets_[packet_count_];
+  header_.part = static_cast<uint16_t>(packet_count_);
+  header_.entity_count = 0;
+  packet_count_++;
+
+  Packet::Type type = Packet::TYPE_WORLD_STATE;
+
+  packet->clear();
+  AppendField(packet, type);
+  AppendField(packet, header_.tick);
+  AppendField(packet, header_.part);
+  AppendField(packet, header_.entity_count);
+  AppendField(packet, header_.time);
+  CHECK(packet->size() == HEADER_SIZE);
+  packet_bits_ = packet->size() * 8;
+}
+
+bool ExtractWorldState(const std::vector<char>& buffer,
+    const SnapshotCodec* codec,
+    std::map<uint32_t, SnapshotHistory>* baselines,
+    WorldState* state, std::vector<EntitySnapshot>* snapshots,
+    size_t* skipped_count) {
+  CHECK(baselines != NULL);
+  CHECK(state != NULL);
+  CHECK(snapshots != NULL);
+  CHECK(skipped_count != NULL);
+
+  if (buffer.size() < HEADER_SIZE) {
+    return false;
+  }
+  size_t header_offset = sizeof(Packet::Type);
+  ReadField(buffer, &header_offset, &state->tick);
+  ReadField(buffer, &header_offset, &state->part);
+  ReadField(buffer, &header_offset, &state->entity_count);
+  ReadField(buffer, &header_offset, &state->time);
+
+  snapshots->clear();
+  *skipped_count = 0;
+
+  size_t offset = HEADER_SIZE;
+  BitReader reader(buffer, HEADER_SIZE);
+
+  for (uint32_t i = 0; i < state->entity_count; i++) {
+    EntityDelta delta;
+    if (codec != NULL) {
+      if (!codec->DecodeDelta(&reader, *state, &delta)) {
+        return false;
+      }
+    } else {
+      if (!ExtractEntityDelta(buffer, &offset, &delta)) {
+        return false;
+      }
+    }
+
+    EntitySnapshot snapshot;
+    const EntitySnapshot* baseline = NULL;
+    if (delta.baseline_tick != 0) {
+      baseline = (*baselines)[delta.id].Get(delta.baseline_tick);
+      if (baseline != NULL) {
+        snapshot = *baseline;
+      }
+    }
+
+    if (codec != NULL) {
+      if (!codec->DecodeFields(&reader, *state, delta, &snapshot)) {
+        return false;
+      }
+    } else {
+      if (!ExtractEntityDeltaFields(buffer, &offset, delta, &snapshot)) {
+        return false;
+      }
+    }
+
+    if (delta.baseline_tick != 0 && baseline == NULL) {
+      REPORT_WARNING("No baseline %u for entity %u.",
+          delta.baseline_tick, delta.id);
+      (*skipped_count)++;
+      continue;
+    }
+
+    (*baselines)[delta.id].Add(state->tick, state->part, snapshot);
+    snapshots->push_back(snapshot);
+  }
+
+  if (codec != NULL) {
+    offset = reader.GetByteOffset();
+  }
+  return offset == buffer.size();
+}
+
+}  // namespace bm
@@ -0,0 +1,69 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef ENGINE_WORLD_STATE_H_
+#define ENGINE_WORLD_STATE_H_
+
+#include <map>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/delta.h"
+#include "engine/dll.h"
+#include "engine/protocol.h"
+#include "engine/snapshot_codec.h"
+
+namespace bm {
+
+// Packs entity records of a tick into 'TYPE_WORLD_STATE' packets, starting
+// a new packet only when the current one would exceed the size limit.
+// The packet buffers are reused between ticks.
+class WorldStateWriter {
+ public:
+  BM_ENGINE_DECL WorldStateWriter();
+  BM_ENGINE_DECL ~WorldStateWriter();
+
+  // Drops the packets and starts packing the tick 'tick'. The records are
+  // encoded with 'codec' or sent as raw structures if 'codec' is NULL.
+  BM_ENGINE_DECL void Reset(uint32_t tick, int64_t time,
+      size_t max_packet_size, const SnapshotCodec* codec);
+
+  // Returns the index of the packet the record has been added to.
+  BM_ENGINE_DECL uint32_t AddEntity(const EntityDelta& delta,
+      const EntitySnapshot& snapshot);
+
+  BM_ENGINE_DECL size_t GetPacketCount() const;
+  BM_ENGINE_DECL const std::vector<char>& GetPacket(size_t index) const;
+
+ private:
+  void StartPacket();
+
+  WorldState header_;
+  size_t max_packet_size_;
+  const SnapshotCodec* codec_;
+
+  std::vector<std::vector<char> > packets_;
+  size_t packet_count_;
+  size_t packet_bits_;
+
+  std::vector<char> record_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorldStateWriter);
+};
+
+// Extracts the entity snapshots from a 'TYPE_WORLD_STATE' packet encoded
+// with 'codec' or with raw structures if 'codec' is NULL. The snapshots are
+// restored from 'baselines' and added there. Records whose baselines are
+// missing are skipped and counted in 'skipped_count'. The packet shouldn't
+// be acknowledged then, so that the server falls back to another baseline.
+// Returns 'false' when the format is incorrect.
+BM_ENGINE_DECL bool ExtractWorldState(const std::vector<char>& buffer,
+    const SnapshotCodec* codec,
+    std::map<uint32_t, SnapshotHistory>* baselines,
+    WorldState* state, std::vector<EntitySnapshot>* snapshots,
+    size_t* skipped_count);
+
+}  // namespace bm
+
+#endif  // ENGINE_WORLD_STATE_H_
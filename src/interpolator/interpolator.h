@@ -5,31 +5,51 @@
 
 #include <cstddef>
 
-#include <list>
-#include <utility>
-
 namespace interpolator {
 
+// The frame type should support 'a + b', 'a - b' and 'scalar * a'.
+
 template<class V> V lerp(const V& a, const V& b, double bRatio) {
-  return V(a * (1 - bRatio) + b * bRatio);
+  return V((1 - bRatio) * a + bRatio * b);
 }
 
-template<class FrameT, class TimeT>
-class LinearInterpolator {
- public:
-  typedef std::pair<FrameT, TimeT> TimedFrame;
+// Cubic Hermite spline between 'a' and 'b' with the tangents 'ta' and
+// 'tb', which are the velocities scaled by the length of the interval.
+template<class V> V hermite(const V& a, const V& ta, const V& b, const V& tb,
+    double bRatio) {
+  double t = bRatio;
+  double t2 = t * t;
+  double t3 = t2 * t;
+  double h00 = 2 * t3 - 3 * t2 + 1;
+  double h10 = t3 - 2 * t2 + t;
+  double h01 = -2 * t3 + 3 * t2;
+  double h11 = t3 - t2;
+  return V(h00 * a + h10 * ta + h01 * b + h11 * tb);
+}
 
-  LinearInterpolator(TimeT timeOffset, size_t frameCount = 2)
-    : timeOffset(timeOffset), frameCount(frameCount) { }
+enum Mode {
+  MODE_LINEAR,
+  MODE_HERMITE
+};
 
-  size_t GetFrameCount() const {
-    return frameCount;
+// Keeps the last 'Capacity' frames in a ring buffer and interpolates
+// between the two that surround the requested time, so no memory is
+// allocated after construction. Past the newest frame the value is
+// extrapolated with the last velocity for at most 'maxExtrapolation'.
+// Velocities are estimated from the neighbouring frames unless given.
+template<class FrameT, class TimeT, size_t Capacity = 16>
+class Interpolator {
+ public:
+  explicit Interpolator(TimeT timeOffset = TimeT(), Mode mode = MODE_LINEAR,
+      TimeT maxExtrapolation = TimeT())
+    : timeOffset(timeOffset), maxExtrapolation(maxExtrapolation),
+      mode(mode), first(0), count(0) { }
+
+  static size_t GetCapacity() {
+    return Capacity;
   }
-  void SetFrameCount(size_t count) {
-    frameCount = count;
-    while (frames.size() > frameCount) {
-      frames.pop_front();
-    }
+  size_t GetFrameCount() const {
+    return count;
   }
 
   TimeT GetTimeOffset() const {
@@ -39,54 +59,139 @@ class LinearInterpolator {
     timeOffset = value;
   }
 
-  void Push(const FrameT& frame, TimeT time) {
-    // drop frame if it is too late / time is the same
-    if (frames.size() > 0) {
-      if (time <= frames.back().second) {
-        return;
-      }
-    }
+  TimeT GetMaxExtrapolation() const {
+    return maxExtrapolation;
+  }
+  void SetMaxExtrapolation(TimeT value) {
+    maxExtrapolation = value;
+  }
 
-    // add frame to the frame list, dropping previous if neccessary
-    if (frames.size() == frameCount) {
-      frames.pop_front();
-    }
-    frames.push_back(TimedFrame(frame, time));
+  Mode GetMode() const {
+    return mode;
+  }
+  void SetMode(Mode value) {
+    mode = value;
+  }
+
+  // Returns the time of the newest frame. There should be one.
+  TimeT GetLastTime() const {
+    return At(count - 1).time;
+  }
+
+  void Push(const FrameT& frame, TimeT time) {
+    PushFrame(frame, FrameT(), false, time);
+  }
+  // 'velocity' is the change of the frame per unit of time.
+  void Push(const FrameT& frame, const FrameT& velocity, TimeT time) {
+    PushFrame(frame, velocity, true, time);
   }
 
   void Clear() {
-    frames.clear();
+    first = 0;
+    count = 0;
   }
 
-  FrameT Interpolate(TimeT time) {
+  FrameT Interpolate(TimeT time) const {
     // if we don't have enough frames to interpolate - return default value
-    if (frames.size() == 0) {
+    if (count == 0) {
       return FrameT();
-    } else if (frames.size() == 1) {
-      return frames.back().first;
+    } else if (count == 1) {
+      return At(0).frame;
     }
 
     // subtract lag time (i.e. the difference in times on server and client)
     time = time - timeOffset;
 
-    // get the last two frames
-    typename std::list<TimedFrame>::reverse_iterator it = frames.rbegin();
-    TimedFrame frame2 = *it;
-    TimedFrame frame1 = *(++it);
+    if (time <= At(0).time) {
+      return At(0).frame;
+    }
+    if (time >= At(count - 1).time) {
+      TimeT ahead = time - At(count - 1).time;
+      if (ahead > maxExtrapolation) {
+        ahead = maxExtrapolation;
+      }
+      double dt = static_cast<double>(ahead);
+      return FrameT(At(count - 1).frame + dt * GetVelocity(count - 1));
+    }
+
+    // find the frames with 'frame1.time <= time < frame2.time'
+    size_t low = 0;
+    size_t high = count - 1;
+    while (high - low > 1) {
+      size_t middle = (low + high) / 2;
+      if (At(middle).time <= time) {
+        low = middle;
+      } else {
+        high = middle;
+      }
+    }
+    const TimedFrame& frame1 = At(low);
+    const TimedFrame& frame2 = At(high);
 
     double t = static_cast<double>(time);
-    double f1t = static_cast<double>(frame1.second);
-    double f2t = static_cast<double>(frame2.second);
+    double f1t = static_cast<double>(frame1.time);
+    double f2t = static_cast<double>(frame2.time);
     double ratio = (t - f1t) / (f2t - f1t);
 
-    // interpolate over them
-    return lerp(frame1.first, frame2.first, ratio);
+    if (mode == MODE_HERMITE) {
+      double interval = f2t - f1t;
+      return hermite(frame1.frame, FrameT(interval * GetVelocity(low)),
+          frame2.frame, FrameT(interval * GetVelocity(high)), ratio);
+    }
+    return lerp(frame1.frame, frame2.frame, ratio);
   }
 
  private:
-  size_t frameCount;
-  std::list<TimedFrame> frames;
+  struct TimedFrame {
+    FrameT frame;
+    FrameT velocity;
+    bool hasVelocity;
+    TimeT time;
+  };
+
+  const TimedFrame& At(size_t index) const {
+    return frames[(first + index) % Capacity];
+  }
+
+  void PushFrame(const FrameT& frame, const FrameT& velocity,
+      bool hasVelocity, TimeT time) {
+    // drop frame if it is too late / time is the same
+    if (count > 0 && time <= At(count - 1).time) {
+      return;
+    }
+
+    // overwrite the oldest frame if the buffer is full
+    if (count == Capacity) {
+      first = (first + 1) % Capacity;
+      count--;
+    }
+    TimedFrame& timed = frames[(first + count) % Capacity];
+    timed.frame = frame;
+    timed.velocity = velocity;
+    timed.hasVelocity = hasVelocity;
+    timed.time = time;
+    count++;
+  }
+
+  // Uses the central difference of the neighbours if the velocity
+  // wasn't given. There should be at least two frames.
+  FrameT GetVelocity(size_t index) const {
+    if (At(index).hasVelocity) {
+      return At(index).velocity;
+    }
+    size_t prev = (index == 0) ? 0 : index - 1;
+    size_t next = (index == count - 1) ? index : index + 1;
+    double dt = static_cast<double>(At(next).time - At(prev).time);
+    return FrameT((1 / dt) * (At(next).frame - At(prev).frame));
+  }
+
   TimeT timeOffset;
+  TimeT maxExtrapolation;
+  Mode mode;
+
+  TimedFrame frames[Capacity];
+  size_t first;
+  size_t count;
 };
 
 }  // namespace interpolator
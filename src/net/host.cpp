@@ -95,6 +95,11 @@ void Host::Flush() {
   enet_host_flush(_host);
 }
 
+uint32_t Host::GetTotalSentData() const {
+  CHECK(_state == STATE_INITIALIZED);
+  return _host->totalSentData;
+}
+
 Host::Host() : _state(STATE_FINALIZED), _host(NULL) { }
 
 Peer* Host::_GetPeer(_ENetPeer* enet_peer) {
@@ -64,6 +64,10 @@ class Host {
   // queued packets earlier than in a call to 'Service()'.
   BM_NET_DECL virtual void Flush();
 
+  // Returns the number of bytes sent by the host including the protocol
+  // overhead. The counter wraps around.
+  BM_NET_DECL uint32_t GetTotalSentData() const;
+
  protected:
   // Creates an uninitialized 'Host'.
   Host();
@@ -44,10 +44,23 @@ std::string Peer::GetIp() const {
   return std::string(buffer);
 }
 
+uint32_t Peer::GetAddress() const {
+  return _peer->address.host;
+}
+
 uint16_t Peer::GetPort() const {
   return _peer->address.port;  // XXX: type cast.
 }
 
+size_t Peer::GetMaxUnfragmentedLength() const {
+  return _peer->mtu - sizeof(ENetProtocolHeader) -
+    sizeof(ENetProtocolSendFragment);
+}
+
+uint32_t Peer::GetRoundTripTime() const {
+  return _peer->roundTripTime;
+}
+
 void Peer::Disconnect() {
   enet_peer_disconnect(_peer, 0);
 }
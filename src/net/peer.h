@@ -40,9 +40,19 @@ class Peer {
   // An empty string will be returned in case of an error.
   BM_NET_DECL std::string GetIp() const;
 
+  // Returns the IPv4 address of the remote peer in network byte order.
+  BM_NET_DECL uint32_t GetAddress() const;
+
   // Returns the port of the remote peer.
   BM_NET_DECL uint16_t GetPort() const;
 
+  // Returns the maximum length of a packet that will be sent to the peer
+  // without fragmentation.
+  BM_NET_DECL size_t GetMaxUnfragmentedLength() const;
+
+  // Returns the mean round trip time to the peer in milliseconds.
+  BM_NET_DECL uint32_t GetRoundTripTime() const;
+
   // Request a disconnection from a peer.
   // An 'Event::TYPE_DISCONNECT' event will be generated by
   // 'ServerHost::Service()' or 'ClientHost::Service()' once
@@ -2,6 +2,10 @@
 
 #include "net/utils.h"
 
+#include <cstdio>
+
+#include <algorithm>
+#include <string>
 #include <vector>
 
 #include "base/time.h"
@@ -10,6 +14,134 @@
 
 namespace bm {
 
+BitWriter::BitWriter(std::vector<char>* buffer, size_t bit_count)
+    : buffer_(buffer), bit_count_(bit_count) {
+  CHECK(buffer != NULL);
+  CHECK(bit_count <= buffer->size() * 8);
+  buffer_->resize((bit_count + 7) / 8);
+}
+
+BitWriter::BitWriter(std::vector<char>* buffer)
+    : buffer_(buffer), bit_count_(buffer->size() * 8) {
+  CHECK(buffer != NULL);
+}
+
+void BitWriter::WriteBits(uint32_t value, size_t count) {
+  CHECK(count <= 32);
+  while (count > 0) {
+    size_t index = bit_count_ / 8;
+    size_t shift = bit_count_ % 8;
+    if (index == buffer_->size()) {
+      buffer_->push_back(0);
+    }
+    size_t length = std::min(8 - shift, count);
+    uint8_t bits = static_cast<uint8_t>(value & ((1u << length) - 1));
+    uint8_t byte = static_cast<uint8_t>((*buffer_)[index]);
+    byte = static_cast<uint8_t>((byte & ((1u << shift) - 1)) | (bits << shift));
+    (*buffer_)[index] = static_cast<char>(byte);
+    value >>= length;
+    count -= length;
+    bit_count_ += length;
+  }
+}
+
+void BitWriter::WriteBool(bool value) {
+  WriteBits(value ? 1 : 0, 1);
+}
+
+void BitWriter::WriteVarUint(uint32_t value) {
+  do {
+    WriteBits(value & 0x7f, 7);
+    value >>= 7;
+    WriteBool(value != 0);
+  } while (value != 0);
+}
+
+void BitWriter::WriteVarInt(int32_t value) {
+  uint32_t zigzag = (static_cast<uint32_t>(value) << 1) ^
+      static_cast<uint32_t>(value >> 31);
+  WriteVarUint(zigzag);
+}
+
+void BitWriter::WriteBuffer(const std::vector<char>& data, size_t count) {
+  CHECK(count <= data.size() * 8);
+  for (size_t i = 0; count > 0; i++) {
+    size_t length = std::min<size_t>(8, count);
+    WriteBits(static_cast<uint8_t>(data[i]), length);
+    count -= length;
+  }
+}
+
+size_t BitWriter::GetBitCount() const {
+  return bit_count_;
+}
+
+BitReader::BitReader(const std::vector<char>& buffer, size_t offset)
+    : buffer_(buffer), bit_offset_(offset * 8) { }
+
+bool BitReader::ReadBits(size_t count, uint32_t* value) {
+  CHECK(count <= 32);
+  CHECK(value != NULL);
+  if (bit_offset_ + count > buffer_.size() * 8) {
+    return false;
+  }
+  uint32_t result = 0;
+  size_t position = 0;
+  while (position < count) {
+    size_t index = bit_offset_ / 8;
+    size_t shift = bit_offset_ % 8;
+    size_t length = std::min(8 - shift, count - position);
+    uint32_t byte = static_cast<uint8_t>(buffer_[index]);
+    result |= ((byte >> shift) & ((1u << length) - 1)) << position;
+    position += length;
+    bit_offset_ += length;
+  }
+  *value = result;
+  return true;
+}
+
+bool BitReader::ReadBool(bool* value) {
+  CHECK(value != NULL);
+  uint32_t bit;
+  if (!ReadBits(1, &bit)) {
+    return false;
+  }
+  *value = (bit != 0);
+  return true;
+}
+
+bool BitReader::ReadVarUint(uint32_t* value) {
+  CHECK(value != NULL);
+  uint32_t result = 0;
+  for (size_t shift = 0; shift < 32; shift += 7) {
+    uint32_t group;
+    bool more;
+    if (!ReadBits(7, &group) || !ReadBool(&more)) {
+      return false;
+    }
+    result |= group << shift;
+    if (!more) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BitReader::ReadVarInt(int32_t* value) {
+  CHECK(value != NULL);
+  uint32_t zigzag;
+  if (!ReadVarUint(&zigzag)) {
+    return false;
+  }
+  *value = static_cast<int32_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+  return true;
+}
+
+size_t BitReader::GetByteOffset() const {
+  return (bit_offset_ + 7) / 8;
+}
+
 // Attempts to synchronously disconnect the peer.
 bool DisconnectPeer(
   Peer* peer,
@@ -39,4 +171,12 @@ bool DisconnectPeer(
   return false;
 }
 
+std::string FormatAddress(uint32_t address) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&address);
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u",
+      bytes[0], bytes[1], bytes[2], bytes[3]);
+  return std::string(buffer);
+}
+
 }  // namespace bm
@@ -3,6 +3,7 @@
 #ifndef NET_UTILS_H_
 #define NET_UTILS_H_
 
+#include <string>
 #include <vector>
 
 #include <cstring>
@@ -54,17 +55,73 @@ void AppendPacketToBuffer(
     reinterpret_cast<const char*>(&data) + sizeof(data));
 }
 
+// Writes values bit by bit, the least significant bits first.
+class BitWriter {
+ public:
+  // Starts writing right after the first 'bit_count' bits of 'buffer'.
+  // The rest of 'buffer' is discarded.
+  BM_NET_DECL BitWriter(std::vector<char>* buffer, size_t bit_count);
+
+  // Starts writing at the end of 'buffer'.
+  BM_NET_DECL explicit BitWriter(std::vector<char>* buffer);
+
+  // Writes the 'count' least significant bits of 'value', 'count' <= 32.
+  BM_NET_DECL void WriteBits(uint32_t value, size_t count);
+  BM_NET_DECL void WriteBool(bool value);
+
+  // Writes 'value' in 7-bit groups each followed by a continuation bit.
+  BM_NET_DECL void WriteVarUint(uint32_t value);
+  // Same as 'WriteVarUint()', small negative values are kept short.
+  BM_NET_DECL void WriteVarInt(int32_t value);
+
+  // Writes the first 'count' bits of 'data'.
+  BM_NET_DECL void WriteBuffer(const std::vector<char>& data, size_t count);
+
+  // Returns the number of bits in the buffer.
+  BM_NET_DECL size_t GetBitCount() const;
+
+ private:
+  std::vector<char>* buffer_;
+  size_t bit_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(BitWriter);
+};
+
+// Reads values written by 'BitWriter'.
+// All the methods return 'false' when there is not enough data.
+class BitReader {
+ public:
+  // Starts reading from the byte 'offset' of 'buffer'.
+  BM_NET_DECL BitReader(const std::vector<char>& buffer, size_t offset);
+
+  BM_NET_DECL bool ReadBits(size_t count, uint32_t* value);
+  BM_NET_DECL bool ReadBool(bool* value);
+
+  BM_NET_DECL bool ReadVarUint(uint32_t* value);
+  BM_NET_DECL bool ReadVarInt(int32_t* value);
+
+  // Returns the offset of the first byte that hasn't been touched yet.
+  BM_NET_DECL size_t GetByteOffset() const;
+
+ private:
+  const std::vector<char>& buffer_;
+  size_t bit_offset_;
+
+  DISALLOW_COPY_AND_ASSIGN(BitReader);
+};
+
 template<class PacketType, class DataType>
 bool SendPacket(
     Peer* peer,
     PacketType packet_type,
     const DataType& data,
-    bool reliable = false
+    bool reliable = false,
+    uint8_t channel_id = 0
 ) {
   std::vector<char> buffer;
   AppendPacketToBuffer(buffer, packet_type, data);
 
-  bool rv = peer->Send(&buffer[0], buffer.size(), reliable);
+  bool rv = peer->Send(&buffer[0], buffer.size(), reliable, channel_id);
   if (rv == false) {
     REPORT_ERROR("Couldn't send packet.");
     return false;
@@ -77,12 +134,13 @@ bool BroadcastPacket(
     ServerHost* host,
     PacketType packet_type,
     const DataType& data,
-    bool reliable = false
+    bool reliable = false,
+    uint8_t channel_id = 0
 ) {
   std::vector<char> buffer;
   AppendPacketToBuffer(buffer, packet_type, data);
 
-  bool rv = host->Broadcast(&buffer[0], buffer.size(), reliable);
+  bool rv = host->Broadcast(&buffer[0], buffer.size(), reliable, channel_id);
   if (rv == false) {
     REPORT_ERROR("Couldn't broadcast packet.");
     return false;
@@ -98,6 +156,10 @@ BM_NET_DECL bool DisconnectPeer(
   uint32_t timeout
 );
 
+// Formats an IPv4 address in network byte order as returned by
+// 'Peer::GetAddress()'.
+BM_NET_DECL std::string FormatAddress(uint32_t address);
+
 }  // namespace bm
 
 #endif  // NET_UTILS_H_
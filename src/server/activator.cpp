@@ -10,6 +10,7 @@
 
 #include "base/error.h"
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/body.h"
@@ -21,16 +22,19 @@
 
 namespace bm {
 
+DEFINE_POOLED_ALLOCATION(Activator, 16)
+
 Activator::Activator(
   Controller* controller,
   uint32_t id,
   const b2Vec2& position,
-  const std::string& entity_name
-) : ServerEntity(controller, id, Entity::TYPE_ACTIVATOR, entity_name, position,
+  uint32_t config_id
+) : ServerEntity(controller, id, Entity::TYPE_ACTIVATOR, config_id, position,
                  Entity::FILTER_ACTIVATOR, Entity::FILTER_ALL) {
-  auto config = Config::GetInstance()->GetActivatorsConfig();
-  CHECK(config.count(entity_name) == 1);
-  activation_distance_ = config.at(entity_name).activation_distance;
+  const Config::ActivatorConfig* config =
+      Config::GetInstance()->GetActivatorConfig(config_id);
+  CHECK(config != NULL);
+  activation_distance_ = config->activation_distance;
 }
 
 Activator::~Activator() { }
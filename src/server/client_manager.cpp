@@ -3,22 +3,23 @@
 #include "server/client_manager.h"
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "base/macros.h"
 #include "base/pstdint.h"
 
-#include "net/enet.h"
+#include "engine/protocol.h"
 
 #include "server/entity.h"
 
 namespace bm {
 
-Client::Client(Peer* peer, Player* entity, const std::string& login)
-    : peer(peer), entity(entity), login(login) {
-  CHECK(peer != NULL);
-}
+Client::Client(uint32_t id, Player* entity, const std::string& login)
+    : id(id), entity(entity), login(login),
+      protocol_version(PROTOCOL_VERSION_RAW), max_packet_size(0),
+      round_trip_time(0), interpolation_offset(0) { }
 Client::~Client() { }
 
 ClientManager::ClientManager() { }
@@ -47,11 +48,6 @@ void ClientManager::DeleteClient(uint32_t id, bool deallocate) {
   _clients.erase(id);
 }
 
-void ClientManager::DisconnectClient(uint32_t id) {
-  CHECK(_clients.count(id) == 1);
-  _clients[id]->peer->Disconnect();
-}
-
 std::map<uint32_t, Client*>* ClientManager::GetClients() {
   return &_clients;
 }
@@ -64,11 +60,4 @@ void ClientManager::DeleteClients(const std::vector<uint32_t>& input,
   }
 }
 
-void ClientManager::DisconnectClients(const std::vector<uint32_t>& input) {
-  size_t size = input.size();
-  for (size_t i = 0; i < size; i++) {
-    DisconnectClient(input[i]);
-  }
-}
-
 }  // namespace bm
@@ -4,24 +4,51 @@
 #define SERVER_CLIENT_MANAGER_H_
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "base/pstdint.h"
 
-#include "net/enet.h"
+#include "engine/delta.h"
 
 #include "server/entity.h"
 
 namespace bm {
 
 struct Client {
-  Client(Peer* peer, Player* entity, const std::string& login);
+  Client(uint32_t id, Player* entity, const std::string& login);
   ~Client();
 
-  Peer* peer;
+  // See 'NetworkThread'.
+  uint32_t id;
   Player* entity;
   std::string login;
+
+  // See 'ProtocolVersion'.
+  uint32_t protocol_version;
+
+  // Maximum size of a world state packet that isn't fragmented.
+  size_t max_packet_size;
+
+  // Player actions are checked against the world as the client saw it,
+  // which is half the round trip time plus the interpolation offset ago.
+  // The offset is capped by the server's 'max_interpolation_offset'.
+  uint32_t round_trip_time;
+  int32_t interpolation_offset;
+
+  // Dynamic entities within the client's area of interest that
+  // the client has been told about.
+  std::set<uint32_t> visible_entities;
+
+  // The world states the client has acknowledged and the snapshots sent
+  // to the client, which are used as delta compression baselines.
+  SnapshotAcks snapshot_acks;
+  std::map<uint32_t, SnapshotHistory> snapshot_history;
+
+  // Static entities whose state the client hasn't acknowledged yet
+  // and the ticks they were updated at.
+  std::map<uint32_t, uint32_t> pending_static_entities;
 };
 
 class ClientManager {
@@ -33,11 +60,9 @@ class ClientManager {
 
   Client* GetClient(uint32_t id);
   void DeleteClient(uint32_t id, bool deallocate);
-  void DisconnectClient(uint32_t id);
 
   std::map<uint32_t, Client*>* GetClients();
   void DeleteClients(const std::vector<uint32_t>& input, bool deallocate);
-  void DisconnectClients(const std::vector<uint32_t>& input);
 
  private:
   std::map<uint32_t, Client*> _clients;
@@ -0,0 +1,242 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "server/config_reloader.h"
+
+#ifdef __linux__
+  #include <poll.h>
+  #include <sys/inotify.h>
+  #include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+#include "base/time.h"
+#include "base/utils.h"
+
+#include "engine/config.h"
+
+namespace bm {
+
+namespace {
+
+// Maximum time in ms the thread waits for changes before checking
+// whether it should stop.
+const int32_t WAIT_TIMEOUT = 100;
+
+// Editors and 'config-compiler' may write a file in several steps, so
+// the configs are reloaded only after the files haven't changed for
+// this long, in ms.
+const int64_t SETTLE_TIME = 250;
+
+}  // anonymous namespace
+
+ConfigReloader::ConfigReloader()
+  :
+#ifdef __linux__
+    inotify_fd_(-1),
+#endif
+    stop_(false),
+    state_(STATE_FINALIZED) { }
+
+ConfigReloader::~ConfigReloader() {
+  if (state_ == STATE_INITIALIZED) {
+    Stop();
+  }
+}
+
+#ifdef __linux__
+
+bool ConfigReloader::Start() {
+  CHECK(state_ == STATE_FINALIZED);
+
+  files_ = Config::GetGameDataFiles();
+
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ == -1) {
+    REPORT_ERROR("Unable to initialize inotify: %s.", strerror(errno));
+    return false;
+  }
+
+  // The directories are watched rather than the files, since editors
+  // often replace a file instead of writing it in place.
+  directories_.clear();
+  for (auto& file : files_) {
+    size_t slash = file.rfind('/');
+    std::string directory =
+        (slash == std::string::npos) ? "." : file.substr(0, slash);
+    int watch = inotify_add_watch(inotify_fd_, directory.c_str(),
+        IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch == -1) {
+      REPORT_ERROR("Unable to watch '%s': %s.", directory.c_str(),
+          strerror(errno));
+      close(inotify_fd_);
+      inotify_fd_ = -1;
+      return false;
+    }
+    directories_[watch] = directory;
+  }
+
+  stop_ = false;
+  thread_ = std::thread(&ConfigReloader::Run, this);
+
+  state_ = STATE_INITIALIZED;
+  return true;
+}
+
+bool ConfigReloader::WaitForChanges() {
+  pollfd descriptor;
+  descriptor.fd = inotify_fd_;
+  descriptor.events = POLLIN;
+  descriptor.revents = 0;
+  if (poll(&descriptor, 1, WAIT_TIMEOUT) <= 0) {
+    return false;
+  }
+
+  bool changed = false;
+  alignas(inotify_event) char buffer[4096];
+  while (true) {
+    ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break;
+    }
+    ssize_t offset = 0;
+    while (offset < length) {
+      const inotify_event* event =
+          reinterpret_cast<const inotify_event*>(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+      if (event->len == 0) {
+        continue;
+      }
+      auto directory = directories_.find(event->wd);
+      if (directory == directories_.end()) {
+        continue;
+      }
+      std::string path = directory->second + "/" + event->name;
+      for (auto& file : files_) {
+        if (file == path || "./" + file == path) {
+          changed = true;
+        }
+      }
+    }
+  }
+  return changed;
+}
+
+#else
+
+bool ConfigReloader::Start() {
+  CHECK(state_ == STATE_FINALIZED);
+
+  files_ = Config::GetGameDataFiles();
+
+  // The missing files are treated as changed when they appear.
+  modification_times_.assign(files_.size(), -1);
+  for (size_t i = 0; i < files_.size(); i++) {
+    GetModificationTime(files_[i], &modification_times_[i]);
+  }
+
+  stop_ = false;
+  thread_ = std::thread(&ConfigReloader::Run, this);
+
+  state_ = STATE_INITIALIZED;
+  return true;
+}
+
+bool ConfigReloader::WaitForChanges() {
+  std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT));
+
+  bool changed = false;
+  for (size_t i = 0; i < files_.size(); i++) {
+    int64_t time;
+    if (GetModificationTime(files_[i], &time) &&
+        time != modification_times_[i]) {
+      modification_times_[i] = time;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+#endif
+
+void ConfigReloader::Stop() {
+  CHECK(state_ == STATE_INITIALIZED);
+  stop_ = true;
+  thread_.join();
+#ifdef __linux__
+  close(inotify_fd_);
+  inotify_fd_ = -1;
+  directories_.clear();
+#endif
+  pending_.reset();
+  state_ = STATE_FINALIZED;
+}
+
+void ConfigReloader::Apply() {
+  CHECK(state_ == STATE_INITIALIZED);
+
+  std::unique_ptr<Config> config;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config.swap(pending_);
+  }
+  if (config.get() == NULL) {
+    return;
+  }
+
+  if (!Config::GetInstance()->SwapGameData(config.get())) {
+    Error::Print();
+    Error::Clear();
+    REPORT_WARNING("The reloaded configs require a restart, ignoring them.");
+    return;
+  }
+
+  printf("Configs reloaded.\n");
+}
+
+void ConfigReloader::Run() {
+  bool changed = false;
+  int64_t change_time = 0;
+  while (!stop_) {
+    if (WaitForChanges()) {
+      changed = true;
+      change_time = Timestamp();
+    }
+    if (changed && Timestamp() - change_time >= SETTLE_TIME) {
+      changed = false;
+      Reload();
+    }
+  }
+}
+
+void ConfigReloader::Reload() {
+  // The configs are parsed here, so the simulation thread only swaps
+  // them in.
+  std::unique_ptr<Config> config(new Config());
+  if (!config->Initialize()) {
+    Error::Print();
+    Error::Clear();
+    REPORT_WARNING("Can't reload the configs, keeping the current ones.");
+    return;
+  }
+
+  // Replaces the configs that haven't been applied yet, if any.
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.swap(config);
+}
+
+}  // namespace bm
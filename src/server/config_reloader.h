@@ -0,0 +1,77 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef SERVER_CONFIG_RELOADER_H_
+#define SERVER_CONFIG_RELOADER_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/config.h"
+
+namespace bm {
+
+// Watches the game data configs and reloads them on its own thread when
+// they change, so that balancing changes don't require a restart.
+// The reloaded configs are applied by the simulation thread between
+// ticks. The entities that already exist keep their parameters, the ones
+// created afterwards get the new ones.
+class ConfigReloader {
+ public:
+  ConfigReloader();
+  ~ConfigReloader();
+
+  // Starts watching the files returned by 'Config::GetGameDataFiles()'.
+  bool Start();
+
+  // Stops the thread. Automatically called in the destructor.
+  void Stop();
+
+  // Swaps the last reloaded configs into 'Config::GetInstance()', if
+  // there are any. Must be called when no other thread uses the configs.
+  // The configs that can't be applied are dropped with a warning.
+  void Apply();
+
+ private:
+  void Run();
+
+  // Waits for a while and returns 'true' if a watched file has changed.
+  bool WaitForChanges();
+
+  void Reload();
+
+  std::vector<std::string> files_;
+
+#ifdef __linux__
+  int inotify_fd_;
+  // Watched directories by the watch descriptors.
+  std::map<int, std::string> directories_;
+#else
+  std::vector<int64_t> modification_times_;
+#endif
+
+  std::thread thread_;
+  std::atomic<bool> stop_;
+
+  // The configs reloaded but not applied yet, guarded by 'mutex_'.
+  std::mutex mutex_;
+  std::unique_ptr<Config> pending_;
+
+  enum {
+    STATE_FINALIZED,
+    STATE_INITIALIZED
+  } state_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConfigReloader);
+};
+
+}  // namespace bm
+
+#endif  // SERVER_CONFIG_RELOADER_H_
@@ -5,7 +5,10 @@
 #include <cmath>
 #include <cstdlib>
 
+#include <algorithm>
+#include <deque>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <utility>
@@ -32,8 +35,38 @@
 
 namespace bm {
 
-Controller::Controller() : world_(this) {
+namespace {
+
+// Maximum number of walls created by slime explosions per tick. Each one
+// gets a Box2D body, so creating a lot of them at once stalls the tick.
+const size_t MORPH_BUDGET = 32;
+
+bool IsInside(const b2Vec2& point, const b2Vec2& lower,
+    const b2Vec2& upper) {
+  return point.x >= lower.x && point.x <= upper.x &&
+      point.y >= lower.y && point.y <= upper.y;
+}
+
+}  // anonymous namespace
+
+Controller::Controller()
+    : world_(this), profiler_(NULL), last_update_time_(0),
+      position_history_(
+          Config::GetInstance()->GetServerConfig().max_rewind),
+      zombie_spawn_counter_(0) {
   world_.GetBox2DWorld()->SetContactListener(&contact_listener_);
+
+  Config* config = Config::GetInstance();
+  CHECK(Config::FindId(config->GetPlayersConfig(), "player",
+      &player_config_id_));
+  CHECK(Config::FindId(config->GetCrittersConfig(), "zombie",
+      &zombie_config_id_));
+  CHECK(Config::FindId(config->GetWallsConfig(), "morphed_wall",
+      &morphed_wall_config_id_));
+  CHECK(Config::FindId(config->GetGunsConfig(), "bazooka",
+      &bazooka_config_id_));
+  CHECK(Config::FindId(config->GetGunsConfig(), "morpher",
+      &morpher_config_id_));
 }
 
 Controller::~Controller() { }
@@ -42,28 +75,65 @@ ServerWorld* Controller::GetWorld() {
   return &world_;
 }
 
+void Controller::SetProfiler(TickProfiler* profiler) {
+  profiler_ = profiler;
+}
+
 std::vector<GameEvent>* Controller::GetGameEvents() {
   return &game_events_;
 }
 
 void Controller::Update(int64_t time, int64_t time_delta) {
-  SpawnZombies();
-  UpdateEntities(time_delta);
-  StepPhysics(time_delta);
-  DestroyOutlyingEntities();
-  RespawnDeadPlayers();
-  DeleteDestroyedEntities(time, time_delta);
+  ScopedPhase update_phase(profiler_, TickProfiler::PHASE_UPDATE);
 
-  // TODO(xairy): refactor.
-  std::vector<std::pair<b2Vec2, int> >::iterator it;
-  for (it = morph_list_.begin(); it != morph_list_.end(); ++it) {
-    MakeSlimeExplosion(it->first, it->second);
+  {
+    ScopedPhase phase(profiler_, TickProfiler::PHASE_SPAWN_ZOMBIES);
+    SpawnZombies();
+  }
+  {
+    ScopedPhase phase(profiler_, TickProfiler::PHASE_UPDATE_ENTITIES);
+    UpdateEntities(time_delta);
+  }
+  {
+    ScopedPhase phase(profiler_, TickProfiler::PHASE_STEP_PHYSICS);
+    StepPhysics(time_delta);
+  }
+  {
+    ScopedPhase phase(profiler_,
+        TickProfiler::PHASE_DESTROY_OUTLYING_ENTITIES);
+    DestroyOutlyingEntities();
+  }
+  {
+    ScopedPhase phase(profiler_, TickProfiler::PHASE_RESPAWN_DEAD_PLAYERS);
+    RespawnDeadPlayers();
+  }
+  {
+    ScopedPhase phase(profiler_,
+        TickProfiler::PHASE_DELETE_DESTROYED_ENTITIES);
+    DeleteDestroyedEntities(time, time_delta);
+  }
+
+  {
+    ScopedPhase phase(profiler_, TickProfiler::PHASE_MORPH);
+    ProcessMorphRequests();
+  }
+  {
+    ScopedPhase phase(profiler_, TickProfiler::PHASE_RECORD_POSITIONS);
+    position_history_.Record(time, *world_.GetDynamicEntities());
+    last_update_time_ = time;
+  }
+
+  if (profiler_ != NULL) {
+    profiler_->AddSample(TickProfiler::COUNTER_DYNAMIC_ENTITIES,
+        world_.GetDynamicEntities()->size());
+    profiler_->AddSample(TickProfiler::COUNTER_STATIC_ENTITIES,
+        world_.GetStaticEntities()->size());
   }
-  morph_list_.clear();
 }
 
 Player* Controller::OnPlayerConnected() {
-  Player* player = world_.CreatePlayer(b2Vec2(0.0f, 0.0f), "player");
+  Player* player = world_.CreatePlayer(b2Vec2(0.0f, 0.0f),
+      player_config_id_);
   RespawnPlayer(player);
   OnEntityAppearance(player);
   return player;
@@ -74,7 +144,13 @@ void Controller::OnPlayerDisconnected(Player* player) {
 }
 
 void Controller::OnEntityAppearance(Entity* entity) {
-  std::map<uint32_t, Entity*>::iterator itr, end;
+  // Only critters and players target each other.
+  if (entity->GetType() != Entity::TYPE_CRITTER &&
+      entity->GetType() != Entity::TYPE_PLAYER) {
+    return;
+  }
+
+  EntityMap::iterator itr, end;
   end = world_.GetDynamicEntities()->end();
   for (itr = world_.GetDynamicEntities()->begin(); itr != end; ++itr) {
     Entity::Type itr_type = itr->second->GetType();
@@ -106,7 +182,12 @@ void Controller::OnEntityAppearance(Entity* entity) {
 }
 
 void Controller::OnEntityDisappearance(Entity* entity) {
-  std::map<uint32_t, Entity*>::iterator itr, end;
+  if (entity->GetType() != Entity::TYPE_CRITTER &&
+      entity->GetType() != Entity::TYPE_PLAYER) {
+    return;
+  }
+
+  EntityMap::iterator itr, end;
   end = world_.GetDynamicEntities()->end();
   for (itr = world_.GetDynamicEntities()->begin(); itr != end; ++itr) {
     Entity::Type itr_type = itr->second->GetType();
@@ -135,16 +216,20 @@ void Controller::OnKeyboardEvent(Player* player, const KeyboardEvent& event) {
 
 void Controller::OnMouseEvent(Player* player, const MouseEvent& event) {
   if (event.event_type == MouseEvent::EVENT_KEYDOWN) {
-    std::string gun_name;
+    uint32_t gun_id;
     if (event.button_type == MouseEvent::BUTTON_LEFT) {
-      gun_name = "bazooka";
+      gun_id = bazooka_config_id_;
     } else if (event.button_type == MouseEvent::BUTTON_RIGHT) {
-      gun_name = "morpher";
+      gun_id = morpher_config_id_;
+    } else {
+      return;
     }
 
-    auto config = Config::GetInstance()->GetGunsConfig().at(gun_name);
-    int energy_consumption = config.energy_consumption;
-    std::string projectile_config = config.projectile_name;
+    const Config::GunConfig* config =
+        Config::GetInstance()->GetGunConfig(gun_id);
+    CHECK(config != NULL);
+    int energy_consumption = config->energy_consumption;
+    uint32_t projectile_config = config->projectile_id;
 
     if (player->GetEnergy() >= energy_consumption) {
       player->AddEnergy(-energy_consumption);
@@ -164,45 +249,52 @@ void Controller::OnMouseEvent(Player* player, const MouseEvent& event) {
   }
 }
 
-void Controller::OnPlayerAction(Player* player, const PlayerAction& event) {
+void Controller::OnPlayerAction(Player* player, const PlayerAction& event,
+    int64_t rewind) {
   if (event.type == PlayerAction::TYPE_ACTIVATE) {
     Entity* entity = world_.GetEntity(event.target_id);
     if (entity == NULL) {
       return;
     }
 
-    // Check visibility.
-    b2Body* body = RayCast(world_.GetBox2DWorld(), player->GetPosition(),
-      entity->GetPosition());
-    if (body == NULL) {
-      return;
-    }
-    if (entity != static_cast<Entity*>(body->GetUserData())) {
+    // The action is judged in the rewound world, but takes effect in
+    // the present one.
+    RewindEntities(rewind, player, entity->GetPosition());
+    bool can_activate = CanActivate(player, entity);
+    RestoreEntities();
+    if (!can_activate) {
       return;
     }
 
     if (entity->GetType() == Entity::TYPE_ACTIVATOR) {
-      Activator* activator = static_cast<Activator*>(entity);
-
-      // Check distance.
-      if (Length(entity->GetPosition() - player->GetPosition()) >
-          activator->GetActivationDistance()) {
-        return;
-      }
-
-      activator->Activate(player);
+      static_cast<Activator*>(entity)->Activate(player);
     } else if (entity->GetType() == Entity::TYPE_DOOR) {
-      Door* door = static_cast<Door*>(entity);
+      static_cast<Door*>(entity)->Activate(player);
+    }
+  }
+}
 
-      // Check distance.
-      if (Length(entity->GetPosition() - player->GetPosition()) >
-          door->GetActivationDistance()) {
-        return;
-      }
+bool Controller::CanActivate(Player* player, Entity* entity) {
+  // Check visibility.
+  b2Body* body = RayCast(world_.GetBox2DWorld(), player->GetPosition(),
+    entity->GetPosition());
+  if (body == NULL) {
+    return false;
+  }
+  if (entity != static_cast<Entity*>(body->GetUserData())) {
+    return false;
+  }
 
-      door->Activate(player);
-    }
+  // Check distance.
+  float distance = Length(entity->GetPosition() - player->GetPosition());
+  if (entity->GetType() == Entity::TYPE_ACTIVATOR) {
+    Activator* activator = static_cast<Activator*>(entity);
+    return distance <= activator->GetActivationDistance();
+  } else if (entity->GetType() == Entity::TYPE_DOOR) {
+    Door* door = static_cast<Door*>(entity);
+    return distance <= door->GetActivationDistance();
   }
+  return false;
 }
 
 // Collisions.
@@ -281,9 +373,7 @@ void Controller::OnCollision(Projectile* first, Projectile* second) {
 // Updating.
 
 void Controller::SpawnZombies() {
-
-  static int counter = 0;
-  if (counter == 300) {
+  if (zombie_spawn_counter_ == 300) {
     bool player_found = false;
     for (auto i : *world_.GetDynamicEntities()) {
       ServerEntity* entity = static_cast<ServerEntity*>(i.second);
@@ -296,16 +386,16 @@ void Controller::SpawnZombies() {
       return;
     }
     for (auto spawn : *world_.GetZombieSpawnPositions()) {
-      Critter* critter = world_.CreateCritter(spawn, "zombie");
+      Critter* critter = world_.CreateCritter(spawn, zombie_config_id_);
       OnEntityAppearance(critter);
     }
-    counter = 0;
+    zombie_spawn_counter_ = 0;
   }
-  counter++;
+  zombie_spawn_counter_++;
 }
 
 void Controller::UpdateEntities(int64_t time_delta) {
-  std::map<uint32_t, Entity*>::iterator i, end;
+  EntityMap::iterator i, end;
   end = world_.GetDynamicEntities()->end();
   for (i = world_.GetDynamicEntities()->begin(); i != end; ++i) {
     Entity* entity = i->second;
@@ -340,17 +430,12 @@ void Controller::StepPhysics(int64_t time_delta) {
   int32_t position_iterations = 2;
   world_.GetBox2DWorld()->Step(static_cast<float>(time_delta) / 1000,
       velocity_iterations, position_iterations);
+  world_.UpdateGrid();
 }
 
 void Controller::DestroyOutlyingEntities() {
+  // Static entities don't move and are never created outside the bound.
   float bound = world_.GetBound();
-  for (auto i : *world_.GetStaticEntities()) {
-    ServerEntity* entity = static_cast<ServerEntity*>(i.second);
-    b2Vec2 position = entity->GetPosition();
-    if (std::abs(position.x) > bound || std::abs(position.y) > bound) {
-      entity->Destroy();
-    }
-  }
   for (auto i : *world_.GetDynamicEntities()) {
     ServerEntity* entity = static_cast<ServerEntity*>(i.second);
     b2Vec2 position = entity->GetPosition();
@@ -380,6 +465,7 @@ void Controller::RespawnPlayer(Player* player) {
   size_t spawn_count = world_.GetSpawnPositions()->size();
   size_t spawn = Random(spawn_count);
   player->SetPosition(world_.GetSpawnPositions()->at(spawn));
+  world_.UpdateGrid(player);
   player->RestoreHealth();
 }
 
@@ -397,11 +483,12 @@ void Controller::UpdateScore(Player* player) {
 }
 
 void Controller::DeleteDestroyedEntities(int64_t time, int64_t time_delta) {
-  std::map<uint32_t, Entity*>::iterator itr, end;
-  end = world_.GetStaticEntities()->end();
-  for (itr = world_.GetStaticEntities()->begin(); itr != end;) {
-    ServerEntity* entity = static_cast<ServerEntity*>(itr->second);
-    ++itr;
+  // Removing an entity moves the last one to its place,
+  // so the entities are walked from the end.
+  EntityMap* entities = world_.GetStaticEntities();
+  for (size_t i = entities->size(); i > 0; i--) {
+    ServerEntity* entity = static_cast<ServerEntity*>(
+        (entities->begin() + (i - 1))->second);
     if (entity->IsDestroyed()) {
       GameEvent event;
       event.type = GameEvent::TYPE_ENTITY_DISAPPEARED;
@@ -414,10 +501,10 @@ void Controller::DeleteDestroyedEntities(int64_t time, int64_t time_delta) {
       delete entity;
     }
   }
-  end = world_.GetDynamicEntities()->end();
-  for (itr = world_.GetDynamicEntities()->begin(); itr != end;) {
-    ServerEntity* entity = static_cast<ServerEntity*>(itr->second);
-    ++itr;
+  entities = world_.GetDynamicEntities();
+  for (size_t i = entities->size(); i > 0; i--) {
+    ServerEntity* entity = static_cast<ServerEntity*>(
+        (entities->begin() + (i - 1))->second);
     if (entity->IsDestroyed()) {
       GameEvent event;
       event.type = GameEvent::TYPE_ENTITY_DISAPPEARED;
@@ -432,6 +519,48 @@ void Controller::DeleteDestroyedEntities(int64_t time, int64_t time_delta) {
   }
 }
 
+// Lag compensation.
+
+void Controller::RewindEntities(int64_t rewind, Player* player,
+    const b2Vec2& target) {
+  CHECK(rewound_entities_.empty());
+  rewind = std::max<int64_t>(0, rewind);
+  rewind = std::min(rewind, position_history_.GetDuration());
+  if (!position_history_.GetPositions(last_update_time_ - rewind,
+      &rewound_positions_)) {
+    return;
+  }
+
+  // Only the entities that may block the segment, either now or back
+  // then, are moved, since each move touches the Box2D broadphase.
+  // Dynamic entities are smaller than a block.
+  b2Vec2 margin(world_.GetBlockSize(), world_.GetBlockSize());
+  b2Vec2 lower = b2Min(player->GetPosition(), target) - margin;
+  b2Vec2 upper = b2Max(player->GetPosition(), target) + margin;
+
+  // The entities that appeared later stay where they are.
+  for (auto& rewound : rewound_positions_) {
+    Entity* entity = world_.GetDynamicEntities()->Get(rewound.id);
+    if (entity == NULL || entity == player) {
+      continue;
+    }
+    b2Vec2 position = entity->GetPosition();
+    if (!IsInside(position, lower, upper) &&
+        !IsInside(rewound.position, lower, upper)) {
+      continue;
+    }
+    rewound_entities_.push_back(std::make_pair(entity, position));
+    entity->SetPosition(rewound.position);
+  }
+}
+
+void Controller::RestoreEntities() {
+  for (auto& rewound : rewound_entities_) {
+    rewound.first->SetPosition(rewound.second);
+  }
+  rewound_entities_.clear();
+}
+
 // Explosions.
 
 void Controller::DestroyProjectile(Projectile* projectile) {
@@ -443,9 +572,8 @@ void Controller::DestroyProjectile(Projectile* projectile) {
         projectile->GetRocketExplosionDamage(),
         projectile->GetOwnerId());
     } else if (projectile->GetProjectileType() == Projectile::TYPE_SLIME) {
-      morph_list_.push_back(
-        std::pair<b2Vec2, int>(projectile->GetPosition(),
-          projectile->GetSlimeExplosionRadius()));
+      MakeSlimeExplosion(projectile->GetPosition(),
+        projectile->GetSlimeExplosionRadius());
     }
     projectile->Destroy();
   }
@@ -456,19 +584,10 @@ void Controller::MakeRocketExplosion(const b2Vec2& location, float radius,
   // FIXME(xairy): can miss huge entities.
   radius += 13.0f;
 
-  for (auto i : *world_.GetStaticEntities()) {
-    ServerEntity* entity = static_cast<ServerEntity*>(i.second);
-    float distance2 = (entity->GetPosition() - location).LengthSquared();
-    if (distance2 <= radius * radius) {
-      entity->Damage(damage, source_id);
-    }
-  }
-  for (auto i : *world_.GetDynamicEntities()) {
-    ServerEntity* entity = static_cast<ServerEntity*>(i.second);
-    float distance2 = (entity->GetPosition() - location).LengthSquared();
-    if (distance2 <= radius * radius) {
-      entity->Damage(damage, source_id);
-    }
+  std::vector<Entity*> entities;
+  world_.QueryEntities(location, radius, &entities);
+  for (auto entity : entities) {
+    static_cast<ServerEntity*>(entity)->Damage(damage, source_id);
   }
 
   GameEvent event;
@@ -479,18 +598,74 @@ void Controller::MakeRocketExplosion(const b2Vec2& location, float radius,
 }
 
 void Controller::MakeSlimeExplosion(const b2Vec2& location, int radius) {
-  float block_size = 16.0f;
+  float block_size = world_.GetBlockSize();
+  float bound = world_.GetBound();
   int lx = static_cast<int>(round(location.x / block_size));
   int ly = static_cast<int>(round(location.y / block_size));
+
+  morph_requests_.push_back(MorphRequest());
+  MorphRequest& request = morph_requests_.back();
+  request.next_cell = 0;
   for (int x = -radius; x <= radius; x++) {
     for (int y = -radius; y <= radius; y++) {
-      if (x * x + y * y <= radius * radius) {
-        Wall* wall = world_.CreateWall(b2Vec2((lx + x) * block_size,
-          (ly + y) * block_size), "morphed_wall");
-        OnEntityAppearance(wall);
+      if (x * x + y * y > radius * radius) {
+        continue;
+      }
+      if (std::abs((lx + x) * block_size) > bound ||
+          std::abs((ly + y) * block_size) > bound) {
+        continue;
+      }
+      Cell cell(lx + x, ly + y);
+      if (morph_cells_.insert(cell).second) {
+        request.cells.push_back(cell);
+      }
+    }
+  }
+  if (request.cells.empty()) {
+    morph_requests_.pop_back();
+  }
+}
+
+// Morphing.
+
+void Controller::ProcessMorphRequests() {
+  float block_size = world_.GetBlockSize();
+  size_t budget = MORPH_BUDGET;
+
+  while (!morph_requests_.empty()) {
+    MorphRequest& request = morph_requests_.front();
+    while (request.next_cell < request.cells.size() && budget > 0) {
+      const Cell& cell = request.cells[request.next_cell];
+      request.next_cell++;
+      morph_cells_.erase(cell);
+
+      b2Vec2 position(cell.first * block_size, cell.second * block_size);
+      if (IsWallAt(position)) {
+        continue;
       }
+      // The wall is sent as soon as it collides, so that the clients
+      // don't mispredict against walls they don't see.
+      Wall* wall = world_.CreateWall(position, morphed_wall_config_id_);
+      OnEntityAppearance(wall);
+      budget--;
+    }
+    if (request.next_cell < request.cells.size()) {
+      return;
+    }
+    morph_requests_.pop_front();
+  }
+}
+
+bool Controller::IsWallAt(const b2Vec2& position) {
+  morph_query_.clear();
+  world_.QueryEntities(position, world_.GetBlockSize() / 4, &morph_query_);
+  for (auto entity : morph_query_) {
+    if (entity->GetType() == Entity::TYPE_WALL &&
+        !static_cast<ServerEntity*>(entity)->IsDestroyed()) {
+      return true;
     }
   }
+  return false;
 }
 
 }  // namespace bm
@@ -3,7 +3,9 @@
 #ifndef SERVER_CONTROLLER_H_
 #define SERVER_CONTROLLER_H_
 
+#include <deque>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <utility>
@@ -14,6 +16,8 @@
 
 #include "server/contact_listener.h"
 #include "server/entity.h"
+#include "server/position_history.h"
+#include "server/tick_profiler.h"
 #include "server/world.h"
 
 namespace bm {
@@ -33,6 +37,9 @@ class Controller {
 
   ServerWorld* GetWorld();
 
+  // The phases of 'Update()' are timed with 'profiler' if it isn't NULL.
+  void SetProfiler(TickProfiler* profiler);
+
   // The list of the events should be cleared by the caller.
   std::vector<GameEvent>* GetGameEvents();
 
@@ -49,7 +56,10 @@ class Controller {
   void OnKeyboardEvent(Player* player, const KeyboardEvent& event);
   void OnMouseEvent(Player* player, const MouseEvent& event);
 
-  void OnPlayerAction(Player* player, const PlayerAction& event);
+  // The action is checked against the world as it was 'rewind' ms ago,
+  // when the player saw it. The rewind is limited by 'max_rewind'.
+  void OnPlayerAction(Player* player, const PlayerAction& event,
+      int64_t rewind);
 
   // Collisions.
 
@@ -100,20 +110,71 @@ class Controller {
   void UpdateScore(Player* player);
   void DeleteDestroyedEntities(int64_t time, int64_t time_delta);
 
+  // Lag compensation.
+
+  // Moves the dynamic entities except 'player' that may block the segment
+  // from 'player' to 'target' to their positions 'rewind' ms ago.
+  // 'RestoreEntities()' should be called before anything else happens
+  // to the world.
+  void RewindEntities(int64_t rewind, Player* player, const b2Vec2& target);
+  void RestoreEntities();
+
+  // Returns 'true' if 'entity' is visible to 'player' and close enough to
+  // be activated by it.
+  bool CanActivate(Player* player, Entity* entity);
+
   // Projectiles.
 
   void DestroyProjectile(Projectile* projectile);
   void MakeRocketExplosion(const b2Vec2& location, float radius,
                            int damage, uint32_t source_id);
+  // Queues the walls of the explosion, see 'ProcessMorphRequests()'.
   void MakeSlimeExplosion(const b2Vec2& location, int radius);
 
+  // Morphing.
+
+  // Creates the walls of the queued slime explosions in order, at most
+  // 'MORPH_BUDGET' walls per tick. Each batch is published with the
+  // tick that creates it.
+  void ProcessMorphRequests();
+  bool IsWallAt(const b2Vec2& position);
+
   ServerWorld world_;
   ContactListener contact_listener_;
 
-  // TODO(xairy): refactor.
-  std::vector<std::pair<b2Vec2, int> > morph_list_;
+  // A grid cell, in blocks.
+  typedef std::pair<int32_t, int32_t> Cell;
+
+  // A slime explosion whose walls are being created.
+  struct MorphRequest {
+    std::vector<Cell> cells;
+    size_t next_cell;
+  };
+
+  std::deque<MorphRequest> morph_requests_;
+  // The cells of the queued requests that aren't processed yet. Explosions
+  // overlapping the queued ones only get the cells that aren't here.
+  std::set<Cell> morph_cells_;
+  std::vector<Entity*> morph_query_;
 
   std::vector<GameEvent> game_events_;
+
+  TickProfiler* profiler_;
+
+  int64_t last_update_time_;
+  PositionHistory position_history_;
+  std::vector<PositionHistory::EntityPosition> rewound_positions_;
+  std::vector<std::pair<Entity*, b2Vec2> > rewound_entities_;
+
+  // Zombies are spawned every 300 updates.
+  int32_t zombie_spawn_counter_;
+
+  // Ids of the configs the controller creates entities from.
+  uint32_t player_config_id_;
+  uint32_t zombie_config_id_;
+  uint32_t morphed_wall_config_id_;
+  uint32_t bazooka_config_id_;
+  uint32_t morpher_config_id_;
 };
 
 }  // namespace bm
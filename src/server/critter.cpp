@@ -9,6 +9,7 @@
 
 #include "base/error.h"
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/body.h"
@@ -20,18 +21,21 @@
 
 namespace bm {
 
+DEFINE_POOLED_ALLOCATION(Critter, 64)
+
 Critter::Critter(
   Controller* controller,
   uint32_t id,
   const b2Vec2& position,
-  const std::string& entity_name
-) : ServerEntity(controller, id, Entity::TYPE_CRITTER, entity_name, position,
+  uint32_t config_id
+) : ServerEntity(controller, id, Entity::TYPE_CRITTER, config_id, position,
            Entity::FILTER_CRITTER, Entity::FILTER_ALL & ~Entity::FILTER_KIT) {
-  auto config = Config::GetInstance()->GetCrittersConfig();
-  CHECK(config.count(entity_name) == 1);
-  _speed = config.at(entity_name).speed;
+  const Config::CritterConfig* config =
+      Config::GetInstance()->GetCritterConfig(config_id);
+  CHECK(config != NULL);
+  _speed = config->speed;
   _target = NULL;
-  Config::CritterConfig::Type type = config.at(entity_name).type;
+  Config::CritterConfig::Type type = config->type;
   if (type == Config::CritterConfig::TYPE_ZOMBIE) {
     type_ = TYPE_ZOMBIE;
   } else {
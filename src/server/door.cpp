@@ -10,6 +10,7 @@
 
 #include "base/error.h"
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/body.h"
@@ -21,16 +22,19 @@
 
 namespace bm {
 
+DEFINE_POOLED_ALLOCATION(Door, 16)
+
 Door::Door(
   Controller* controller,
   uint32_t id,
   const b2Vec2& position,
-  const std::string& entity_name
-) : ServerEntity(controller, id, Entity::TYPE_DOOR, entity_name, position,
+  uint32_t config_id
+) : ServerEntity(controller, id, Entity::TYPE_DOOR, config_id, position,
                  Entity::FILTER_DOOR, Entity::FILTER_ALL) {
-  auto config = Config::GetInstance()->GetDoorsConfig();
-  CHECK(config.count(entity_name) == 1);
-  activation_distance_ = config.at(entity_name).activation_distance;
+  const Config::DoorConfig* config =
+      Config::GetInstance()->GetDoorConfig(config_id);
+  CHECK(config != NULL);
+  activation_distance_ = config->activation_distance;
   door_closed_ = true;
 }
 
@@ -8,6 +8,7 @@
 #include <Box2D/Box2D.h>
 
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/protocol.h"
@@ -26,9 +27,11 @@ class Door : public ServerEntity {
     Controller* controller,
     uint32_t id,
     const b2Vec2& position,
-    const std::string& entity_name);
+    uint32_t config_id);
   virtual ~Door();
 
+  DECLARE_POOLED_ALLOCATION();
+
   // Inherited from Entity.
   virtual void GetSnapshot(int64_t time, EntitySnapshot* output);
   virtual void Damage(int damage, uint32_t source_id);
@@ -9,6 +9,7 @@
 
 #include "base/error.h"
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/body.h"
@@ -20,17 +21,20 @@
 
 namespace bm {
 
+DEFINE_POOLED_ALLOCATION(Kit, 16)
+
 Kit::Kit(
   Controller* controller,
   uint32_t id,
   const b2Vec2& position,
-  const std::string& entity_name
-) : ServerEntity(controller, id, Entity::TYPE_KIT, entity_name, position,
+  uint32_t config_id
+) : ServerEntity(controller, id, Entity::TYPE_KIT, config_id, position,
         Entity::FILTER_KIT, Entity::FILTER_ALL & ~Entity::FILTER_PROJECTILE) {
-  auto config = Config::GetInstance()->GetKitsConfig();
-  CHECK(config.count(entity_name) == 1);
-  _health_regeneration = config.at(entity_name).health_regen;
-  _energy_regeneration = config.at(entity_name).energy_regen;
+  const Config::KitConfig* config =
+      Config::GetInstance()->GetKitConfig(config_id);
+  CHECK(config != NULL);
+  _health_regeneration = config->health_regen;
+  _energy_regeneration = config->energy_regen;
 }
 
 Kit::~Kit() { }
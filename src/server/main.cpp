@@ -1,14 +1,15 @@
 // Copyright (c) 2013 Blowmorph Team
 
-#include <errno.h>
 #include <stdio.h>
 
+#include <atomic>
+
 #include "base/ctrlc.h"
 
 #include "server/server.h"
 
-// FIXME(alex): Not thread safe.
-bool global_stop_flag = false;
+// Set from the signal handler and read by the tick loop.
+std::atomic<bool> global_stop_flag(false);
 
 void CtrlCHandler() {
   global_stop_flag = true;
@@ -28,11 +29,6 @@ int main(int argc, char** argv) {
 
   while (!global_stop_flag) {
     if (!server.Tick()) {
-      if (errno == EINTR) {
-        // 'recvmsg()' in 'enet_service_host()' failed on 'SIGINT'.
-        printf("\nCaught SIGINT while in enet_host_service().\n");
-        break;
-      }
       bm::Error::Print();
       return EXIT_FAILURE;
     }
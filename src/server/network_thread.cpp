@@ -0,0 +1,262 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "server/network_thread.h"
+
+#ifndef _WIN32
+  #include <signal.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/error.h"
+#include "base/id_manager.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+#include "base/spsc_queue.h"
+
+#include "net/enet.h"
+
+namespace bm {
+
+namespace {
+
+const size_t QUEUE_CAPACITY = 4096;
+
+// Maximum time in ms the thread waits for incoming packets before
+// checking for new commands. Also the time a thread waits before retrying
+// to push into a full queue.
+const uint32_t SERVICE_TIMEOUT = 1;
+
+void WaitForQueue() {
+  std::this_thread::sleep_for(std::chrono::milliseconds(SERVICE_TIMEOUT));
+}
+
+}  // anonymous namespace
+
+NetworkThread::NetworkThread()
+    : host_(NULL),
+      event_(NULL),
+      has_pending_event_(false),
+      events_(QUEUE_CAPACITY),
+      commands_(QUEUE_CAPACITY),
+      stop_(false),
+      failed_(false),
+      total_sent_data_(0),
+      state_(STATE_FINALIZED) { }
+
+NetworkThread::~NetworkThread() {
+  if (state_ == STATE_INITIALIZED) {
+    Stop();
+  }
+}
+
+bool NetworkThread::Start(uint16_t port, size_t peer_count,
+    size_t channel_count) {
+  CHECK(state_ == STATE_FINALIZED);
+
+  if (!enet_.Initialize()) {
+    return false;
+  }
+
+  std::auto_ptr<ServerHost> host(enet_.CreateServerHost(port,
+      peer_count, channel_count));
+  if (host.get() == NULL) {
+    return false;
+  }
+
+  std::auto_ptr<Event> event(enet_.CreateEvent());
+  if (event.get() == NULL) {
+    return false;
+  }
+
+  host_ = host.release();
+  event_ = event.release();
+
+  stop_ = false;
+  failed_ = false;
+  total_sent_data_ = host_->GetTotalSentData();
+
+#ifndef _WIN32
+  // The thread inherits the blocked signals, so that they are delivered to
+  // the simulation thread and don't interrupt 'enet_host_service()'.
+  sigset_t signals, old_signals;
+  sigfillset(&signals);
+  pthread_sigmask(SIG_SETMASK, &signals, &old_signals);
+  thread_ = std::thread(&NetworkThread::Run, this);
+  pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+#else
+  thread_ = std::thread(&NetworkThread::Run, this);
+#endif
+
+  state_ = STATE_INITIALIZED;
+  return true;
+}
+
+void NetworkThread::Stop() {
+  CHECK(state_ == STATE_INITIALIZED);
+  stop_ = true;
+  thread_.join();
+  peers_.clear();
+  delete event_;
+  event_ = NULL;
+  delete host_;
+  host_ = NULL;
+  state_ = STATE_FINALIZED;
+}
+
+bool NetworkThread::HasFailed() const {
+  return failed_;
+}
+
+bool NetworkThread::PollEvent(NetworkEvent* event) {
+  CHECK(event != NULL);
+  return events_.Pop(event);
+}
+
+bool NetworkThread::Send(uint32_t client_id, std::vector<char>* data,
+    bool reliable, uint8_t channel_id) {
+  CHECK(data != NULL);
+  NetworkCommand command;
+  command.type = NetworkCommand::TYPE_SEND;
+  command.client_id = client_id;
+  command.data.swap(*data);
+  command.reliable = reliable;
+  command.channel_id = channel_id;
+  return PushCommand(&command);
+}
+
+bool NetworkThread::Disconnect(uint32_t client_id) {
+  NetworkCommand command;
+  command.type = NetworkCommand::TYPE_DISCONNECT;
+  command.client_id = client_id;
+  command.reliable = true;
+  command.channel_id = 0;
+  return PushCommand(&command);
+}
+
+uint32_t NetworkThread::GetTotalSentData() const {
+  return total_sent_data_;
+}
+
+bool NetworkThread::PushCommand(NetworkCommand* command) {
+  // The queue is only full if the network thread is stalled, so sleep
+  // until it catches up rather than spinning against it.
+  while (!commands_.Push(command)) {
+    if (failed_) {
+      REPORT_ERROR("Network thread has failed.");
+      return false;
+    }
+    WaitForQueue();
+  }
+  return true;
+}
+
+void NetworkThread::Run() {
+  while (!stop_) {
+    if (!ExecuteCommands() || !ServiceHost()) {
+      failed_ = true;
+      return;
+    }
+    total_sent_data_ = host_->GetTotalSentData();
+  }
+}
+
+bool NetworkThread::ExecuteCommands() {
+  NetworkCommand command;
+  while (commands_.Pop(&command)) {
+    switch (command.type) {
+      case NetworkCommand::TYPE_SEND: {
+        auto itr = peers_.find(command.client_id);
+        if (itr == peers_.end()) {
+          break;
+        }
+        bool rv = itr->second->Send(&command.data[0], command.data.size(),
+            command.reliable, command.channel_id);
+        if (rv == false) {
+          return false;
+        }
+      } break;
+
+      case NetworkCommand::TYPE_DISCONNECT: {
+        auto itr = peers_.find(command.client_id);
+        if (itr != peers_.end()) {
+          itr->second->Disconnect();
+        }
+      } break;
+    }
+  }
+  host_->Flush();
+  return true;
+}
+
+bool NetworkThread::ServiceHost() {
+  uint32_t timeout = SERVICE_TIMEOUT;
+  while (true) {
+    // The simulation thread lags behind, don't take more events until it
+    // handles the queued ones.
+    if (has_pending_event_) {
+      if (!events_.Push(&pending_event_)) {
+        WaitForQueue();
+        return true;
+      }
+      has_pending_event_ = false;
+    }
+
+    if (host_->Service(event_, timeout) == false) {
+      REPORT_ERROR("Unable to service the host.");
+      return false;
+    }
+    timeout = 0;
+
+    if (event_->GetType() == Event::TYPE_NONE) {
+      return true;
+    }
+
+    Peer* peer = event_->GetPeer();
+    NetworkEvent* event = &pending_event_;
+    event->data.clear();
+    switch (event_->GetType()) {
+      case Event::TYPE_CONNECT: {
+        uint32_t client_id = id_manager_.NewId();
+        peer->SetData(reinterpret_cast<void*>(client_id));
+        peers_[client_id] = peer;
+        event->type = NetworkEvent::TYPE_CONNECT;
+        event->client_id = client_id;
+      } break;
+
+      case Event::TYPE_DISCONNECT: {
+        // So complicated to make it work under both x32 and x64.
+        uint32_t client_id = static_cast<uint32_t>(
+            reinterpret_cast<size_t>(peer->GetData()));
+        peers_.erase(client_id);
+        id_manager_.FreeId(client_id);
+        event->type = NetworkEvent::TYPE_DISCONNECT;
+        event->client_id = client_id;
+      } break;
+
+      case Event::TYPE_RECEIVE: {
+        uint32_t client_id = static_cast<uint32_t>(
+            reinterpret_cast<size_t>(peer->GetData()));
+        event->type = NetworkEvent::TYPE_RECEIVE;
+        event->client_id = client_id;
+        event_->GetData(&event->data);
+      } break;
+
+      case Event::TYPE_NONE:
+        break;
+    }
+    event->address = peer->GetAddress();
+    event->port = peer->GetPort();
+    event->max_unfragmented_length = peer->GetMaxUnfragmentedLength();
+    event->round_trip_time = peer->GetRoundTripTime();
+    has_pending_event_ = true;
+  }
+}
+
+}  // namespace bm
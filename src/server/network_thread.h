@@ -0,0 +1,139 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef SERVER_NETWORK_THREAD_H_
+#define SERVER_NETWORK_THREAD_H_
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "base/id_manager.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+#include "base/spsc_queue.h"
+
+#include "net/enet.h"
+#include "net/utils.h"
+
+namespace bm {
+
+// An event passed from the network thread to the simulation thread.
+struct NetworkEvent {
+  enum Type {
+    TYPE_CONNECT,
+    TYPE_DISCONNECT,
+    TYPE_RECEIVE
+  };
+
+  Type type;
+  uint32_t client_id;
+
+  // The received packet for 'TYPE_RECEIVE'.
+  std::vector<char> data;
+
+  // The peer address, the maximum packet size that isn't fragmented and
+  // the round trip time in ms, filled for all the types. The address is
+  // in network byte order, see 'FormatAddress()'.
+  uint32_t address;
+  uint16_t port;
+  size_t max_unfragmented_length;
+  uint32_t round_trip_time;
+};
+
+// A command passed from the simulation thread to the network thread.
+struct NetworkCommand {
+  enum Type {
+    TYPE_SEND,
+    TYPE_DISCONNECT
+  };
+
+  Type type;
+  uint32_t client_id;
+  std::vector<char> data;
+  bool reliable;
+  uint8_t channel_id;
+};
+
+// Owns the 'ServerHost' and services it on a dedicated thread, so that
+// socket work doesn't delay the simulation. The simulation thread talks
+// to it through lock-free queues, and only through the public methods.
+// Clients are identified by generational ids assigned on connection.
+class NetworkThread {
+ public:
+  NetworkThread();
+  ~NetworkThread();
+
+  // Creates the host and starts the thread.
+  bool Start(uint16_t port, size_t peer_count, size_t channel_count);
+
+  // Stops the thread and destroys the host. Automatically called in the
+  // destructor.
+  void Stop();
+
+  // Returns 'true' if the thread has stopped because of an error.
+  bool HasFailed() const;
+
+  // Returns 'false' if there are no events.
+  bool PollEvent(NetworkEvent* event);
+
+  // The packet is moved from 'data'. Commands for disconnected clients
+  // are ignored. Returns 'false' if the thread has failed.
+  bool Send(uint32_t client_id, std::vector<char>* data,
+      bool reliable, uint8_t channel_id);
+  bool Disconnect(uint32_t client_id);
+
+  // See 'Host::GetTotalSentData()'.
+  uint32_t GetTotalSentData() const;
+
+ private:
+  void Run();
+
+  bool PushCommand(NetworkCommand* command);
+  bool ExecuteCommands();
+  // Returns 'false' on error.
+  bool ServiceHost();
+
+  Enet enet_;
+  ServerHost* host_;
+  Event* event_;
+
+  // Accessed only by the network thread while it runs.
+  IdManager id_manager_;
+  std::map<uint32_t, Peer*> peers_;
+  NetworkEvent pending_event_;
+  bool has_pending_event_;
+
+  SpscQueue<NetworkEvent> events_;
+  SpscQueue<NetworkCommand> commands_;
+
+  std::thread thread_;
+  std::atomic<bool> stop_;
+  std::atomic<bool> failed_;
+  std::atomic<uint32_t> total_sent_data_;
+
+  enum {
+    STATE_FINALIZED,
+    STATE_INITIALIZED
+  } state_;
+
+  DISALLOW_COPY_AND_ASSIGN(NetworkThread);
+};
+
+template<class PacketType, class DataType>
+bool SendPacket(
+    NetworkThread* network,
+    uint32_t client_id,
+    PacketType packet_type,
+    const DataType& data,
+    bool reliable = false,
+    uint8_t channel_id = 0
+) {
+  std::vector<char> buffer;
+  AppendPacketToBuffer(buffer, packet_type, data);
+  return network->Send(client_id, &buffer, reliable, channel_id);
+}
+
+}  // namespace bm
+
+#endif  // SERVER_NETWORK_THREAD_H_
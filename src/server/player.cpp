@@ -9,6 +9,7 @@
 
 #include "base/error.h"
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/body.h"
@@ -20,24 +21,28 @@
 
 namespace bm {
 
+DEFINE_POOLED_ALLOCATION(Player, 16)
+
 Player::Player(
     Controller* controller,
-    std::string entity_name,
+    uint32_t config_id,
     uint32_t id,
     const b2Vec2& position
-) : ServerEntity(controller, id, Entity::TYPE_PLAYER, entity_name, position,
+) : ServerEntity(controller, id, Entity::TYPE_PLAYER, config_id, position,
         Entity::FILTER_PLAYER, Entity::FILTER_ALL & ~Entity::FILTER_PLAYER) {
-  auto config = Config::GetInstance()->GetPlayersConfig();
-  CHECK(config.count(entity_name) == 1);
-  _speed = config.at(entity_name).speed;
+  const Config::PlayerConfig* config =
+      Config::GetInstance()->GetPlayerConfig(config_id);
+  CHECK(config != NULL);
+  _speed = config->speed;
   _score = 0;
   _killer_id = ServerEntity::BAD_ID;
-  _max_health = config.at(entity_name).health_max;
-  _health_regeneration = config.at(entity_name).health_regen;
+  _max_health = config->health_max;
+  _health_regeneration = config->health_regen;
   _health = _max_health;
-  _energy_capacity = config.at(entity_name).energy_max;
-  _energy_regeneration = config.at(entity_name).energy_regen;
+  _energy_capacity = config->energy_max;
+  _energy_regeneration = config->energy_regen;
   _energy = _energy_capacity;
+  _input_sequence = 0;
 }
 
 Player::~Player() { }
@@ -48,6 +53,7 @@ void Player::GetSnapshot(int64_t time, EntitySnapshot* output) {
   output->data[0] = _health;
   output->data[1] = _energy;
   output->data[2] = _score;
+  output->data[3] = static_cast<int32_t>(_input_sequence);
 }
 
 void Player::Damage(int damage, uint32_t source_id) {
@@ -58,6 +64,11 @@ void Player::Damage(int damage, uint32_t source_id) {
 }
 
 void Player::OnKeyboardEvent(const KeyboardEvent& event) {
+  // Outdated events are processed too, they just don't change the state.
+  if (static_cast<int32_t>(event.sequence - _input_sequence) > 0) {
+    _input_sequence = event.sequence;
+  }
+
   switch (event.event_type) {
     case KeyboardEvent::EVENT_KEYDOWN: {
       switch (event.key_type) {
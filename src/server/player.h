@@ -8,6 +8,7 @@
 #include <Box2D/Box2D.h>
 
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/protocol.h"
@@ -40,10 +41,12 @@ class Player : public ServerEntity {
   };
 
  public:
-  Player(Controller* controller, std::string entity_name,
+  Player(Controller* controller, uint32_t config_id,
     uint32_t id, const b2Vec2& position);
   virtual ~Player();
 
+  DECLARE_POOLED_ALLOCATION();
+
   virtual void GetSnapshot(int64_t time, EntitySnapshot* output);
   virtual void Damage(int damage, uint32_t source_id);
 
@@ -101,6 +104,7 @@ class Player : public ServerEntity {
 
   KeyboardState _keyboard_state;
   KeyboardUpdateTime _keyboard_update_time;
+  uint32_t _input_sequence;
 
   int _max_health;
   int _health_regeneration;  // Points per ms.
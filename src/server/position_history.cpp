@@ -0,0 +1,128 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "server/position_history.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/entity.h"
+#include "engine/entity_map.h"
+
+namespace bm {
+
+PositionHistory::PositionHistory(int64_t duration)
+    : duration_(duration), first_(0), size_(0) {
+  CHECK(duration >= 0);
+}
+
+PositionHistory::~PositionHistory() { }
+
+int64_t PositionHistory::GetDuration() const {
+  return duration_;
+}
+
+void PositionHistory::Clear() {
+  first_ = 0;
+  size_ = 0;
+}
+
+void PositionHistory::Record(int64_t time, const EntityMap& entities) {
+  CHECK(size_ == 0 || time > GetFrame(size_ - 1).time);
+
+  // The frame preceding the interval is kept to interpolate at its start.
+  while (size_ >= 2 && time - GetFrame(1).time >= duration_) {
+    first_ = (first_ + 1) % frames_.size();
+    size_--;
+  }
+
+  if (size_ == frames_.size()) {
+    std::rotate(frames_.begin(), frames_.begin() + first_, frames_.end());
+    first_ = 0;
+    frames_.push_back(Frame());
+  }
+
+  Frame* frame = &frames_[(first_ + size_) % frames_.size()];
+  size_++;
+
+  frame->time = time;
+  frame->positions.clear();
+  for (auto& entry : entities) {
+    EntityPosition position;
+    position.id = entry.first;
+    position.position = entry.second->GetPosition();
+    frame->positions.push_back(position);
+  }
+}
+
+bool PositionHistory::GetPositions(int64_t time,
+    std::vector<EntityPosition>* positions) const {
+  CHECK(positions != NULL);
+  positions->clear();
+  if (size_ == 0) {
+    return false;
+  }
+
+  const Frame& first = GetFrame(0);
+  const Frame& last = GetFrame(size_ - 1);
+  if (time <= first.time) {
+    *positions = first.positions;
+    return true;
+  }
+  if (time >= last.time) {
+    *positions = last.positions;
+    return true;
+  }
+
+  // Find the frames with 'before.time <= time < after.time'.
+  size_t low = 0;
+  size_t high = size_ - 1;
+  while (high - low > 1) {
+    size_t middle = (low + high) / 2;
+    if (GetFrame(middle).time <= time) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  const Frame& before = GetFrame(low);
+  const Frame& after = GetFrame(high);
+  float alpha = static_cast<float>(time - before.time) /
+      static_cast<float>(after.time - before.time);
+
+  for (size_t i = 0; i < before.positions.size(); i++) {
+    EntityPosition position = before.positions[i];
+
+    // The entities are stored in the same order unless some of them
+    // have been removed, so the same index is checked first.
+    const EntityPosition* next = NULL;
+    if (i < after.positions.size() && after.positions[i].id == position.id) {
+      next = &after.positions[i];
+    } else {
+      uint32_t id = position.id;
+      auto itr = std::find_if(after.positions.begin(), after.positions.end(),
+          [id](const EntityPosition& other) { return other.id == id; });
+      if (itr != after.positions.end()) {
+        next = &(*itr);
+      }
+    }
+
+    if (next != NULL) {
+      position.position += alpha * (next->position - position.position);
+    }
+    positions->push_back(position);
+  }
+  return true;
+}
+
+const PositionHistory::Frame& PositionHistory::GetFrame(size_t index) const {
+  CHECK(index < size_);
+  return frames_[(first_ + index) % frames_.size()];
+}
+
+}  // namespace bm
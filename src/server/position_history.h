@@ -0,0 +1,66 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef SERVER_POSITION_HISTORY_H_
+#define SERVER_POSITION_HISTORY_H_
+
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/entity_map.h"
+
+namespace bm {
+
+// Positions of the dynamic entities over the last 'duration' ms, recorded
+// once per tick. Used to check player actions against the world as the
+// acting client saw it. The frames are reused, so recording doesn't
+// allocate once the number of entities settles.
+class PositionHistory {
+ public:
+  struct EntityPosition {
+    uint32_t id;
+    b2Vec2 position;
+  };
+
+  explicit PositionHistory(int64_t duration);
+  ~PositionHistory();
+
+  int64_t GetDuration() const;
+
+  void Clear();
+
+  // Records the positions of 'entities' at 'time', which should be
+  // greater than the time of the previous frame.
+  void Record(int64_t time, const EntityMap& entities);
+
+  // Stores the positions of the entities at 'time' interpolated between
+  // the two closest frames in 'positions'. The time is clamped to the
+  // recorded interval. The entities that appeared after the earlier frame
+  // are omitted. Returns 'false' if nothing has been recorded.
+  bool GetPositions(int64_t time,
+      std::vector<EntityPosition>* positions) const;
+
+ private:
+  struct Frame {
+    int64_t time;
+    std::vector<EntityPosition> positions;
+  };
+
+  const Frame& GetFrame(size_t index) const;
+
+  int64_t duration_;
+
+  // A ring of frames ordered by time, starting from 'first_'.
+  std::vector<Frame> frames_;
+  size_t first_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(PositionHistory);
+};
+
+}  // namespace bm
+
+#endif  // SERVER_POSITION_HISTORY_H_
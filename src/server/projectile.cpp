@@ -9,6 +9,7 @@
 
 #include "base/error.h"
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/body.h"
@@ -19,40 +20,40 @@
 
 namespace bm {
 
+DEFINE_POOLED_ALLOCATION(Projectile, 128)
+
 Projectile::Projectile(
   Controller* controller,
   uint32_t id,
   uint32_t owner_id,
   const b2Vec2& start,
   const b2Vec2& end,
-  const std::string& entity_name
-) : ServerEntity(controller, id, Entity::TYPE_PROJECTILE, entity_name, start,
+  uint32_t config_id
+) : ServerEntity(controller, id, Entity::TYPE_PROJECTILE, config_id, start,
         Entity::FILTER_PROJECTILE, Entity::FILTER_ALL & ~Entity::FILTER_KIT) {
-  auto config = Config::GetInstance()->GetProjectilesConfig();
-  CHECK(config.count(entity_name) == 1);
-  float speed = config.at(entity_name).speed;
+  const Config::ProjectileConfig* config =
+      Config::GetInstance()->GetProjectileConfig(config_id);
+  CHECK(config != NULL);
+  float speed = config->speed;
 
   b2Vec2 velocity = end - start;
   velocity.Normalize();
   velocity *= speed;
-  body_->ApplyImpulse(body_->GetMass() * velocity);
+  body_.ApplyImpulse(body_.GetMass() * velocity);
 
   float angle = atan2f(-velocity.x, velocity.y);
   SetRotation(angle);
 
   owner_id_ = owner_id;
 
-  Config::ProjectileConfig::Type type = config.at(entity_name).type;
+  Config::ProjectileConfig::Type type = config->type;
   if (type == Config::ProjectileConfig::TYPE_ROCKET) {
     type_ = TYPE_ROCKET;
-    rocket_explosion_radius_ = config.at(entity_name).
-        rocket_config.explosion_radius;
-    rocket_explosion_damage_ = config.at(entity_name).
-        rocket_config.explosion_damage;
+    rocket_explosion_radius_ = config->rocket_config.explosion_radius;
+    rocket_explosion_damage_ = config->rocket_config.explosion_damage;
   } else if (type == Config::ProjectileConfig::TYPE_SLIME) {
     type_ = TYPE_SLIME;
-    slime_explosion_radius_ = config.at(entity_name).
-        slime_config.explosion_radius;
+    slime_explosion_radius_ = config->slime_config.explosion_radius;
   } else {
     CHECK(false);  // Unreachable.
   }
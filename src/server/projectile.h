@@ -8,6 +8,7 @@
 #include <Box2D/Box2D.h>
 
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/protocol.h"
@@ -33,9 +34,11 @@ class Projectile : public ServerEntity {
     uint32_t owner_id,
     const b2Vec2& start,
     const b2Vec2& end,
-    const std::string& entity_name);
+    uint32_t config_id);
   virtual ~Projectile();
 
+  DECLARE_POOLED_ALLOCATION();
+
   virtual void GetSnapshot(int64_t time, EntitySnapshot* output);
   virtual void Damage(int damage, uint32_t source_id);
 
@@ -0,0 +1,112 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "server/room.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/protocol.h"
+#include "engine/snapshot_codec.h"
+
+#include "server/client_manager.h"
+#include "server/controller.h"
+#include "server/entity.h"
+
+namespace bm {
+
+Room::Room(uint32_t id)
+    : id_(id), position_step_(0.0f), position_bits_(0) { }
+
+Room::~Room() { }
+
+bool Room::Initialize(const std::string& map) {
+  if (!controller_.GetWorld()->LoadMap(map)) {
+    return false;
+  }
+
+  position_step_ = controller_.GetWorld()->GetBlockSize() /
+      SnapshotCodec::POSITION_STEPS_PER_BLOCK;
+  position_bits_ = SnapshotCodec::GetPositionBits(
+      controller_.GetWorld()->GetBound(), position_step_);
+  if (!snapshot_codec_.Initialize(position_step_, position_bits_)) {
+    return false;
+  }
+
+  return true;
+}
+
+uint32_t Room::GetId() const {
+  return id_;
+}
+
+Controller* Room::GetController() {
+  return &controller_;
+}
+
+ClientManager* Room::GetClientManager() {
+  return &client_manager_;
+}
+
+const SnapshotCodec* Room::GetSnapshotCodec() const {
+  return &snapshot_codec_;
+}
+
+float32_t Room::GetPositionStep() const {
+  return position_step_;
+}
+
+int32_t Room::GetPositionBits() const {
+  return position_bits_;
+}
+
+void Room::TakeSnapshots(int64_t time, uint32_t snapshot_tick) {
+  ServerWorld* world = controller_.GetWorld();
+
+  dynamic_snapshots_.resize(world->GetDynamicEntities()->size());
+  size_t index = 0;
+  for (auto itr : *world->GetDynamicEntities()) {
+    ServerEntity* entity = static_cast<ServerEntity*>(itr.second);
+    entity->GetSnapshot(time, &dynamic_snapshots_[index]);
+    index++;
+  }
+
+  for (auto itr : *world->GetStaticEntities()) {
+    ServerEntity* entity = static_cast<ServerEntity*>(itr.second);
+    if (entity->IsUpdated()) {
+      for (auto client : *client_manager_.GetClients()) {
+        client.second->pending_static_entities[entity->GetId()] =
+            snapshot_tick;
+      }
+      entity->SetUpdatedFlag(false);
+    }
+  }
+
+  static_snapshots_.clear();
+  for (auto client : *client_manager_.GetClients()) {
+    for (auto itr : client.second->pending_static_entities) {
+      if (static_snapshots_.count(itr.first) != 0) {
+        continue;
+      }
+      ServerEntity* entity = static_cast<ServerEntity*>(
+          world->GetEntity(itr.first));
+      if (entity != NULL) {
+        entity->GetSnapshot(time, &static_snapshots_[itr.first]);
+      }
+    }
+  }
+}
+
+const std::vector<EntitySnapshot>& Room::GetDynamicSnapshots() const {
+  return dynamic_snapshots_;
+}
+
+const std::map<uint32_t, EntitySnapshot>& Room::GetStaticSnapshots() const {
+  return static_snapshots_;
+}
+
+}  // namespace bm
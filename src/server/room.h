@@ -0,0 +1,69 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef SERVER_ROOM_H_
+#define SERVER_ROOM_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+#include "engine/protocol.h"
+#include "engine/snapshot_codec.h"
+
+#include "server/client_manager.h"
+#include "server/controller.h"
+
+namespace bm {
+
+// An independent match with a world of its own and the clients playing
+// in it. Different rooms share nothing but the read-only config, so they
+// may be updated on different threads at once.
+class Room {
+ public:
+  explicit Room(uint32_t id);
+  ~Room();
+
+  bool Initialize(const std::string& map);
+
+  uint32_t GetId() const;
+
+  Controller* GetController();
+  ClientManager* GetClientManager();
+
+  // Returns the codec for the entity positions in the room's world.
+  const SnapshotCodec* GetSnapshotCodec() const;
+  float32_t GetPositionStep() const;
+  int32_t GetPositionBits() const;
+
+  // Takes the snapshots of the dynamic entities and of the static entities
+  // pending for any client. Static entities updated since the last call
+  // become pending for all the clients from 'snapshot_tick'.
+  void TakeSnapshots(int64_t time, uint32_t snapshot_tick);
+
+  // The snapshots are in the order of the dynamic entities.
+  const std::vector<EntitySnapshot>& GetDynamicSnapshots() const;
+  // Removed static entities are left out.
+  const std::map<uint32_t, EntitySnapshot>& GetStaticSnapshots() const;
+
+ private:
+  uint32_t id_;
+
+  Controller controller_;
+  ClientManager client_manager_;
+
+  float32_t position_step_;
+  int32_t position_bits_;
+  SnapshotCodec snapshot_codec_;
+
+  std::vector<EntitySnapshot> dynamic_snapshots_;
+  std::map<uint32_t, EntitySnapshot> static_snapshots_;
+
+  DISALLOW_COPY_AND_ASSIGN(Room);
+};
+
+}  // namespace bm
+
+#endif  // SERVER_ROOM_H_
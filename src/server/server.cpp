@@ -6,27 +6,35 @@
 #include <cstring>
 
 #include <algorithm>
+#include <chrono>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "base/error.h"
-#include "base/id_manager.h"
 #include "base/macros.h"
-
 #include "base/pstdint.h"
 #include "base/time.h"
+#include "base/worker_pool.h"
 
-#include "net/enet.h"
 #include "net/utils.h"
 
 #include "engine/config.h"
+#include "engine/delta.h"
+#include "engine/world_state.h"
 #include "engine/protocol.h"
+#include "engine/snapshot_codec.h"
+#include "engine/world.h"
 
 #include "server/client_manager.h"
+#include "server/config_reloader.h"
 #include "server/controller.h"
 #include "server/entity.h"
+#include "server/network_thread.h"
+#include "server/room.h"
 
 #include "server/activator.h"
 #include "server/critter.h"
@@ -37,8 +45,7 @@
 
 namespace bm {
 
-Server::Server() : controller_(),
-  state_(STATE_FINALIZED), host_(NULL), event_(NULL) { }
+Server::Server() : state_(STATE_FINALIZED) { }
 
 Server::~Server() {
   if (state_ == STATE_INITIALIZED) {
@@ -58,35 +65,60 @@ bool Server::Initialize() {
 
   uint32_t update_rate = config.tick_rate;
   update_timeout_ = 1000 / update_rate;
-  last_update_ = 0;
+  last_update_ = Timestamp();
+  max_catch_up_ticks_ = config.max_catch_up_ticks;
+  max_lag_ = config.max_lag;
+  CHECK(max_catch_up_ticks_ >= 1);
+  CHECK(max_lag_ >= update_timeout_);
 
   uint32_t broadcast_rate = config.broadcast_rate;
   broadcast_timeout_ = 1000 / broadcast_rate;
   last_broadcast_ = 0;
 
-  host_ = NULL;
-  event_ = NULL;
+  view_radius_ = config.view_radius;
+  max_interpolation_offset_ = config.max_interpolation_offset;
+  CHECK(max_interpolation_offset_ >= 0);
 
-  if (!controller_.GetWorld()->LoadMap(config.map)) {
-    return false;
+  delta_snapshots_ = config.delta_snapshots;
+  snapshot_tick_ = 1;
+
+  CHECK(config.worker_threads >= 0);
+  worker_pool_.Initialize(config.worker_threads);
+  serialization_workers_.clear();
+  for (size_t i = 0; i < worker_pool_.GetWorkerCount(); i++) {
+    serialization_workers_.push_back(
+        std::unique_ptr<SerializationWorker>(new SerializationWorker()));
   }
 
-  if (!enet_.Initialize()) {
-    return false;
+  profiler_.Initialize(config.stats_period, config.stats_file);
+
+  CHECK(config.room_count >= 1);
+  rooms_.clear();
+  for (int32_t i = 0; i < config.room_count; i++) {
+    std::unique_ptr<Room> room(new Room(i));
+    if (!room->Initialize(config.map)) {
+      return false;
+    }
+    rooms_.push_back(std::move(room));
+  }
+
+  // A single room is updated on this thread, otherwise the profiler
+  // only times the server phases.
+  if (rooms_.size() == 1) {
+    rooms_[0]->GetController()->SetProfiler(&profiler_);
   }
 
-  std::auto_ptr<ServerHost> host(enet_.CreateServerHost(config.port));
-  if (host.get() == NULL) {
+  CHECK(config.max_clients >= 1);
+  if (!network_.Start(config.port, config.max_clients, CHANNEL_COUNT)) {
     return false;
   }
 
-  std::auto_ptr<Event> event(enet_.CreateEvent());
-  if (event.get() == NULL) {
+  reload_configs_ = config.reload_configs;
+  if (reload_configs_ && !config_reloader_.Start()) {
     return false;
   }
 
-  host_ = host.release();
-  event_ = event.release();
+  last_sent_data_ = network_.GetTotalSentData();
 
   state_ = STATE_INITIALIZED;
   return true;
@@ -94,55 +126,99 @@ bool Server::Initialize() {
 
 void Server::Finalize() {
   CHECK(state_ == STATE_INITIALIZED);
-  if (event_ != NULL) {
-    delete event_;
-    event_ = NULL;
-  }
-  if (host_ != NULL) {
-    delete host_;
-    host_ = NULL;
+  if (reload_configs_) {
+    config_reloader_.Stop();
   }
+  network_.Stop();
+  worker_pool_.Finalize();
+  client_rooms_.clear();
+  rooms_.clear();
   state_ = STATE_FINALIZED;
 }
 
 bool Server::Tick() {
   CHECK(state_ == STATE_INITIALIZED);
 
+  if (network_.HasFailed()) {
+    REPORT_ERROR("Network thread has failed.");
+    return false;
+  }
+
   int64_t current_time = Timestamp();
   if (current_time - last_broadcast_ >= broadcast_timeout_) {
-    if (!BroadcastDynamicEntities()) {
-      return false;
-    }
-    if (!BroadcastStaticEntities()) {
-      return false;
+    {
+      ScopedPhase phase(&profiler_, TickProfiler::PHASE_BROADCAST_WORLD_STATE);
+      if (!BroadcastWorldState()) {
+        return false;
+      }
     }
-    if (!BroadcastGameEvents()) {
-      return false;
+    {
+      ScopedPhase phase(&profiler_, TickProfiler::PHASE_BROADCAST_GAME_EVENTS);
+      if (!BroadcastGameEvents()) {
+        return false;
+      }
     }
+    snapshot_tick_++;
     last_broadcast_ = current_time;
+
+    // The packets are actually sent by the network thread, so this
+    // counts the bytes sent since the previous broadcast.
+    uint32_t sent_data = network_.GetTotalSentData();
+    profiler_.AddSample(TickProfiler::COUNTER_BYTES_SENT,
+        sent_data - last_sent_data_);
+    profiler_.AddSample(TickProfiler::COUNTER_CLIENTS, client_rooms_.size());
+    last_sent_data_ = sent_data;
   }
 
+  // The world is simulated in fixed steps of 'update_timeout_'. After a stall
+  // the missed steps are caught up over several calls, and the steps that
+  // are more than 'max_lag_' behind are dropped.
   current_time = Timestamp();
-  if (current_time - last_update_ >= update_timeout_) {
-    controller_.Update(current_time, current_time - last_update_);
-    last_update_ = current_time;
+  if (current_time - last_update_ > max_lag_) {
+    printf("Can't keep up, skipping %ld ms of simulation!\n",
+        current_time - last_update_ - max_lag_);
+    last_update_ = current_time - max_lag_;
+  }
+  int64_t first_update = last_update_;
+  int32_t update_count = 0;
+  while (update_count < max_catch_up_ticks_ &&
+      current_time - last_update_ >= update_timeout_) {
+    last_update_ += update_timeout_;
+    update_count++;
   }
 
-  if (!PumpEvents()) {
-    return false;
+  // No worker runs between the ticks, so the configs can be swapped.
+  if (reload_configs_) {
+    config_reloader_.Apply();
   }
 
+  // The rooms are independent, so each one is stepped on its own worker.
+  worker_pool_.Run(rooms_.size(), [&](size_t worker, size_t task) {
+    Controller* controller = rooms_[task]->GetController();
+    for (int32_t i = 1; i <= update_count; i++) {
+      controller->Update(first_update + i * update_timeout_, update_timeout_);
+    }
+  });
+
+  {
+    ScopedPhase phase(&profiler_, TickProfiler::PHASE_PUMP_EVENTS);
+    if (!PumpEvents()) {
+      return false;
+    }
+  }
+
+  profiler_.Update(Timestamp());
+
   int64_t next_broadcast = last_broadcast_ + broadcast_timeout_;
   int64_t next_update = last_update_ + update_timeout_;
   int64_t sleep_until = std::min(next_broadcast, next_update);
   current_time = Timestamp();
 
+  // Incoming packets are queued by the network thread meanwhile and
+  // handled on the next call.
   if (current_time <= sleep_until) {
-    uint32_t timeout = static_cast<uint32_t>(sleep_until - current_time);
-    bool rv = host_->Service(NULL, timeout);
-    if (rv == false) {
-      return false;
-    }
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(sleep_until - current_time));
   } else {
     printf("Can't keep up, %ld ms behind!\n", current_time - sleep_until);
   }
@@ -150,138 +226,305 @@ bool Server::Tick() {
   return true;
 }
 
-bool Server::BroadcastDynamicEntities() {
-  for (auto itr : *controller_.GetWorld()->GetDynamicEntities()) {
-    ServerEntity* entity = static_cast<ServerEntity*>(itr.second);
-    bool rv = BroadcastEntityRelatedMessage(
-        Packet::TYPE_ENTITY_UPDATED, entity);
-    if (rv == false) {
-      return false;
+bool Server::BroadcastWorldState() {
+  // The world states are built by the workers from the snapshots taken here,
+  // and the worlds aren't modified until they are done.
+  int64_t time = Timestamp();
+
+  worker_pool_.Run(rooms_.size(), [&](size_t worker, size_t task) {
+    rooms_[task]->TakeSnapshots(time, snapshot_tick_);
+  });
+
+  client_packets_.resize(client_rooms_.size());
+  size_t index = 0;
+  for (auto& room : rooms_) {
+    for (auto itr : *room->GetClientManager()->GetClients()) {
+      client_packets_[index].room = room.get();
+      client_packets_[index].client = itr.second;
+      client_packets_[index].world_state.clear();
+      client_packets_[index].disappeared.clear();
+      index++;
+    }
+  }
+  CHECK(index == client_packets_.size());
+
+  worker_pool_.Run(client_packets_.size(), [&](size_t worker, size_t task) {
+    BuildWorldState(serialization_workers_[worker].get(), time,
+        &client_packets_[task]);
+  });
+
+  // Only this thread may queue packets to the network thread.
+  for (auto& packets : client_packets_) {
+    uint32_t client_id = packets.client->id;
+    for (auto& packet : packets.world_state) {
+      if (!network_.Send(client_id, &packet, false, CHANNEL_WORLD)) {
+        REPORT_ERROR("Couldn't send packet.");
+        return false;
+      }
+    }
+    for (auto& packet : packets.disappeared) {
+      if (!network_.Send(client_id, &packet, true, CHANNEL_EVENTS)) {
+        REPORT_ERROR("Couldn't send packet.");
+        return false;
+      }
     }
   }
   return true;
 }
 
-bool Server::BroadcastStaticEntities(bool force) {
-  for (auto itr : *controller_.GetWorld()->GetStaticEntities()) {
-    ServerEntity* entity = static_cast<ServerEntity*>(itr.second);
-    if (force || entity->IsUpdated()) {
-      bool rv = BroadcastEntityRelatedMessage(
-          Packet::TYPE_ENTITY_UPDATED, entity);
-      if (rv == false) {
-        return false;
-      }
-      entity->SetUpdatedFlag(false);
+void Server::BuildWorldState(SerializationWorker* worker, int64_t time,
+    ClientPackets* packets) {
+  Room* room = packets->room;
+  Client* client = packets->client;
+  const World* world = room->GetController()->GetWorld();
+  const std::vector<EntitySnapshot>& dynamic_snapshots =
+      room->GetDynamicSnapshots();
+  const std::map<uint32_t, EntitySnapshot>& static_snapshots =
+      room->GetStaticSnapshots();
+  const SnapshotCodec* codec = GetSnapshotCodec(room, client);
+
+  worker->writer.Reset(snapshot_tick_, time, client->max_packet_size, codec);
+
+  std::set<uint32_t> visible_entities;
+  visible_entities.insert(client->entity->GetId());
+
+  worker->nearby_entities.clear();
+  world->QueryEntities(client->entity->GetPosition(), view_radius_,
+      &worker->query_ids, &worker->nearby_entities);
+  for (auto entity : worker->nearby_entities) {
+    if (!entity->IsStatic()) {
+      visible_entities.insert(entity->GetId());
     }
   }
 
-  return true;
+  // The snapshots are in the order of the dynamic entities.
+  const EntityMap* dynamic_entities = world->GetDynamicEntities();
+  for (auto id : visible_entities) {
+    auto itr = dynamic_entities->find(id);
+    CHECK(itr != dynamic_entities->end());
+    const EntitySnapshot& snapshot =
+        dynamic_snapshots[itr - dynamic_entities->begin()];
+    CHECK(snapshot.id == id);
+    AddEntitySnapshot(client, &worker->writer, snapshot);
+  }
+
+  // World states may be lost, so the static entities are sent until the
+  // client acknowledges their latest state.
+  auto itr = client->pending_static_entities.begin();
+  while (itr != client->pending_static_entities.end()) {
+    auto snapshot = static_snapshots.find(itr->first);
+    uint32_t acked_tick;
+    const EntitySnapshot* acked = NULL;
+    if (snapshot != static_snapshots.end()) {
+      acked = client->snapshot_history[itr->first].GetLatestAcked(
+          client->snapshot_acks, GetMinBaselineTick(), &acked_tick);
+    }
+    if (snapshot == static_snapshots.end() ||
+        (acked != NULL && acked_tick >= itr->second)) {
+      itr = client->pending_static_entities.erase(itr);
+      continue;
+    }
+    AddEntitySnapshot(client, &worker->writer, snapshot->second);
+    ++itr;
+  }
+
+  size_t packet_count = worker->writer.GetPacketCount();
+  packets->world_state.resize(packet_count);
+  for (size_t i = 0; i < packet_count; i++) {
+    packets->world_state[i] = worker->writer.GetPacket(i);
+  }
+
+  for (auto id : client->visible_entities) {
+    if (visible_entities.count(id) != 0) {
+      continue;
+    }
+    // The entity will be sent in full if it comes back.
+    client->snapshot_history.erase(id);
+    // Destroyed entities are reported with a game event.
+    if (dynamic_entities->count(id) == 0) {
+      continue;
+    }
+    EntityDisappearance disappearance;
+    disappearance.tick = snapshot_tick_;
+    disappearance.id = id;
+    packets->disappeared.push_back(std::vector<char>());
+    AppendPacketToBuffer(packets->disappeared.back(),
+        Packet::TYPE_ENTITY_DISAPPEARED, disappearance);
+  }
+
+  client->visible_entities.swap(visible_entities);
+}
+
+void Server::SendStaticEntities(Room* room, Client* client) {
+  for (auto itr : *room->GetController()->GetWorld()->GetStaticEntities()) {
+    client->pending_static_entities[itr.first] = snapshot_tick_;
+  }
+}
+
+void Server::AddEntitySnapshot(Client* client, WorldStateWriter* writer,
+    const EntitySnapshot& snapshot) {
+  EntityDelta delta;
+  delta.baseline_tick = 0;
+  delta.id = snapshot.id;
+  delta.fields = EntityDelta::FIELD_ALL;
+
+  SnapshotHistory* history = &client->snapshot_history[snapshot.id];
+
+  if (delta_snapshots_) {
+    // The baseline is the latest snapshot the client has acknowledged
+    // and still keeps in its history.
+    uint32_t baseline_tick;
+    const EntitySnapshot* baseline = history->GetLatestAcked(
+        client->snapshot_acks, GetMinBaselineTick(), &baseline_tick);
+    if (baseline != NULL) {
+      delta.baseline_tick = baseline_tick;
+      delta.fields = GetChangedFields(*baseline, snapshot);
+    }
+  }
+
+  uint32_t part = writer->AddEntity(delta, snapshot);
+  history->Add(snapshot_tick_, part, snapshot);
+}
+
+uint32_t Server::GetMinBaselineTick() const {
+  if (snapshot_tick_ > SnapshotHistory::SIZE) {
+    return snapshot_tick_ - SnapshotHistory::SIZE + 1;
+  }
+  return 1;
+}
+
+const SnapshotCodec* Server::GetSnapshotCodec(Room* room,
+    Client* client) const {
+  if (client->protocol_version == PROTOCOL_VERSION_COMPACT) {
+    return room->GetSnapshotCodec();
+  }
+  return NULL;
 }
 
 bool Server::BroadcastGameEvents() {
-  std::vector<GameEvent> *events = controller_.GetGameEvents();
-  std::vector<GameEvent>::iterator it;
-  for (it = events->begin(); it != events->end(); ++it) {
-    bool rv = BroadcastPacket(host_, Packet::TYPE_GAME_EVENT, *it, true);
-    if (rv == false) {
-      return false;
+  for (auto& room : rooms_) {
+    ClientManager* clients = room->GetClientManager();
+    std::vector<GameEvent>* events = room->GetController()->GetGameEvents();
+    for (auto& event : *events) {
+      event.tick = snapshot_tick_;
+      std::vector<char> buffer;
+      AppendPacketToBuffer(buffer, Packet::TYPE_GAME_EVENT, event);
+      for (auto client : *clients->GetClients()) {
+        std::vector<char> packet(buffer);
+        if (!network_.Send(client.first, &packet, true, CHANNEL_EVENTS)) {
+          return false;
+        }
+      }
+      if (event.type == GameEvent::TYPE_ENTITY_DISAPPEARED) {
+        for (auto client : *clients->GetClients()) {
+          client.second->visible_entities.erase(event.entity.id);
+          client.second->snapshot_history.erase(event.entity.id);
+        }
+      }
     }
+    events->clear();
+    // The removals have been queued for sending just above, so the ids
+    // may be reused by the next update.
+    room->GetController()->GetWorld()->FreeRemovedIds();
   }
-  events->clear();
   return true;
 }
 
 bool Server::PumpEvents() {
-  do {
-    // TODO(xairy): timeout.
-    if (host_->Service(event_, 0) == false) {
-      return false;
-    }
-
-    switch (event_->GetType()) {
-      case Event::TYPE_CONNECT: {
-        OnConnect();
+  NetworkEvent event;
+  while (network_.PollEvent(&event)) {
+    switch (event.type) {
+      case NetworkEvent::TYPE_CONNECT: {
+        OnConnect(event);
         break;
       }
 
-      case Event::TYPE_RECEIVE: {
-        if (!OnReceive()) {
+      case NetworkEvent::TYPE_RECEIVE: {
+        if (!OnReceive(event)) {
           return false;
         }
         break;
       }
 
-      case Event::TYPE_DISCONNECT: {
-        if (!OnDisconnect()) {
+      case NetworkEvent::TYPE_DISCONNECT: {
+        if (!OnDisconnect(event)) {
           return false;
         }
         break;
       }
-
-      case Event::TYPE_NONE:
-        break;
     }
-  } while (event_->GetType() != Event::TYPE_NONE);
+  }
 
   return true;
 }
 
-void Server::OnConnect() {
-  CHECK(event_->GetType() == Event::TYPE_CONNECT);
-
-  uint32_t client_id = id_manager_.NewId();
-  event_->GetPeer()->SetData(reinterpret_cast<void*>(client_id));
+void Server::OnConnect(const NetworkEvent& event) {
+  CHECK(event.type == NetworkEvent::TYPE_CONNECT);
 
-  printf("#%u: Client from %s:%u is trying to connect.\n", client_id,
-    event_->GetPeer()->GetIp().c_str(), event_->GetPeer()->GetPort());
+  printf("#%u: Client from %s:%u is trying to connect.\n", event.client_id,
+    FormatAddress(event.address).c_str(), event.port);
 
   // Client should send 'TYPE_LOGIN' packet now.
 }
 
-bool Server::OnDisconnect() {
-  CHECK(event_->GetType() == Event::TYPE_DISCONNECT);
+bool Server::OnDisconnect(const NetworkEvent& event) {
+  CHECK(event.type == NetworkEvent::TYPE_DISCONNECT);
 
-  void* peer_data = event_->GetPeer()->GetData();
-  // So complicated to make it work under both x32 and x64.
-  uint32_t id = static_cast<uint32_t>(reinterpret_cast<size_t>(peer_data));
-  Client* client = client_manager_.GetClient(id);
+  uint32_t id = event.client_id;
 
-  controller_.OnPlayerDisconnected(client->entity);
-
-  client_manager_.DeleteClient(id, true);
+  // The client may have been dropped before logging in.
+  auto itr = client_rooms_.find(id);
+  if (itr != client_rooms_.end()) {
+    Room* room = itr->second;
+    Client* client = room->GetClientManager()->GetClient(id);
+    room->GetController()->OnPlayerDisconnected(client->entity);
+    room->GetClientManager()->DeleteClient(id, true);
+    client_rooms_.erase(itr);
+  }
 
   printf("#%u: Client from %s:%u disconnected.\n", id,
-    event_->GetPeer()->GetIp().c_str(), event_->GetPeer()->GetPort());
+    FormatAddress(event.address).c_str(), event.port);
 
   return true;
 }
 
-bool Server::OnReceive() {
-  CHECK(event_->GetType() == Event::TYPE_RECEIVE);
+bool Server::OnReceive(const NetworkEvent& event) {
+  CHECK(event.type == NetworkEvent::TYPE_RECEIVE);
 
-  void* peer_data = event_->GetPeer()->GetData();
-  // So complicated to make it work under both x32 and x64.
-  uint32_t id = static_cast<uint32_t>(reinterpret_cast<size_t>(peer_data));
-
-  std::vector<char> message;
-  event_->GetData(&message);
+  uint32_t id = event.client_id;
+  const std::vector<char>& message = event.data;
 
   Packet::Type packet_type;
   bool rv = ExtractPacketType(message, &packet_type);
   if (rv == false) {
     printf("#%u: Incorrect message format [5], client dropped.\n", id);
-    client_manager_.DisconnectClient(id);
+    network_.Disconnect(id);
     return true;
   }
 
+  auto room_itr = client_rooms_.find(id);
   if (packet_type == Packet::TYPE_LOGIN) {
-    if (!OnLogin(id)) {
+    if (room_itr != client_rooms_.end()) {
+      printf("#%u: Repeated login, client dropped.\n", id);
+      network_.Disconnect(id);
+      return true;
+    }
+    if (!OnLogin(event)) {
       return false;
     }
     return true;
   }
 
-  Client* client = client_manager_.GetClient(id);
+  if (room_itr == client_rooms_.end()) {
+    printf("#%u: Packet before login, client dropped.\n", id);
+    network_.Disconnect(id);
+    return true;
+  }
+
+  Room* room = room_itr->second;
+  Controller* controller = room->GetController();
+  Client* client = room->GetClientManager()->GetClient(id);
+  client->round_trip_time = event.round_trip_time;
 
   switch (packet_type) {
     case Packet::TYPE_SYNC_TIME_REQUEST: {
@@ -289,47 +532,47 @@ bool Server::OnReceive() {
       rv = ExtractPacketData<Packet::Type, TimeSyncData>(message, &sync_data);
       if (rv == false) {
         printf("#%u: Incorrect message format [0], client dropped.\n", id);
-        client_manager_.DisconnectClient(id);
+        network_.Disconnect(id);
         return true;
       }
 
       sync_data.server_time = Timestamp();
       packet_type = Packet::TYPE_SYNC_TIME_RESPONSE;
 
-      rv = SendPacket(client->peer, packet_type, sync_data, true);
+      // Commands are flushed by the network thread right away.
+      rv = SendPacket(&network_, id, packet_type, sync_data, true);
       if (rv == false) {
         return false;
       }
-
-      host_->Flush();
     } break;
 
     case Packet::TYPE_CLIENT_STATUS: {
-      if (!OnClientStatus(id)) {
+      if (!OnClientStatus(room, id)) {
         return false;
       }
     } break;
 
     case Packet::TYPE_KEYBOARD_EVENT: {
-      KeyboardEvent event;
-      rv = ExtractPacketData<Packet::Type, KeyboardEvent>(message, &event);
+      KeyboardEvent keyboard_event;
+      rv = ExtractPacketData<Packet::Type, KeyboardEvent>(message,
+          &keyboard_event);
       if (rv == false) {
         printf("#%u: Incorrect message format [1], client dropped.\n", id);
-        client_manager_.DisconnectClient(id);
+        network_.Disconnect(id);
         return true;
       }
-      controller_.OnKeyboardEvent(client->entity, event);
+      controller->OnKeyboardEvent(client->entity, keyboard_event);
     } break;
 
     case Packet::TYPE_MOUSE_EVENT: {
-      MouseEvent event;
-      rv = ExtractPacketData<Packet::Type, MouseEvent>(message, &event);
+      MouseEvent mouse_event;
+      rv = ExtractPacketData<Packet::Type, MouseEvent>(message, &mouse_event);
       if (rv == false) {
         printf("#%u: Incorrect message format [2], client dropped.\n", id);
-        client_manager_.DisconnectClient(id);
+        network_.Disconnect(id);
         return true;
       }
-      controller_.OnMouseEvent(client->entity, event);
+      controller->OnMouseEvent(client->entity, mouse_event);
     } break;
 
     case Packet::TYPE_PLAYER_ACTION: {
@@ -337,16 +580,30 @@ bool Server::OnReceive() {
       rv = ExtractPacketData<Packet::Type, PlayerAction>(message, &action);
       if (rv == false) {
         printf("#%u: Incorrect message format [3], client dropped.\n", id);
-        client_manager_.DisconnectClient(id);
+        network_.Disconnect(id);
         return true;
       }
-      controller_.OnPlayerAction(client->entity, action);
+      int64_t rewind = client->round_trip_time / 2 +
+          client->interpolation_offset;
+      controller->OnPlayerAction(client->entity, action, rewind);
     } break;
 
+    case Packet::TYPE_SNAPSHOT_ACK: {
+      SnapshotAck ack;
+      rv = ExtractPacketData<Packet::Type, SnapshotAck>(message, &ack);
+      if (rv == false) {
+        printf("#%u: Incorrect message format [6], client dropped.\n", id);
+        network_.Disconnect(id);
+        return true;
+      }
+      if (ack.tick != 0 && ack.tick < snapshot_tick_) {
+        client->snapshot_acks.Ack(ack.tick, ack.parts);
+      }
+    } break;
 
     default: {
       printf("#%u: Incorrect message format [4], client dropped.\n", id);
-      client_manager_.DisconnectClient(id);
+      network_.Disconnect(id);
       return true;
     } break;
   }
@@ -354,66 +611,80 @@ bool Server::OnReceive() {
   return true;
 }
 
-bool Server::OnLogin(uint32_t client_id) {
-  Peer* peer = event_->GetPeer();
-  CHECK(peer != NULL);
+bool Server::OnLogin(const NetworkEvent& event) {
+  uint32_t client_id = event.client_id;
 
   // Receive login data.
 
-  std::vector<char> message;
-  event_->GetData(&message);
-
   LoginData login_data;
-  bool rv = ExtractPacketData<Packet::Type, LoginData>(message, &login_data);
+  bool rv = ExtractPacketData<Packet::Type, LoginData>(event.data,
+      &login_data);
   if (rv == false) {
     printf("#%u: Incorrect message format [4], client dropped.\n", client_id);
+    network_.Disconnect(client_id);
+    return true;
+  }
+
+  if (login_data.room >= rooms_.size()) {
+    printf("#%u: No room %u, client dropped.\n", client_id,
+        login_data.room);
+    network_.Disconnect(client_id);
     return true;
   }
+  Room* room = rooms_[login_data.room].get();
 
-  printf("#%u: Login data has been received.\n", client_id);
+  printf("#%u: Login data has been received, room: %u.\n", client_id,
+      room->GetId());
 
   // Create player.
 
-  Player* player = controller_.OnPlayerConnected();
+  Player* player = room->GetController()->OnPlayerConnected();
 
   login_data.login[LoginData::MAX_LOGIN_LENGTH] = '\0';
   std::string login(&login_data.login[0]);
-  Client* client = new Client(peer, player, login);
+  Client* client = new Client(client_id, player, login);
   CHECK(client != NULL);
-  client_manager_.AddClient(client_id, client);
-
-  if (!SendClientOptions(client)) {
+  // Newer clients get the latest version we support.
+  client->protocol_version = std::min<uint32_t>(login_data.protocol_version,
+      PROTOCOL_VERSION_LATEST);
+  client->max_packet_size = event.max_unfragmented_length;
+  client->round_trip_time = event.round_trip_time;
+  client->interpolation_offset = std::min(
+      std::max(login_data.interpolation_offset, 0), max_interpolation_offset_);
+  room->GetClientManager()->AddClient(client_id, client);
+  client_rooms_[client_id] = room;
+
+  if (!SendClientOptions(room, client)) {
     return false;
   }
 
   printf("#%u: Client options has been sent.\n", client_id);
 
-  // Broadcast the new player info.
+  // Send the new player info to the room. The player entity itself will be
+  // sent to the clients once it gets into their areas of interest.
 
   // The new player may not receive this info, as he will be
   // synchronizing time and ignoring everything else.
 
-  if (!BroadcastEntityRelatedMessage(Packet::TYPE_ENTITY_APPEARED,
-      client->entity)) {
-    return false;
-  }
-
   PlayerInfo player_info;
   player_info.id = player->GetId();
   std::copy(login.c_str(), login.c_str() + login.size() + 1,
       &player_info.login[0]);
-  rv = BroadcastPacket(host_, Packet::TYPE_PLAYER_INFO, player_info, true);
-  if (rv == false) {
-    return false;
+  for (auto itr : *room->GetClientManager()->GetClients()) {
+    rv = SendPacket(&network_, itr.first, Packet::TYPE_PLAYER_INFO,
+        player_info, true);
+    if (rv == false) {
+      return false;
+    }
   }
 
   printf("#%u: Client from %s:%u connected.\n", client_id,
-    event_->GetPeer()->GetIp().c_str(), event_->GetPeer()->GetPort());
+    FormatAddress(event.address).c_str(), event.port);
 
   return true;
 }
 
-bool Server::SendClientOptions(Client* client) {
+bool Server::SendClientOptions(Room* room, Client* client) {
   ClientOptions options;
   options.id = client->entity->GetId();
   options.speed = client->entity->GetSpeed();
@@ -421,10 +692,13 @@ bool Server::SendClientOptions(Client* client) {
   options.y = client->entity->GetPosition().y;
   options.max_health = client->entity->GetMaxHealth();
   options.energy_capacity = client->entity->GetEnergyCapacity();
+  options.protocol_version = client->protocol_version;
+  options.position_step = room->GetPositionStep();
+  options.position_bits = room->GetPositionBits();
 
   Packet::Type packet_type = Packet::TYPE_CLIENT_OPTIONS;
 
-  bool rv = SendPacket(client->peer, packet_type, options, true);
+  bool rv = SendPacket(&network_, client->id, packet_type, options, true);
   if (rv == false) {
     return false;
   }
@@ -432,18 +706,18 @@ bool Server::SendClientOptions(Client* client) {
   return true;
 }
 
-bool Server::OnClientStatus(uint32_t client_id) {
-  // Send to the new player all players' info.
+bool Server::OnClientStatus(Room* room, uint32_t client_id) {
+  // Send to the new player the info of all the players in the room.
 
   PlayerInfo player_info;
-  Client* client = client_manager_.GetClient(client_id);
+  Client* client = room->GetClientManager()->GetClient(client_id);
 
-  for (auto i : *client_manager_.GetClients()) {
+  for (auto i : *room->GetClientManager()->GetClients()) {
     player_info.id = i.second->entity->GetId();
     std::string& login = i.second->login;
     std::copy(login.c_str(), login.c_str() + login.size() + 1,
         &player_info.login[0]);
-    bool rv = SendPacket(client->peer, Packet::TYPE_PLAYER_INFO,
+    bool rv = SendPacket(&network_, client->id, Packet::TYPE_PLAYER_INFO,
         player_info, true);
     if (rv == false) {
       return false;
@@ -452,25 +726,7 @@ bool Server::OnClientStatus(uint32_t client_id) {
 
   // And all the static entities.
 
-  if (!BroadcastStaticEntities(true)) {
-    return false;
-  }
-
-  return true;
-}
-
-bool Server::BroadcastEntityRelatedMessage(Packet::Type packet_type,
-    ServerEntity* entity) {
-  CHECK(packet_type == Packet::TYPE_ENTITY_APPEARED ||
-    packet_type == Packet::TYPE_ENTITY_UPDATED);
-
-  EntitySnapshot snapshot;
-  entity->GetSnapshot(Timestamp(), &snapshot);
-
-  bool rv = BroadcastPacket(host_, packet_type, snapshot, true);
-  if (rv == false) {
-    return false;
-  }
+  SendStaticEntities(room, client);
 
   return true;
 }
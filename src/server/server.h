@@ -6,25 +6,31 @@
 #include <cstring>
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "base/error.h"
-#include "base/id_manager.h"
 #include "base/macros.h"
 #include "base/pstdint.h"
 #include "base/timer.h"
-
-#include "net/enet.h"
+#include "base/worker_pool.h"
 
 #include "engine/protocol.h"
+#include "engine/snapshot_codec.h"
+#include "engine/world_state.h"
 
 #include "server/client_manager.h"
-#include "server/controller.h"
+#include "server/config_reloader.h"
 #include "server/entity.h"
+#include "server/network_thread.h"
+#include "server/room.h"
+#include "server/tick_profiler.h"
 
 namespace bm {
 
+// Hosts several independent rooms on one port. Clients choose the room
+// when logging in.
 class Server {
  public:
   Server();
@@ -36,39 +42,95 @@ class Server {
   bool Tick();
 
  private:
-  bool BroadcastDynamicEntities();
-  bool BroadcastStaticEntities(bool force = false);
+  // Scratch space of a serialization worker.
+  struct SerializationWorker {
+    WorldStateWriter writer;
+    std::vector<uint32_t> query_ids;
+    std::vector<Entity*> nearby_entities;
+  };
+
+  // Packets built for a client by a worker.
+  struct ClientPackets {
+    Room* room;
+    Client* client;
+    std::vector<std::vector<char> > world_state;
+    std::vector<std::vector<char> > disappeared;
+  };
+
+  // Sends to each client the snapshots of the entities within its area
+  // of interest and of the static entities it hasn't acknowledged yet.
+  // The packets for different clients are built in parallel.
+  bool BroadcastWorldState();
+
+  // Called on a worker thread. Touches only 'worker', the client and
+  // the read-only room.
+  void BuildWorldState(SerializationWorker* worker, int64_t time,
+      ClientPackets* packets);
+
+  // Queues all the static entities to be sent to the client.
+  void SendStaticEntities(Room* room, Client* client);
+
+  // Adds the snapshot to the world state being packed for the client,
+  // either in full or as a delta against the last snapshot of the entity
+  // the client has acknowledged.
+  void AddEntitySnapshot(Client* client, WorldStateWriter* writer,
+      const EntitySnapshot& snapshot);
+
+  // Returns the oldest tick that may be used as a delta baseline.
+  uint32_t GetMinBaselineTick() const;
+
+  // Returns NULL if the client uses raw snapshots.
+  const SnapshotCodec* GetSnapshotCodec(Room* room, Client* client) const;
 
   bool BroadcastGameEvents();
 
+  // Handles the events queued by the network thread.
   bool PumpEvents();
 
-  void OnConnect();
-  bool OnDisconnect();
-
-  bool OnReceive();
+  void OnConnect(const NetworkEvent& event);
+  bool OnDisconnect(const NetworkEvent& event);
 
-  bool OnLogin(uint32_t client_id);
-  bool SendClientOptions(Client* client);
+  bool OnReceive(const NetworkEvent& event);
 
-  bool OnClientStatus(uint32_t client_id);
+  bool OnLogin(const NetworkEvent& event);
+  bool SendClientOptions(Room* room, Client* client);
 
-  bool BroadcastEntityRelatedMessage(Packet::Type packet_type,
-      ServerEntity* entity);
+  bool OnClientStatus(Room* room, uint32_t client_id);
 
   int64_t broadcast_timeout_;
   int64_t last_broadcast_;
 
+  // Simulation step and the time the last step ends at.
   int64_t update_timeout_;
   int64_t last_update_;
+  int32_t max_catch_up_ticks_;
+  int64_t max_lag_;
+
+  float view_radius_;
+
+  // The interpolation offset claimed by a client is capped by this, so
+  // that it can't make the server rewind further than it really lags.
+  int32_t max_interpolation_offset_;
+
+  bool delta_snapshots_;
+  uint32_t snapshot_tick_;
+
+  bool reload_configs_;
+  ConfigReloader config_reloader_;
+
+  // Steps the rooms and builds the world states.
+  WorkerPool worker_pool_;
+  std::vector<std::unique_ptr<SerializationWorker> > serialization_workers_;
+  std::vector<ClientPackets> client_packets_;
+
+  TickProfiler profiler_;
+  uint32_t last_sent_data_;
 
-  Enet enet_;
-  ServerHost* host_;
-  Event* event_;
+  NetworkThread network_;
 
-  IdManager id_manager_;
-  Controller controller_;
-  ClientManager client_manager_;
+  std::vector<std::unique_ptr<Room> > rooms_;
+  // Rooms of the logged in clients.
+  std::map<uint32_t, Room*> client_rooms_;
 
   enum {
     STATE_FINALIZED,
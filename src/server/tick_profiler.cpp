@@ -0,0 +1,198 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#include "server/tick_profiler.h"
+
+#include <cstdio>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/error.h"
+#include "base/macros.h"
+#include "base/pstdint.h"
+#include "base/time.h"
+
+namespace bm {
+
+namespace {
+
+const char* PHASE_NAMES[] = {
+  "update",
+  "spawn_zombies",
+  "update_entities",
+  "step_physics",
+  "destroy_outlying_entities",
+  "respawn_dead_players",
+  "delete_destroyed_entities",
+  "morph",
+  "record_positions",
+  "broadcast_world_state",
+  "broadcast_game_events",
+  "pump_events"
+};
+
+const char* COUNTER_NAMES[] = {
+  "dynamic_entities",
+  "static_entities",
+  "clients",
+  "bytes_sent"
+};
+
+SCHECK(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) ==
+    TickProfiler::PHASE_COUNT);
+SCHECK(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) ==
+    TickProfiler::COUNTER_COUNT);
+
+}  // anonymous namespace
+
+TickProfiler::TickProfiler() : period_(0), period_start_(0) {
+  for (size_t i = 0; i < PHASE_COUNT; i++) {
+    phase_starts_[i] = 0;
+    phase_totals_[i] = 0;
+    phase_counts_[i] = 0;
+  }
+}
+
+TickProfiler::~TickProfiler() { }
+
+void TickProfiler::Initialize(int64_t period, const std::string& file) {
+  CHECK(period >= 0);
+  period_ = period;
+  file_ = file;
+  period_start_ = Timestamp();
+}
+
+void TickProfiler::BeginPhase(Phase phase) {
+  CHECK(phase < PHASE_COUNT);
+  phase_starts_[phase] = TimestampNs();
+}
+
+void TickProfiler::EndPhase(Phase phase) {
+  CHECK(phase < PHASE_COUNT);
+  int64_t duration = TimestampNs() - phase_starts_[phase];
+  phase_totals_[phase] += duration;
+  phase_counts_[phase]++;
+  if (period_ == 0) {
+    return;
+  }
+  phase_samples_[phase].push_back(duration);
+}
+
+void TickProfiler::AddSample(Counter counter, int64_t value) {
+  CHECK(counter < COUNTER_COUNT);
+  if (period_ == 0) {
+    return;
+  }
+  counter_samples_[counter].push_back(value);
+}
+
+void TickProfiler::Update(int64_t time) {
+  if (period_ == 0 || time - period_start_ < period_) {
+    return;
+  }
+  Report(time - period_start_);
+  period_start_ = time;
+  for (size_t i = 0; i < PHASE_COUNT; i++) {
+    phase_samples_[i].clear();
+    phase_totals_[i] = 0;
+    phase_counts_[i] = 0;
+  }
+  for (size_t i = 0; i < COUNTER_COUNT; i++) {
+    counter_samples_[i].clear();
+  }
+}
+
+int64_t TickProfiler::GetPhaseTotal(Phase phase) const {
+  CHECK(phase < PHASE_COUNT);
+  return phase_totals_[phase];
+}
+
+size_t TickProfiler::GetPhaseCount(Phase phase) const {
+  CHECK(phase < PHASE_COUNT);
+  return phase_counts_[phase];
+}
+
+const char* TickProfiler::GetPhaseName(Phase phase) {
+  CHECK(phase < PHASE_COUNT);
+  return PHASE_NAMES[phase];
+}
+
+void TickProfiler::GetStats(std::vector<int64_t>* samples, Stats* stats) {
+  CHECK(samples != NULL);
+  CHECK(stats != NULL);
+  stats->count = samples->size();
+  stats->p50 = 0;
+  stats->p99 = 0;
+  stats->max = 0;
+  if (samples->empty()) {
+    return;
+  }
+  std::sort(samples->begin(), samples->end());
+  stats->p50 = (*samples)[(samples->size() - 1) * 50 / 100];
+  stats->p99 = (*samples)[(samples->size() - 1) * 99 / 100];
+  stats->max = samples->back();
+}
+
+void TickProfiler::Report(int64_t period) {
+  Stats phase_stats[PHASE_COUNT];
+  for (size_t i = 0; i < PHASE_COUNT; i++) {
+    GetStats(&phase_samples_[i], &phase_stats[i]);
+  }
+  Stats counter_stats[COUNTER_COUNT];
+  for (size_t i = 0; i < COUNTER_COUNT; i++) {
+    GetStats(&counter_samples_[i], &counter_stats[i]);
+  }
+
+  const Stats& update = phase_stats[PHASE_UPDATE];
+  const Stats& broadcast = phase_stats[PHASE_BROADCAST_WORLD_STATE];
+  printf("Tick stats: update p50 %.2f p99 %.2f max %.2f ms, "
+      "broadcast p50 %.2f p99 %.2f max %.2f ms, "
+      "%ld entities, %ld clients, %ld bytes/broadcast.\n",
+      update.p50 / 1e6, update.p99 / 1e6, update.max / 1e6,
+      broadcast.p50 / 1e6, broadcast.p99 / 1e6, broadcast.max / 1e6,
+      counter_stats[COUNTER_DYNAMIC_ENTITIES].max +
+          counter_stats[COUNTER_STATIC_ENTITIES].max,
+      counter_stats[COUNTER_CLIENTS].max,
+      counter_stats[COUNTER_BYTES_SENT].p50);
+
+  if (file_.empty()) {
+    return;
+  }
+  FILE* file = fopen(file_.c_str(), "w");
+  if (file == NULL) {
+    REPORT_WARNING("Can't open stats file '%s'.", file_.c_str());
+    return;
+  }
+  fprintf(file, "period_ms %ld\n", period);
+  fprintf(file, "%-28s %8s %10s %10s %10s\n",
+      "phase_us", "count", "p50", "p99", "max");
+  for (size_t i = 0; i < PHASE_COUNT; i++) {
+    const Stats& stats = phase_stats[i];
+    fprintf(file, "%-28s %8zu %10ld %10ld %10ld\n", PHASE_NAMES[i],
+        stats.count, stats.p50 / 1000, stats.p99 / 1000, stats.max / 1000);
+  }
+  fprintf(file, "%-28s %8s %10s %10s %10s\n",
+      "counter", "count", "p50", "p99", "max");
+  for (size_t i = 0; i < COUNTER_COUNT; i++) {
+    const Stats& stats = counter_stats[i];
+    fprintf(file, "%-28s %8zu %10ld %10ld %10ld\n", COUNTER_NAMES[i],
+        stats.count, stats.p50, stats.p99, stats.max);
+  }
+  fclose(file);
+}
+
+ScopedPhase::ScopedPhase(TickProfiler* profiler, TickProfiler::Phase phase)
+    : profiler_(profiler), phase_(phase) {
+  if (profiler_ != NULL) {
+    profiler_->BeginPhase(phase_);
+  }
+}
+
+ScopedPhase::~ScopedPhase() {
+  if (profiler_ != NULL) {
+    profiler_->EndPhase(phase_);
+  }
+}
+
+}  // namespace bm
@@ -0,0 +1,109 @@
+// Copyright (c) 2015 Blowmorph Team
+
+#ifndef SERVER_TICK_PROFILER_H_
+#define SERVER_TICK_PROFILER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/pstdint.h"
+
+namespace bm {
+
+// Collects the durations of the server tick phases and per-tick counters
+// over a reporting period. At the end of each period prints a summary line
+// and writes p50/p99/max of every phase and counter to the stats file.
+class TickProfiler {
+ public:
+  enum Phase {
+    PHASE_UPDATE,
+    PHASE_SPAWN_ZOMBIES,
+    PHASE_UPDATE_ENTITIES,
+    PHASE_STEP_PHYSICS,
+    PHASE_DESTROY_OUTLYING_ENTITIES,
+    PHASE_RESPAWN_DEAD_PLAYERS,
+    PHASE_DELETE_DESTROYED_ENTITIES,
+    PHASE_MORPH,
+    PHASE_RECORD_POSITIONS,
+    PHASE_BROADCAST_WORLD_STATE,
+    PHASE_BROADCAST_GAME_EVENTS,
+    PHASE_PUMP_EVENTS,
+    PHASE_COUNT
+  };
+
+  enum Counter {
+    COUNTER_DYNAMIC_ENTITIES,
+    COUNTER_STATIC_ENTITIES,
+    COUNTER_CLIENTS,
+    COUNTER_BYTES_SENT,
+    COUNTER_COUNT
+  };
+
+  TickProfiler();
+  ~TickProfiler();
+
+  // 'period' is the reporting period in ms. With '0' there are no
+  // reports and no samples are stored, only the phase totals are kept.
+  // The stats file isn't written if 'file' is empty.
+  void Initialize(int64_t period, const std::string& file);
+
+  void BeginPhase(Phase phase);
+  void EndPhase(Phase phase);
+
+  void AddSample(Counter counter, int64_t value);
+
+  // Reports the stats if the current period is over and starts a new one.
+  void Update(int64_t time);
+
+  // Returns the total duration of the phase in ns and the number of its
+  // samples in the current period.
+  int64_t GetPhaseTotal(Phase phase) const;
+  size_t GetPhaseCount(Phase phase) const;
+
+  static const char* GetPhaseName(Phase phase);
+
+ private:
+  struct Stats {
+    size_t count;
+    int64_t p50;
+    int64_t p99;
+    int64_t max;
+  };
+
+  // Reorders 'samples'.
+  static void GetStats(std::vector<int64_t>* samples, Stats* stats);
+
+  void Report(int64_t period);
+
+  int64_t period_;
+  std::string file_;
+  int64_t period_start_;
+
+  // The phases are timed in ns.
+  int64_t phase_starts_[PHASE_COUNT];
+  int64_t phase_totals_[PHASE_COUNT];
+  size_t phase_counts_[PHASE_COUNT];
+  std::vector<int64_t> phase_samples_[PHASE_COUNT];
+  std::vector<int64_t> counter_samples_[COUNTER_COUNT];
+
+  DISALLOW_COPY_AND_ASSIGN(TickProfiler);
+};
+
+// Times a phase until the end of the scope. Does nothing if 'profiler'
+// is NULL.
+class ScopedPhase {
+ public:
+  ScopedPhase(TickProfiler* profiler, TickProfiler::Phase phase);
+  ~ScopedPhase();
+
+ private:
+  TickProfiler* profiler_;
+  TickProfiler::Phase phase_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedPhase);
+};
+
+}  // namespace bm
+
+#endif  // SERVER_TICK_PROFILER_H_
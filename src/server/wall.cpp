@@ -9,6 +9,7 @@
 
 #include "base/error.h"
 #include "base/macros.h"
+#include "base/object_pool.h"
 #include "base/pstdint.h"
 
 #include "engine/body.h"
@@ -20,16 +21,19 @@
 
 namespace bm {
 
+DEFINE_POOLED_ALLOCATION(Wall, 256)
+
 Wall::Wall(
   Controller* controller,
   uint32_t id,
   const b2Vec2& position,
-  const std::string& entity_name
-) : ServerEntity(controller, id, Entity::TYPE_WALL, entity_name, position,
+  uint32_t config_id
+) : ServerEntity(controller, id, Entity::TYPE_WALL, config_id, position,
                  Entity::FILTER_WALL, Entity::FILTER_ALL) {
-  auto config = Config::GetInstance()->GetWallsConfig();
-  CHECK(config.count(entity_name) == 1);
-  Config::WallConfig::Type type = config.at(entity_name).type;
+  const Config::WallConfig* config =
+      Config::GetInstance()->GetWallConfig(config_id);
+  CHECK(config != NULL);
+  Config::WallConfig::Type type = config->type;
   if (type == Config::WallConfig::TYPE_ORDINARY) {
     _type = TYPE_ORDINARY;
   } else if (type == Config::WallConfig::TYPE_UNBREAKABLE) {
@@ -15,6 +15,7 @@
 #include "base/id_manager.h"
 #include "base/pstdint.h"
 
+#include "engine/config.h"
 #include "engine/map.h"
 #include "engine/world.h"
 
@@ -44,10 +45,10 @@ float ServerWorld::GetBlockSize() const {
 
 Activator* ServerWorld::CreateActivator(
   const b2Vec2& position,
-  const std::string& entity_name
+  uint32_t config_id
 ) {
   uint32_t id = id_manager_.NewId();
-  Activator* activator = new Activator(controller_, id, position, entity_name);
+  Activator* activator = new Activator(controller_, id, position, config_id);
   CHECK(activator != NULL);
   AddEntity(id, activator);
   return activator;
@@ -55,10 +56,10 @@ Activator* ServerWorld::CreateActivator(
 
 Critter* ServerWorld::CreateCritter(
   const b2Vec2& position,
-  const std::string& entity_name
+  uint32_t config_id
 ) {
   uint32_t id = id_manager_.NewId();
-  Critter* critter = new Critter(controller_, id, position, entity_name);
+  Critter* critter = new Critter(controller_, id, position, config_id);
   CHECK(critter != NULL);
   AddEntity(id, critter);
   return critter;
@@ -66,10 +67,10 @@ Critter* ServerWorld::CreateCritter(
 
 Door* ServerWorld::CreateDoor(
   const b2Vec2& position,
-  const std::string& entity_name
+  uint32_t config_id
 ) {
   uint32_t id = id_manager_.NewId();
-  Door* door = new Door(controller_, id, position, entity_name);
+  Door* door = new Door(controller_, id, position, config_id);
   CHECK(door != NULL);
   AddEntity(id, door);
   return door;
@@ -77,10 +78,10 @@ Door* ServerWorld::CreateDoor(
 
 Kit* ServerWorld::CreateKit(
   const b2Vec2& position,
-  const std::string& entity_name
+  uint32_t config_id
 ) {
   uint32_t id = id_manager_.NewId();
-  Kit* kit = new Kit(controller_, id, position, entity_name);
+  Kit* kit = new Kit(controller_, id, position, config_id);
   CHECK(kit != NULL);
   AddEntity(id, kit);
   return kit;
@@ -88,10 +89,10 @@ Kit* ServerWorld::CreateKit(
 
 Player* ServerWorld::CreatePlayer(
     const b2Vec2& position,
-    const std::string& entity_name
+    uint32_t config_id
 ) {
   uint32_t id = id_manager_.NewId();
-  Player* player = new Player(controller_, entity_name, id, position);
+  Player* player = new Player(controller_, config_id, id, position);
   CHECK(player != NULL);
   AddEntity(id, player);
   return player;
@@ -101,12 +102,12 @@ Projectile* ServerWorld::CreateProjectile(
   uint32_t owner_id,
   const b2Vec2& start,
   const b2Vec2& end,
-  const std::string& entity_name
+  uint32_t config_id
 ) {
   CHECK(GetEntity(owner_id) != NULL);
   uint32_t id = id_manager_.NewId();
   Projectile* projectile = new Projectile(controller_,
-    id, owner_id, start, end, entity_name);
+    id, owner_id, start, end, config_id);
   CHECK(projectile != NULL);
   AddEntity(id, projectile);
   return projectile;
@@ -114,10 +115,10 @@ Projectile* ServerWorld::CreateProjectile(
 
 Wall* ServerWorld::CreateWall(
   const b2Vec2& position,
-  const std::string& entity_name
+  uint32_t config_id
 ) {
   uint32_t id = id_manager_.NewId();
-  Wall* wall = new Wall(controller_, id, position, entity_name);
+  Wall* wall = new Wall(controller_, id, position, config_id);
   CHECK(wall != NULL);
   AddEntity(id, wall);
   return wall;
@@ -131,6 +132,18 @@ std::vector<b2Vec2>* ServerWorld::GetZombieSpawnPositions() {
   return &zombie_spawn_positions_;
 }
 
+void ServerWorld::RemoveEntity(uint32_t id) {
+  World::RemoveEntity(id);
+  removed_ids_.push_back(id);
+}
+
+void ServerWorld::FreeRemovedIds() {
+  for (auto id : removed_ids_) {
+    id_manager_.FreeId(id);
+  }
+  removed_ids_.clear();
+}
+
 bool ServerWorld::LoadMap(const std::string& file) {
   Map map;
   if (!map.Load(file)) {
@@ -140,6 +153,7 @@ bool ServerWorld::LoadMap(const std::string& file) {
 
   block_size_ = map.GetBlockSize();
   bound_ = (std::max(map.GetWidth(), map.GetHeight()) + 1) * block_size_;
+  SetGridCellSize(block_size_);
 
   for (auto spawn : map.GetSpawns()) {
     float x = spawn.x * block_size_;
@@ -153,24 +167,44 @@ bool ServerWorld::LoadMap(const std::string& file) {
     zombie_spawn_positions_.push_back(b2Vec2(x, y));
   }
 
+  Config* config = Config::GetInstance();
+
   for (auto kit : map.GetKits()) {
+    uint32_t config_id;
+    if (!Config::FindId(config->GetKitsConfig(), map.GetEntityName(kit),
+            &config_id)) {
+      REPORT_ERROR("Can't load map '%s'.", file.c_str());
+      return false;
+    }
     float x = kit.x * block_size_;
     float y = kit.y * block_size_;
-    Kit* entity = CreateKit(b2Vec2(x, y), kit.entity_name);
+    Kit* entity = CreateKit(b2Vec2(x, y), config_id);
     entity->SetRotation(static_cast<float>(M_PI) * kit.rotation / 180);
   }
 
   for (auto door : map.GetDoors()) {
+    uint32_t config_id;
+    if (!Config::FindId(config->GetDoorsConfig(), map.GetEntityName(door),
+            &config_id)) {
+      REPORT_ERROR("Can't load map '%s'.", file.c_str());
+      return false;
+    }
     float x = door.x * block_size_;
     float y = door.y * block_size_;
-    Door* entity = CreateDoor(b2Vec2(x, y), door.entity_name);
+    Door* entity = CreateDoor(b2Vec2(x, y), config_id);
 	entity->SetRotation(static_cast<float>(M_PI) * door.rotation / 180);
   }
 
   for (auto wall : map.GetWalls()) {
+    uint32_t config_id;
+    if (!Config::FindId(config->GetWallsConfig(), map.GetEntityName(wall),
+            &config_id)) {
+      REPORT_ERROR("Can't load map '%s'.", file.c_str());
+      return false;
+    }
     float x = wall.x * block_size_;
     float y = wall.y * block_size_;
-    Wall* entity = CreateWall(b2Vec2(x, y), wall.entity_name);
+    Wall* entity = CreateWall(b2Vec2(x, y), config_id);
 	entity->SetRotation(static_cast<float>(M_PI) * wall.rotation / 180);
   }
 
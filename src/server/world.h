@@ -40,39 +40,49 @@ class ServerWorld : public World {
 
   bool LoadMap(const std::string& file);
 
+  // The entities are created from the configs with the given ids,
+  // see 'Config::FindId()'.
+
   Activator* CreateActivator(
     const b2Vec2& position,
-    const std::string& entity_name);
+    uint32_t config_id);
 
   Critter* CreateCritter(
     const b2Vec2& position,
-    const std::string& entity_name);
+    uint32_t config_id);
 
   Door* CreateDoor(
     const b2Vec2& position,
-    const std::string& entity_name);
+    uint32_t config_id);
 
   Kit* CreateKit(
     const b2Vec2& position,
-    const std::string& entity_name);
+    uint32_t config_id);
 
   Player* CreatePlayer(
     const b2Vec2& position,
-    const std::string& entity_name);
+    uint32_t config_id);
 
   Projectile* CreateProjectile(
     uint32_t owner_id,
     const b2Vec2& start,
     const b2Vec2& end,
-    const std::string& entity_name);
+    uint32_t config_id);
 
   Wall* CreateWall(
     const b2Vec2& position,
-    const std::string& entity_name);
+    uint32_t config_id);
 
   std::vector<b2Vec2>* GetSpawnPositions();
   std::vector<b2Vec2>* GetZombieSpawnPositions();
 
+  // Doesn't delete the entity object. The id isn't reused until
+  // 'FreeRemovedIds()' is called, so that the clients learn about the
+  // removal before they see the slot of the id reused.
+  void RemoveEntity(uint32_t id);
+  // Should be called once the removals have been sent to the clients.
+  void FreeRemovedIds();
+
  private:
   float block_size_;
   float bound_;
@@ -81,6 +91,8 @@ class ServerWorld : public World {
   std::vector<b2Vec2> zombie_spawn_positions_;
 
   IdManager id_manager_;
+  std::vector<uint32_t> removed_ids_;
+
   Controller* controller_;  // !refactor
 };
 